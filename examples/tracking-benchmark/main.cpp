@@ -0,0 +1,261 @@
+#include <settings/CommandLineParser.hpp>
+#include <routines/HsvThreshold.hpp>
+#include <routines/BackgroundModel.hpp>
+#include <TrackingDataManager.hpp>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+namespace {
+
+/*!
+ * Runs the function the given number of times, returns the average duration
+ * in milliseconds.
+ */
+double measureMs(std::function<void()> function, int iterations)
+{
+    // warm up
+    function();
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        function();
+    std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - startTime;
+    return duration.count() / iterations;
+}
+
+/*!
+ * Makes the 1080p test frame: a noisy background with colored spots.
+ */
+cv::Mat syntheticFrame()
+{
+    cv::Mat frame(1080, 1920, CV_8UC3);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+    cv::RNG rng(1);
+    for (int i = 0; i < 200; ++i) {
+        cv::circle(frame,
+                   cv::Point(rng.uniform(0, frame.cols), rng.uniform(0, frame.rows)),
+                   rng.uniform(3, 20),
+                   cv::Scalar(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256)),
+                   -1);
+    }
+    return frame;
+}
+
+/*!
+ * Compares the fused HSV threshold with the chain of OpenCV calls used before
+ * by the color based tracking routines.
+ */
+void benchmarkHsvThreshold(const cv::Mat& frame, int iterations)
+{
+    cv::Mat mask = cv::Mat::zeros(frame.size(), CV_8UC1);
+    cv::circle(mask, cv::Point(frame.cols / 2, frame.rows / 2), frame.rows / 2, cv::Scalar(255), -1);
+    cv::Mat colorMask;
+    cv::cvtColor(mask, colorMask, CV_GRAY2RGB);
+    cv::Scalar lowerBound(60, 0, 80);
+    cv::Scalar upperBound(100, 255, 255);
+
+    cv::Mat maskedImage;
+    cv::Mat hsvImage;
+    cv::Mat chainBinaryImage;
+    double chainMs = measureMs([&]()
+    {
+        cv::bitwise_and(frame, colorMask, maskedImage);
+        cv::cvtColor(maskedImage, hsvImage, CV_RGB2HSV);
+        cv::inRange(hsvImage, lowerBound, upperBound, chainBinaryImage);
+        cv::bitwise_and(chainBinaryImage, mask, chainBinaryImage);
+    }, iterations);
+
+    cv::Mat fusedBinaryImage;
+    double fusedMs = measureMs([&]()
+    {
+        HsvThreshold::apply(frame, mask, lowerBound, upperBound, fusedBinaryImage);
+    }, iterations);
+
+    int differentPixels = cv::countNonZero(chainBinaryImage != fusedBinaryImage);
+    qDebug() << QString("HSV threshold on %1x%2: mask + cvtColor + inRange %3 ms, "
+                        "fused %4 ms (x%5), %6 different pixels")
+                .arg(frame.cols)
+                .arg(frame.rows)
+                .arg(chainMs, 0, 'f', 3)
+                .arg(fusedMs, 0, 'f', 3)
+                .arg(chainMs / fusedMs, 0, 'f', 1)
+                .arg(differentPixels);
+}
+
+/*!
+ * Makes the grayscale frames of the agents moving over the still background.
+ */
+std::vector<cv::Mat> syntheticSequence(const cv::Mat& frame, int length)
+{
+    cv::Mat background;
+    cv::cvtColor(frame, background, CV_RGB2GRAY);
+    std::vector<cv::Mat> sequence;
+    for (int index = 0; index < length; ++index) {
+        cv::Mat image = background.clone();
+        for (int agent = 0; agent < 10; ++agent) {
+            cv::Point center(frame.cols * (agent + 1) / 11, (frame.rows / 4 + index * 8) % frame.rows);
+            cv::circle(image, center, 12, cv::Scalar(0), -1);
+        }
+        sequence.push_back(image);
+    }
+    return sequence;
+}
+
+/*!
+ * Reports the time per frame of the background models, the models are
+ * learned before the measurement.
+ */
+void benchmarkBackgroundModels(const cv::Mat& frame, int iterations)
+{
+    const int LearningFrames = 25;
+    std::vector<cv::Mat> sequence = syntheticSequence(frame, LearningFrames);
+
+    struct Configuration
+    {
+        QString name;
+        BackgroundModelType type;
+        int updatePeriodFrames;
+        bool updateOutsideBlobsOnly;
+    };
+    std::vector<Configuration> configurations = {
+        {"MOG, not updated", BackgroundModelType::MOG, 0, false},
+        {"MOG, updated every frame", BackgroundModelType::MOG, 1, false},
+        {"MOG2, not updated", BackgroundModelType::MOG2, 0, false},
+        {"MOG2, updated every frame", BackgroundModelType::MOG2, 1, false},
+        {"MOG2, updated every 10th frame", BackgroundModelType::MOG2, 10, false},
+        {"median", BackgroundModelType::MEDIAN, 0, false},
+        {"running average, not updated", BackgroundModelType::RUNNING_AVERAGE, 0, false},
+        {"running average, updated every frame", BackgroundModelType::RUNNING_AVERAGE, 1, false},
+        {"running average, updated outside blobs", BackgroundModelType::RUNNING_AVERAGE, 1, true}
+    };
+
+    cv::Mat foreground;
+    for (const Configuration& configuration : configurations) {
+        BackgroundModelDescription description;
+        description.type = configuration.type;
+        description.learningFrames = LearningFrames;
+        description.updatePeriodFrames = configuration.updatePeriodFrames;
+        description.updateOutsideBlobsOnly = configuration.updateOutsideBlobsOnly;
+        BackgroundModelPtr model = BackgroundModel::create(description);
+
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+        for (const cv::Mat& image : sequence)
+            model->apply(image, foreground);
+        std::chrono::duration<double, std::milli> learningDuration = std::chrono::steady_clock::now() - startTime;
+
+        size_t index = 0;
+        double frameMs = measureMs([&]()
+        {
+            model->apply(sequence[index++ % sequence.size()], foreground);
+        }, iterations);
+        qDebug() << QString("Background model %1 on %2x%3: %4 ms/frame (learning %5 ms/frame)")
+                    .arg(configuration.name)
+                    .arg(frame.cols)
+                    .arg(frame.rows)
+                    .arg(frameMs, 0, 'f', 3)
+                    .arg(learningDuration.count() / LearningFrames, 0, 'f', 3);
+    }
+}
+
+/*!
+ * Reports the time to merge the agents seen by two cameras, the agents of the
+ * second camera are the same as of the first one, slightly moved.
+ */
+void benchmarkAgentsMerging(int iterations)
+{
+    TrackingDataManager dataManager("", false);
+    // the camera below is the primary data source as it sees the robots
+    TrackingResultsQueuePtr mainCameraQueue =
+            dataManager.addDataSource(SetupType::MAIN_CAMERA, QList<AgentType>({AgentType::GENERIC}));
+    TrackingResultsQueuePtr cameraBelowQueue =
+            dataManager.addDataSource(SetupType::CAMERA_BELOW, QList<AgentType>({AgentType::CASU}));
+
+    // the merged results are sent from the fusion thread through the event loop
+    int mergedResults = 0;
+    QObject::connect(&dataManager, &TrackingDataManager::notifyAgentDataWorldMerged,
+                     [&](QList<AgentDataWorld>, std::chrono::milliseconds) { mergedResults++; });
+
+    cv::RNG rng(1);
+    std::chrono::microseconds timestamp(0);
+    for (int numberOfAgents : {5, 10, 20, 50, 100}) {
+        TimestampedWorldAgentsData mainCameraData;
+        TimestampedWorldAgentsData cameraBelowData;
+        for (int index = 0; index < numberOfAgents; ++index) {
+            PositionMeters position(rng.uniform(-1., 1.), rng.uniform(-1., 1.));
+            PositionMeters shiftedPosition(position.x() + rng.gaussian(0.01), position.y() + rng.gaussian(0.01));
+            mainCameraData.agentsData.append(AgentDataWorld(QString::number(index), AgentType::GENERIC,
+                                                            StateWorld(position)));
+            cameraBelowData.agentsData.append(AgentDataWorld(QString::number(index), AgentType::CASU,
+                                                             StateWorld(shiftedPosition)));
+        }
+
+        // measures the time from the hand-off to the reception of the results
+        double mergeMs = measureMs([&]()
+        {
+            timestamp += std::chrono::milliseconds(40);
+            mainCameraData.timestamp = timestamp;
+            cameraBelowData.timestamp = timestamp;
+            int expectedResults = mergedResults + 1;
+            mainCameraQueue->enqueue(mainCameraData);
+            cameraBelowQueue->enqueue(cameraBelowData);
+            while (mergedResults < expectedResults)
+                QCoreApplication::processEvents();
+        }, iterations);
+        qDebug() << QString("Merging %1 agents from two cameras: %2 ms")
+                    .arg(numberOfAgents)
+                    .arg(mergeMs, 0, 'f', 3);
+    }
+}
+
+} // namespace
+
+/*!
+ * Measures the performance of the tracking building blocks.
+ * Optional arguments: -i/--image the RGB test image, otherwise a synthetic 1080p
+ * frame is used; -n/--iterations the number of iterations.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication::setOrganizationName("EPFL-LSRO-Mobots");
+    QCoreApplication::setOrganizationDomain("mobots.epfl.ch");
+    QCoreApplication::setApplicationName("CATS2-tracking-benchmark");
+
+    QCoreApplication app(argc, argv);
+
+    QString imagePath;
+    bool foundImage = (CommandLineParser::parseArgument(argc, argv, "-i", imagePath) ||
+                       CommandLineParser::parseArgument(argc, argv, "--image", imagePath));
+    QString iterationsString;
+    int iterations = 100;
+    if (CommandLineParser::parseArgument(argc, argv, "-n", iterationsString) ||
+            CommandLineParser::parseArgument(argc, argv, "--iterations", iterationsString))
+        iterations = qMax(iterationsString.toInt(), 1);
+
+    cv::Mat frame;
+    if (foundImage) {
+        cv::Mat image = cv::imread(imagePath.toStdString());
+        if (image.data == nullptr) {
+            qDebug() << "Could not read the image" << imagePath;
+            return -1;
+        }
+        // the frames are RGB in the tracking
+        cv::cvtColor(image, frame, CV_BGR2RGB);
+    } else {
+        frame = syntheticFrame();
+    }
+
+    benchmarkHsvThreshold(frame, iterations);
+    benchmarkBackgroundModels(frame, iterations);
+    benchmarkAgentsMerging(iterations);
+
+    return 0;
+}
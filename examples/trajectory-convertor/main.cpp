@@ -10,11 +10,13 @@
 #include <GrabberHandler.hpp>
 #include <gui/ViewerWindow.hpp>
 #include <AgentState.hpp>
+#include <TrajectoryFile.hpp>
 
 #include <QGst/Init>
 
 #include <QtWidgets/QApplication>
 #include <QtCore/QDebug>
+#include <QtCore/QFileInfo>
 
 /*!
  * Extracts a trajectory for one fish from the idTracker resulted file.
@@ -25,6 +27,23 @@ int main(int argc, char *argv[])
     QApplication::setOrganizationDomain("mobots.epfl.ch");
     QApplication::setApplicationName("CATS2-trajectory-convertor");
 
+    // the binary trajectory file written by the tracking is converted to the
+    // tab-separated text file next to it, no settings are needed; it's done
+    // before the GStreamer and the gui are initialized to work without display
+    QString binaryFilePath;
+    if (CommandLineParser::parseArgument(argc, argv, "-b", binaryFilePath) ||
+        CommandLineParser::parseArgument(argc, argv, "--binary", binaryFilePath))
+    {
+        QFileInfo binaryFileInfo(binaryFilePath);
+        QString textFilePath = binaryFileInfo.absolutePath() + "/" +
+                binaryFileInfo.completeBaseName() + ".txt";
+        int frames = TrajectoryFile::convertToText(binaryFilePath, textFilePath);
+        if (frames < 0)
+            return -1;
+        qDebug() << "Converted" << frames << "frames to" << textFilePath;
+        return 0;
+    }
+
     QGst::init(nullptr, nullptr);
     QApplication app(argc, argv);
 
@@ -9,6 +9,8 @@
 #include <settings/CommandLineParameters.hpp>
 
 #include <TrackingSetup.hpp>
+#include <GrabCoordinator.hpp>
+#include <settings/GrabberSettings.hpp>
 #include <TrackingDataManager.hpp>
 #include <ViewerHandler.hpp>
 #include <ViewerData.hpp>
@@ -47,6 +49,13 @@ MainWindow::MainWindow(QWidget *parent) :
     // create the tracking data manager
     QString path = Registry::get().dataLoggingPath();
     m_trackingDataManager = TrackingDataManagerPtr(new TrackingDataManager(path));
+    // the trajectory file is closed before the application quits, hence the
+    // results are written even if the data manager outlives the event loop
+    connect(qApp, &QCoreApplication::aboutToQuit,
+            m_trackingDataManager.data(), &TrackingDataManager::stop);
+    // the application is closed when the replayed videos are finished
+    connect(m_trackingDataManager.data(), &TrackingDataManager::trackingFinished,
+            qApp, &QCoreApplication::quit);
 
     // create the inter-species data manager
     if (CommandLineParameters::get().useInterSpacesModule()) {
@@ -76,6 +85,14 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(m_ui->actionStopAllRobots, &QAction::triggered,
             m_robotsHandler->contolLoop().data(), &ControlLoop::stopAllRobots);
 
+    // synchronize the cameras if requested
+    FrameSetsDescription frameSets = GrabberSettings::get().frameSets();
+    if (frameSets.enabled &&
+            Settings::get().isAvailable(SetupType::MAIN_CAMERA) &&
+            Settings::get().isAvailable(SetupType::CAMERA_BELOW)) {
+        m_grabCoordinator = GrabCoordinatorPtr(new GrabCoordinator(std::chrono::milliseconds(frameSets.maxSkewMs)));
+    }
+
     // create setups
     if (Settings::get().isAvailable(SetupType::MAIN_CAMERA)) {
         createSetup(SetupType::MAIN_CAMERA);
@@ -93,6 +110,10 @@ MainWindow::MainWindow(QWidget *parent) :
             setSecondaryView(SetupType::CAMERA_BELOW);
     }
 
+    // all the cameras are added, the synchronization can start
+    if (!m_grabCoordinator.isNull())
+        m_grabCoordinator->start();
+
     // connecting to inter-species
     if (CommandLineParameters::get().useInterSpacesModule()) {
         connect(m_robotsHandler->contolLoop().data(),
@@ -138,7 +159,7 @@ void MainWindow::createSetup(SetupType::Enum setupType)
     // create the tracking setup.
     bool needOutputQueue = true;
     m_trackingSetups[setupType] =
-            TrackingSetupPtr(new TrackingSetup(setupType, needOutputQueue));
+            TrackingSetupPtr(new TrackingSetup(setupType, needOutputQueue, m_grabCoordinator));
 
     // create the viewer
     m_viewerHandlers[setupType] =
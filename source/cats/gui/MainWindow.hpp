@@ -2,6 +2,7 @@
 #define CATS2_MAIN_WINDOW_HPP
 
 #include <TrackerPointerTypes.hpp>
+#include <HubPointerTypes.hpp>
 #include <ViewerPointerTypes.hpp>
 #include <RobotControlPointerTypes.hpp>
 #include <SetupType.hpp>
@@ -54,6 +55,9 @@ private:
     //! The secondary setup view to be shown on the side of the window.
     SetupType::Enum m_secondarySetupType;
 
+    //! The coordinator that synchronizes the cameras, it's created only when
+    //! requested in the settings.
+    GrabCoordinatorPtr m_grabCoordinator;
     //! The tracking setups.
     QMap<SetupType::Enum, TrackingSetupPtr> m_trackingSetups;
     //! The viewers for the corresponding setups.
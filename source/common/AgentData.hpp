@@ -53,10 +53,10 @@ struct TimestampedImageAgentsData
 {
     //! The agent's data.
     QList<AgentDataImage> agentsData;
-    //! The corresponding timestamp, in number of milliseconds since 1970-01-01T00:00:00
-    //! Universal Coordinated Time. The timestamp is used to combine the tracking results
-    //! from different concurrent trackers.
-    std::chrono::milliseconds timestamp;
+    //! The corresponding timestamp, in number of microseconds since 1970-01-01T00:00:00
+    //! Universal Coordinated Time, see TimestampClock. The timestamp is used to combine
+    //! the tracking results from different concurrent trackers.
+    std::chrono::microseconds timestamp;
 };
 
 /*!
@@ -102,9 +102,9 @@ struct TimestampedWorldAgentsData
 {
     //! The agent's data.
     QList<AgentDataWorld> agentsData;
-    //! The corresponding timestamp, in number of milliseconds since 1970-01-01T00:00:00
-    //! Universal Coordinated Time. The timestamp is used to combine the tracking results
-    //! from different concurrent trackers.
-    std::chrono::milliseconds timestamp;
+    //! The corresponding timestamp, in number of microseconds since 1970-01-01T00:00:00
+    //! Universal Coordinated Time, see TimestampClock. The timestamp is used to combine
+    //! the tracking results from different concurrent trackers.
+    std::chrono::microseconds timestamp;
 };
 #endif // CATS2_AGENT_DATA_HPP
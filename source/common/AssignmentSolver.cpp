@@ -0,0 +1,132 @@
+#include "AssignmentSolver.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr double AssignmentSolver::Forbidden;
+
+/*!
+ * Returns the column matched to every row, or -1 if the row is not matched.
+ * The forbidden pairs are replaced by a cost bigger than any matching made of
+ * the allowed pairs, thus the solution first maximizes the number of the
+ * allowed pairs and then minimizes their cost; the forbidden pairs are removed
+ * from the solution afterwards.
+ */
+std::vector<int> AssignmentSolver::solve(const cv::Mat_<double>& costs)
+{
+    std::vector<int> assignment(costs.rows, -1);
+    if (costs.empty())
+        return assignment;
+
+    double maxCost = -1;
+    for (int row = 0; row < costs.rows; ++row) {
+        for (int column = 0; column < costs.cols; ++column) {
+            double cost = costs(row, column);
+            if (std::isfinite(cost))
+                maxCost = std::max(maxCost, cost);
+        }
+    }
+    // all the pairs are forbidden
+    if (maxCost < 0)
+        return assignment;
+
+    // the algorithm needs no more rows than columns
+    bool transposed = (costs.rows > costs.cols);
+    cv::Mat_<double> finiteCosts = transposed ? cv::Mat_<double>(costs.t()) : costs.clone();
+    double forbiddenCost = (maxCost + 1) * (std::min(costs.rows, costs.cols) + 1);
+    for (int row = 0; row < finiteCosts.rows; ++row) {
+        double* rowCosts = finiteCosts[row];
+        for (int column = 0; column < finiteCosts.cols; ++column) {
+            if (!std::isfinite(rowCosts[column]))
+                rowCosts[column] = forbiddenCost;
+        }
+    }
+
+    std::vector<int> matches = solveRowsToColumns(finiteCosts);
+    for (int index = 0; index < static_cast<int>(matches.size()); ++index) {
+        int match = matches[index];
+        if (match < 0)
+            continue;
+        int row = transposed ? match : index;
+        int column = transposed ? index : match;
+        if (std::isfinite(costs(row, column)))
+            assignment[row] = column;
+    }
+    return assignment;
+}
+
+/*!
+ * Solves the problem for the matrix with no more rows than columns. The rows
+ * are added one by one, every time the shortest augmenting path is found
+ * while the potentials of the rows and the columns are updated to keep the
+ * reduced costs non-negative. The indices are shifted by one internally, the
+ * column 0 is the fictive column where the new row starts.
+ */
+std::vector<int> AssignmentSolver::solveRowsToColumns(const cv::Mat_<double>& costs)
+{
+    const int rows = costs.rows;
+    const int columns = costs.cols;
+    const double infinity = std::numeric_limits<double>::max();
+
+    // the potentials
+    std::vector<double> rowPotentials(rows + 1, 0);
+    std::vector<double> columnPotentials(columns + 1, 0);
+    // the row matched to every column
+    std::vector<int> columnMatches(columns + 1, 0);
+    // the previous column on the augmenting path
+    std::vector<int> previousColumns(columns + 1, 0);
+    std::vector<double> minReducedCosts(columns + 1);
+    std::vector<char> visited(columns + 1);
+
+    for (int row = 1; row <= rows; ++row) {
+        columnMatches[0] = row;
+        int currentColumn = 0;
+        std::fill(minReducedCosts.begin(), minReducedCosts.end(), infinity);
+        std::fill(visited.begin(), visited.end(), false);
+
+        // search for the free column
+        do {
+            visited[currentColumn] = true;
+            int currentRow = columnMatches[currentColumn];
+            const double* rowCosts = costs[currentRow - 1];
+            double delta = infinity;
+            int nextColumn = 0;
+            for (int column = 1; column <= columns; ++column) {
+                if (visited[column])
+                    continue;
+                double reducedCost = rowCosts[column - 1] - rowPotentials[currentRow] - columnPotentials[column];
+                if (reducedCost < minReducedCosts[column]) {
+                    minReducedCosts[column] = reducedCost;
+                    previousColumns[column] = currentColumn;
+                }
+                if (minReducedCosts[column] < delta) {
+                    delta = minReducedCosts[column];
+                    nextColumn = column;
+                }
+            }
+            for (int column = 0; column <= columns; ++column) {
+                if (visited[column]) {
+                    rowPotentials[columnMatches[column]] += delta;
+                    columnPotentials[column] -= delta;
+                } else {
+                    minReducedCosts[column] -= delta;
+                }
+            }
+            currentColumn = nextColumn;
+        } while (columnMatches[currentColumn] != 0);
+
+        // invert the augmenting path
+        do {
+            int previousColumn = previousColumns[currentColumn];
+            columnMatches[currentColumn] = columnMatches[previousColumn];
+            currentColumn = previousColumn;
+        } while (currentColumn != 0);
+    }
+
+    std::vector<int> rowMatches(rows, -1);
+    for (int column = 1; column <= columns; ++column) {
+        if (columnMatches[column] != 0)
+            rowMatches[columnMatches[column] - 1] = column - 1;
+    }
+    return rowMatches;
+}
@@ -0,0 +1,36 @@
+#ifndef CATS2_ASSIGNMENT_SOLVER_HPP
+#define CATS2_ASSIGNMENT_SOLVER_HPP
+
+#include <opencv2/core/core.hpp>
+
+#include <limits>
+#include <vector>
+
+/*!
+ * Solves the linear assignment problem: matches the rows of a costs matrix to
+ * its columns so that the total cost is minimal, every row and every column
+ * being used at most once. The matrix can be rectangular, then only the
+ * smaller dimension is fully matched. The pairs with the forbidden cost are
+ * never matched, the other costs must be non-negative.
+ *
+ * Implements the Hungarian algorithm with the potentials, its complexity is
+ * O(n^2 m) for the n x m matrix, n <= m.
+ */
+class AssignmentSolver
+{
+public:
+    //! The cost of the pairs that can not be matched.
+    static constexpr double Forbidden = std::numeric_limits<double>::infinity();
+
+public:
+    //! Returns the column matched to every row, or -1 if the row is not
+    //! matched.
+    static std::vector<int> solve(const cv::Mat_<double>& costs);
+
+private:
+    //! Solves the problem for the matrix with no more rows than columns,
+    //! all the costs are finite.
+    static std::vector<int> solveRowsToColumns(const cv::Mat_<double>& costs);
+};
+
+#endif // CATS2_ASSIGNMENT_SOLVER_HPP
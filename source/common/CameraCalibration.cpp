@@ -2,6 +2,12 @@
 #include "settings/ReadSettingsHelper.hpp"
 #include "AgentState.hpp"
 
+#include <cmath>
+
+constexpr int CameraCalibration::LookupGridStepPx;
+constexpr double CameraCalibration::OrientationVectorLengthPx;
+constexpr double CameraCalibration::OrientationVectorLengthMeters;
+
 /*!
  * Constructor. Gets the file name containing the camera calibration data.
  */
@@ -128,6 +134,9 @@ void CameraCalibration::calibrate(QString calibrationFileName, QSize targetFrame
     m_rotationMatrixInvCameraMatrixInv = rotationMatrix.inv() * m_optimalCameraMatrix.inv();
     m_rotationMatrixInvTranslationVector = rotationMatrix.inv() * m_tvec;
 
+    // precompute the image to world conversion on the frame
+    buildLookupGrid(targetFrameSize);
+
     // image to world error
     error = 0;
     for (unsigned int i = 0; i < imagePoints.size(); i++) {
@@ -149,68 +158,295 @@ void CameraCalibration::calibrate(QString calibrationFileName, QSize targetFrame
 }
 
 /*!
- * Converts the position in pixels to the position in meters. The z is considered equal to zero.
+ * Computes the world positions of the lookup grid's nodes. The grid covers the
+ * target frame, its last row and column are on or beyond the frame's border.
+ */
+void CameraCalibration::buildLookupGrid(QSize targetFrameSize)
+{
+    int columns = targetFrameSize.width() / LookupGridStepPx + 2;
+    int rows = targetFrameSize.height() / LookupGridStepPx + 2;
+
+    std::vector<cv::Point2f> nodes;
+    nodes.reserve(rows * columns);
+    for (int row = 0; row < rows; row++)
+        for (int column = 0; column < columns; column++)
+            nodes.push_back(cv::Point2f(column * LookupGridStepPx, row * LookupGridStepPx));
+
+    std::vector<cv::Point2d> worldNodes = imageToWorldPrecise(nodes);
+    m_imageToWorldGrid.create(rows, columns);
+    for (int row = 0; row < rows; row++) {
+        cv::Vec2d* gridRow = m_imageToWorldGrid[row];
+        for (int column = 0; column < columns; column++) {
+            const cv::Point2d& worldNode = worldNodes[row * columns + column];
+            gridRow[column] = cv::Vec2d(worldNode.x, worldNode.y);
+        }
+    }
+}
+
+/*!
+ * Converts the points in the target frame pixels to the world positions in
+ * meters. The z is considered equal to the camera height.
  */
-PositionMeters CameraCalibration::imageToWorld(PositionPixels imageCoordinates)
+std::vector<cv::Point2d> CameraCalibration::imageToWorldPrecise(const std::vector<cv::Point2f>& imagePoints) const
 {
-    // find the undistorted image position
-    std::vector<cv::Point2f> imagePoint;
-    // we scale the image point to correspond to the calibration data
-    imagePoint.push_back(cv::Point2f(imageCoordinates.x() / m_imageScaleCoefficientX,
-                                     imageCoordinates.y() / m_imageScaleCoefficientY));
-    std::vector<cv::Point2f> undistortedImagePoint;
-    cv::undistortPoints(imagePoint, undistortedImagePoint,
+    std::vector<cv::Point2d> worldPoints;
+    if (imagePoints.empty())
+        return worldPoints;
+
+    // find the undistorted image positions
+    std::vector<cv::Point2f> scaledImagePoints;
+    scaledImagePoints.reserve(imagePoints.size());
+    // we scale the image points to correspond to the calibration data
+    for (const cv::Point2f& imagePoint : imagePoints)
+        scaledImagePoints.push_back(cv::Point2f(imagePoint.x / m_imageScaleCoefficientX,
+                                                imagePoint.y / m_imageScaleCoefficientY));
+    std::vector<cv::Point2f> undistortedImagePoints;
+    cv::undistortPoints(scaledImagePoints, undistortedImagePoints,
                         m_cameraMatrix, m_distortionCoefficients,
                         cv::Mat(), m_optimalCameraMatrix);
 
-    cv::Mat uvPoint = cv::Mat::ones(3, 1, cv::DataType<double>::type); //u,v,1
-    uvPoint.at<double>(0,0) = undistortedImagePoint.at(0).x;
-    uvPoint.at<double>(1,0) = undistortedImagePoint.at(0).y;
-
     // s * a = [wx wy wz]' + b, where a = R^{-1}*M^{-1}*[u v 1]', b = R^{-1}*t
-    cv::Mat vectorA = m_rotationMatrixInvCameraMatrixInv * uvPoint;
+    const cv::Mat_<double> matrixA(m_rotationMatrixInvCameraMatrixInv);
+    const cv::Mat_<double> vectorB(m_rotationMatrixInvTranslationVector);
     // TODO : to check if it works better when the height of the agent is taken into account
     double wz = m_cameraHeight /*- m_agentHeight*/;
-    double s = wz + m_rotationMatrixInvTranslationVector.at<double>(2, 0);
-    s /= vectorA.at<double>(2, 0);
 
-    double wx = s * vectorA.at<double>(0, 0) - m_rotationMatrixInvTranslationVector.at<double>(0, 0);
-    double wy = s * vectorA.at<double>(1, 0) - m_rotationMatrixInvTranslationVector.at<double>(1, 0);
+    worldPoints.reserve(undistortedImagePoints.size());
+    for (const cv::Point2f& uvPoint : undistortedImagePoints) {
+        double ax = matrixA(0, 0) * uvPoint.x + matrixA(0, 1) * uvPoint.y + matrixA(0, 2);
+        double ay = matrixA(1, 0) * uvPoint.x + matrixA(1, 1) * uvPoint.y + matrixA(1, 2);
+        double az = matrixA(2, 0) * uvPoint.x + matrixA(2, 1) * uvPoint.y + matrixA(2, 2);
+        double s = (wz + vectorB(2, 0)) / az;
+
+        double wx = s * ax - vectorB(0, 0);
+        double wy = s * ay - vectorB(1, 0);
+
+        // NOTE : (1) the Z-coordinate is not set is we work in 2D world
+        // (2) the calibration data is set in mm, hence the division
+        worldPoints.push_back(cv::Point2d(m_xInversionCoefficient * wx / 1000.,
+                                          m_yInversionCoefficient * wy / 1000.));
+    }
+    return worldPoints;
+}
+
+/*!
+ * Interpolates bilinearly the world position between the four nodes of the
+ * lookup grid surrounding the point. Returns false if the point is outside of
+ * the grid.
+ */
+bool CameraCalibration::lookUpWorldPosition(double x, double y, cv::Point2d& worldPoint) const
+{
+    double gridX = x / LookupGridStepPx;
+    double gridY = y / LookupGridStepPx;
+    // NOTE : the negated comparisons also reject the NaN values
+    if (!((gridX >= 0) && (gridY >= 0) &&
+          (gridX < m_imageToWorldGrid.cols - 1) && (gridY < m_imageToWorldGrid.rows - 1)))
+        return false;
+
+    int column = static_cast<int>(gridX);
+    int row = static_cast<int>(gridY);
+    double dx = gridX - column;
+    double dy = gridY - row;
+
+    const cv::Vec2d* topRow = m_imageToWorldGrid[row];
+    const cv::Vec2d* bottomRow = m_imageToWorldGrid[row + 1];
+    cv::Vec2d top = topRow[column] * (1 - dx) + topRow[column + 1] * dx;
+    cv::Vec2d bottom = bottomRow[column] * (1 - dx) + bottomRow[column + 1] * dx;
+    cv::Vec2d world = top * (1 - dy) + bottom * dy;
+    worldPoint = cv::Point2d(world[0], world[1]);
+    return true;
+}
+
+/*!
+ * Converts the position in pixels to the position in meters. The lookup grid
+ * is used inside the frame, the precise conversion outside of it.
+ */
+PositionMeters CameraCalibration::imageToWorld(PositionPixels imageCoordinates) const
+{
+    cv::Point2d worldPoint;
+    if (lookUpWorldPosition(imageCoordinates.x(), imageCoordinates.y(), worldPoint))
+        return PositionMeters(worldPoint.x, worldPoint.y);
+    return imageToWorldPrecise(imageCoordinates);
+}
+
+/*!
+ * Converts the position in pixels to the position in meters. The z is considered
+ * equal to the camera height.
+ */
+PositionMeters CameraCalibration::imageToWorldPrecise(PositionPixels imageCoordinates) const
+{
+    std::vector<cv::Point2d> worldPoints =
+            imageToWorldPrecise(std::vector<cv::Point2f>({cv::Point2f(imageCoordinates.x(), imageCoordinates.y())}));
+    return PositionMeters(worldPoints.front().x, worldPoints.front().y);
+}
+
+/*!
+ * Converts the points in the target frame pixels to the world positions in
+ * meters. The points are interpolated in the lookup grid, those that are
+ * outside of the grid are converted together by the precise conversion.
+ */
+std::vector<cv::Point2d> CameraCalibration::imageToWorldPoints(const std::vector<cv::Point2d>& imagePoints) const
+{
+    std::vector<cv::Point2d> worldPoints(imagePoints.size());
+    std::vector<size_t> outsidePointIndices;
+    std::vector<cv::Point2f> outsidePoints;
+    for (size_t index = 0; index < imagePoints.size(); index++) {
+        if (!lookUpWorldPosition(imagePoints[index].x, imagePoints[index].y, worldPoints[index])) {
+            outsidePointIndices.push_back(index);
+            outsidePoints.push_back(cv::Point2f(imagePoints[index]));
+        }
+    }
+    std::vector<cv::Point2d> outsideWorldPoints = imageToWorldPrecise(outsidePoints);
+    for (size_t index = 0; index < outsidePointIndices.size(); index++)
+        worldPoints[outsidePointIndices[index]] = outsideWorldPoints[index];
+    return worldPoints;
+}
+
+/*!
+ * Converts the world positions in meters to the points in the target frame
+ * pixels, all the points are projected at once.
+ */
+std::vector<cv::Point2d> CameraCalibration::worldToImagePoints(const std::vector<cv::Point2d>& worldPoints) const
+{
+    std::vector<cv::Point2d> imagePoints;
+    if (worldPoints.empty())
+        return imagePoints;
+
+    std::vector<cv::Point3f> scaledWorldPoints;
+    scaledWorldPoints.reserve(worldPoints.size());
+    for (const cv::Point2d& worldPoint : worldPoints) {
+        // HACK : since only "x" and "y" are sinchronized between the top and bottom setus,
+        // the "z" value is to be set  to the "agent height" specific for this setup
+        // TODO : to check if it works better when the height of the agent is taken into account
+        // the calibration data is set in mm, hence the multiplication to change from meters
+        scaledWorldPoints.push_back(cv::Point3f(m_xInversionCoefficient * worldPoint.x * 1000,
+                                                m_yInversionCoefficient * worldPoint.y * 1000,
+                                                m_cameraHeight /*- m_agentHeight*/));
+    }
+    std::vector<cv::Point2f> projectedPoints;
+    cv::projectPoints(scaledWorldPoints, m_rvec, m_tvec, m_cameraMatrix, m_distortionCoefficients, projectedPoints);
+
+    imagePoints.reserve(projectedPoints.size());
+    for (const cv::Point2f& projectedPoint : projectedPoints)
+        imagePoints.push_back(cv::Point2d(m_imageScaleCoefficientX * projectedPoint.x,
+                                          m_imageScaleCoefficientY * projectedPoint.y));
+    return imagePoints;
+}
 
-    // NOTE : (1) the Z-coordinate is not set is we work in 2D world
-    // (2) the calibration data is set in mm, hence the division
-    PositionMeters worldCoordinates(m_xInversionCoefficient * wx / 1000.,
-                                    m_yInversionCoefficient * wy / 1000.);
-    return worldCoordinates;
+/*!
+ * Converts the positions from image to world.
+ */
+QList<PositionMeters> CameraCalibration::imageToWorld(const QList<PositionPixels>& imagePositions) const
+{
+    std::vector<cv::Point2d> imagePoints;
+    imagePoints.reserve(imagePositions.size());
+    for (const PositionPixels& imagePosition : imagePositions)
+        imagePoints.push_back(cv::Point2d(imagePosition.x(), imagePosition.y()));
+
+    QList<PositionMeters> worldPositions;
+    worldPositions.reserve(imagePositions.size());
+    for (const cv::Point2d& worldPoint : imageToWorldPoints(imagePoints))
+        worldPositions.append(PositionMeters(worldPoint.x, worldPoint.y));
+    return worldPositions;
+}
+
+/*!
+ * Converts the states from image to world. The positions and the ends of the
+ * orientation vectors are converted together. The validity of the states is
+ * not treated here.
+ */
+QList<StateWorld> CameraCalibration::imageToWorld(const QList<StateImage>& imageStates) const
+{
+    // the positions of the agents followed by the ends of their orientation vectors
+    std::vector<cv::Point2d> imagePoints;
+    imagePoints.reserve(2 * imageStates.size());
+    for (const StateImage& imageState : imageStates)
+        imagePoints.push_back(cv::Point2d(imageState.position().x(), imageState.position().y()));
+    for (const StateImage& imageState : imageStates) {
+        double angle = imageState.orientation().angleRad();
+        imagePoints.push_back(cv::Point2d(imageState.position().x() + OrientationVectorLengthPx * std::cos(angle),
+                                          imageState.position().y() + OrientationVectorLengthPx * std::sin(angle)));
+    }
+    std::vector<cv::Point2d> worldPoints = imageToWorldPoints(imagePoints);
+
+    QList<StateWorld> worldStates;
+    worldStates.reserve(imageStates.size());
+    size_t size = static_cast<size_t>(imageStates.size());
+    for (size_t index = 0; index < size; index++) {
+        const cv::Point2d& position = worldPoints[index];
+        const cv::Point2d& endPoint = worldPoints[size + index];
+        worldStates.append(StateWorld(PositionMeters(position.x, position.y),
+                                      OrientationRad(atan2(endPoint.y - position.y, endPoint.x - position.x))));
+    }
+    return worldStates;
 }
 
 /*!
  * Converts the position in meters to the position in pixels.
  */
-PositionPixels CameraCalibration::worldToImage(PositionMeters worldCoordinates)
+PositionPixels CameraCalibration::worldToImage(PositionMeters worldCoordinates) const
 {
-    std::vector<cv::Point2f> projectedPoint;
-    std::vector<cv::Point3f> worldPoint;
-    // HACK : since only "x" and "y" are sinchronized between the top and bottom setus,
-    // the "z" value is to be set  to the "agent height" specific for this setup
-    // TODO : to check if it works better when the height of the agent is taken into account
-    worldCoordinates.setZ(m_cameraHeight /*- m_agentHeight*/);
-    // the calibration data is set in mm, hence the multiplication to change from meters
-    worldPoint.push_back(cv::Point3f(m_xInversionCoefficient * worldCoordinates.x() * 1000,
-                                     m_yInversionCoefficient * worldCoordinates.y() * 1000,
-                                     worldCoordinates.z()/* * 1000*/));
-    cv::projectPoints(worldPoint, m_rvec, m_tvec, m_cameraMatrix, m_distortionCoefficients, projectedPoint);
-    return PositionPixels(m_imageScaleCoefficientX * projectedPoint[0].x, m_imageScaleCoefficientY * projectedPoint[0].y);
+    std::vector<cv::Point2d> imagePoints =
+            worldToImagePoints(std::vector<cv::Point2d>({cv::Point2d(worldCoordinates.x(), worldCoordinates.y())}));
+    return PositionPixels(imagePoints.front().x, imagePoints.front().y);
+}
+
+/*!
+ * Converts the positions from world to image, all the positions are
+ * projected at once.
+ */
+QList<PositionPixels> CameraCalibration::worldToImage(const QList<PositionMeters>& worldPositions) const
+{
+    std::vector<cv::Point2d> worldPoints;
+    worldPoints.reserve(worldPositions.size());
+    for (const PositionMeters& worldPosition : worldPositions)
+        worldPoints.push_back(cv::Point2d(worldPosition.x(), worldPosition.y()));
+
+    QList<PositionPixels> imagePositions;
+    imagePositions.reserve(worldPositions.size());
+    for (const cv::Point2d& imagePoint : worldToImagePoints(worldPoints))
+        imagePositions.append(PositionPixels(imagePoint.x, imagePoint.y));
+    return imagePositions;
+}
+
+/*!
+ * Converts the states from world to image. The positions and the ends of the
+ * orientation vectors are projected at once. The validity of the states is
+ * not treated here.
+ */
+QList<StateImage> CameraCalibration::worldToImage(const QList<StateWorld>& worldStates) const
+{
+    // the positions of the agents followed by the ends of their orientation vectors
+    std::vector<cv::Point2d> worldPoints;
+    worldPoints.reserve(2 * worldStates.size());
+    for (const StateWorld& worldState : worldStates)
+        worldPoints.push_back(cv::Point2d(worldState.position().x(), worldState.position().y()));
+    for (const StateWorld& worldState : worldStates) {
+        double angle = worldState.orientation().angleRad();
+        worldPoints.push_back(cv::Point2d(worldState.position().x() + OrientationVectorLengthMeters * std::cos(angle),
+                                          worldState.position().y() + OrientationVectorLengthMeters * std::sin(angle)));
+    }
+    std::vector<cv::Point2d> imagePoints = worldToImagePoints(worldPoints);
+
+    QList<StateImage> imageStates;
+    imageStates.reserve(worldStates.size());
+    size_t size = static_cast<size_t>(worldStates.size());
+    for (size_t index = 0; index < size; index++) {
+        const cv::Point2d& position = imagePoints[index];
+        const cv::Point2d& endPoint = imagePoints[size + index];
+        imageStates.append(StateImage(PositionPixels(position.x, position.y),
+                                      OrientationRad(atan2(endPoint.y - position.y, endPoint.x - position.x))));
+    }
+    return imageStates;
 }
 
 /*!
  * Converts the orientation at given position from image to world.
  */
-OrientationRad CameraCalibration::imageToWorldOrientation(PositionPixels imageCoordinates, OrientationRad imageOrientation)
+OrientationRad CameraCalibration::imageToWorldOrientation(PositionPixels imageCoordinates, OrientationRad imageOrientation) const
 {
-    double vectorLength = 50; // px, empirical constant
-    double u = imageCoordinates.x() + vectorLength * cos(imageOrientation.angleRad()); // a vector in  image coordinates
-    double v = imageCoordinates.y() + vectorLength * sin(imageOrientation.angleRad());
+    double u = imageCoordinates.x() + OrientationVectorLengthPx * cos(imageOrientation.angleRad()); // a vector in  image coordinates
+    double v = imageCoordinates.y() + OrientationVectorLengthPx * sin(imageOrientation.angleRad());
     PositionPixels imageEndPoint(u, v);
 
     PositionMeters worldCoordinates = imageToWorld(imageCoordinates);
@@ -223,11 +459,10 @@ OrientationRad CameraCalibration::imageToWorldOrientation(PositionPixels imageCo
 /*!
  * Converts the orientation at given position from world to image.
  */
-OrientationRad CameraCalibration::worldToImageOrientation(PositionMeters worldCoordinates, OrientationRad worldOrientation)
+OrientationRad CameraCalibration::worldToImageOrientation(PositionMeters worldCoordinates, OrientationRad worldOrientation) const
 {
-    double vectorLength = 0.1; // [m], empirical constant
-    double wx = worldCoordinates.x() + vectorLength * cos(worldOrientation.angleRad()); // a vector in  image coordinates
-    double wy = worldCoordinates.y() + vectorLength * sin(worldOrientation.angleRad());
+    double wx = worldCoordinates.x() + OrientationVectorLengthMeters * cos(worldOrientation.angleRad()); // a vector in  image coordinates
+    double wy = worldCoordinates.y() + OrientationVectorLengthMeters * sin(worldOrientation.angleRad());
 
     PositionMeters worldEndPoint(wx, wy, worldCoordinates.z());
 
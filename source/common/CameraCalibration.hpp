@@ -11,8 +11,8 @@
 class PositionPixels;
 class PositionMeters;
 class OrientationRad;
-
-// TODO : needs unit testing.
+class StateImage;
+class StateWorld;
 
 /*!
  * \brief The CameraCalibration class serves to compute the camera's parameters that are
@@ -20,6 +20,8 @@ class OrientationRad;
   * Current implementation uses the OpenCV based calibration routine. The camera parameters
   * are computed wiht the help of the chessboard and then the calibration points are used
   * to synchronize both setups.
+  * The calibration is not modified after the construction, thus the conversions
+  * can be called from several threads at once.
  */
 class CameraCalibration
 {
@@ -29,16 +31,31 @@ public:
     //! Destructor.
     virtual ~CameraCalibration() final;
 
-    //! Converts the position in pixels to the position in meters.
-    PositionMeters imageToWorld(PositionPixels imageCoordinates);
+    //! Converts the position in pixels to the position in meters. Inside the
+    //! frame the precomputed lookup grid is interpolated.
+    PositionMeters imageToWorld(PositionPixels imageCoordinates) const;
+    //! Converts the position in pixels to the position in meters by undistorting
+    //! the point and projecting it on the world plane. It's the reference for
+    //! the lookup grid.
+    PositionMeters imageToWorldPrecise(PositionPixels imageCoordinates) const;
     //! Converts the position in meters to the position in pixels.
-    PositionPixels worldToImage(PositionMeters worldCoordinates);
+    PositionPixels worldToImage(PositionMeters worldCoordinates) const;
 
     //! Converts the orientation at given position from image to world.
-    //! FIXME : this method calls imageToWorldPosition() and so it is not optimal to call both methods, need to be merged somehow.
-    OrientationRad imageToWorldOrientation(PositionPixels imageCoordinates, OrientationRad imageOrientationRad);
+    //! NOTE : this method converts the position as well, to convert both use the states' conversion.
+    OrientationRad imageToWorldOrientation(PositionPixels imageCoordinates, OrientationRad imageOrientationRad) const;
     //! Converts the orientation at given position from world to image.
-    OrientationRad worldToImageOrientation(PositionMeters worldCoordinates, OrientationRad worldOrientationRad);
+    OrientationRad worldToImageOrientation(PositionMeters worldCoordinates, OrientationRad worldOrientationRad) const;
+
+    //! Converts the positions from image to world.
+    QList<PositionMeters> imageToWorld(const QList<PositionPixels>& imagePositions) const;
+    //! Converts the positions from world to image.
+    QList<PositionPixels> worldToImage(const QList<PositionMeters>& worldPositions) const;
+    //! Converts the states from image to world, the lookup grid is used for
+    //! the positions and the orientations.
+    QList<StateWorld> imageToWorld(const QList<StateImage>& imageStates) const;
+    //! Converts the states from world to image.
+    QList<StateImage> worldToImage(const QList<StateWorld>& worldStates) const;
 
     bool isInitialized() const { return m_calibrationInitialized; }
 
@@ -64,6 +81,20 @@ private:
 
     //! Initializes the calibration.
     void calibrate(QString fileName, QSize targetFrameSize);
+    //! Computes the world positions of the lookup grid's nodes.
+    void buildLookupGrid(QSize targetFrameSize);
+    //! Converts the points in the target frame pixels to the world positions
+    //! in meters, all the points are undistorted at once.
+    std::vector<cv::Point2d> imageToWorldPrecise(const std::vector<cv::Point2f>& imagePoints) const;
+    //! Interpolates the world position in the lookup grid. Returns false if
+    //! the point is outside of the grid.
+    bool lookUpWorldPosition(double x, double y, cv::Point2d& worldPoint) const;
+    //! Converts the points in the target frame pixels to the world positions
+    //! in meters using the lookup grid.
+    std::vector<cv::Point2d> imageToWorldPoints(const std::vector<cv::Point2d>& imagePoints) const;
+    //! Converts the world positions in meters to the points in the target
+    //! frame pixels.
+    std::vector<cv::Point2d> worldToImagePoints(const std::vector<cv::Point2d>& worldPoints) const;
     //! Camera is calibrated.
     bool m_calibrationInitialized;
 
@@ -92,5 +123,15 @@ private:
     //! the target frame size, it need to be taken into account.
     double m_imageScaleCoefficientX;
     double m_imageScaleCoefficientY;
+
+    //! The world positions [m] of the nodes of the regular grid covering the
+    //! target frame, the node (i, j) corresponds to the pixel (j, i) * step.
+    cv::Mat_<cv::Vec2d> m_imageToWorldGrid;
+    //! The distance between the lookup grid's nodes.
+    static constexpr int LookupGridStepPx = 4; // [px]
+    //! The length of the vector used to convert the orientations from image to world.
+    static constexpr double OrientationVectorLengthPx = 50; // [px], empirical constant
+    //! The length of the vector used to convert the orientations from world to image.
+    static constexpr double OrientationVectorLengthMeters = 0.1; // [m], empirical constant
 };
 #endif // CATS2_TRACKER_CALIBRATOR_HPP
@@ -84,10 +84,98 @@ OrientationRad CoordinatesConversion::worldToImageOrientation(PositionMeters wor
     return orientation;
 }
 
+/*!
+ * Converts the positions from image to world. The positions keep the validity
+ * of the image positions.
+ */
+QList<PositionMeters> CoordinatesConversion::imageToWorldPositions(const QList<PositionPixels>& imagePositions) const
+{
+    QList<PositionMeters> worldPositions;
+    if (m_cameraCalibration->isInitialized()) {
+        worldPositions = m_cameraCalibration->imageToWorld(imagePositions);
+        for (int index = 0; index < worldPositions.size(); index++)
+            worldPositions[index].setValid(imagePositions.at(index).isValid());
+    } else {
+        qDebug() << "Conversion is not possible as the calibration is not initialized.";
+        for (int index = 0; index < imagePositions.size(); index++)
+            worldPositions.append(PositionMeters(0, 0, 0, false));
+    }
+    return worldPositions;
+}
+
+/*!
+ * Converts the positions from world to image. The positions keep the validity
+ * of the world positions.
+ */
+QList<PositionPixels> CoordinatesConversion::worldToImagePositions(const QList<PositionMeters>& worldPositions) const
+{
+    QList<PositionPixels> imagePositions;
+    if (m_cameraCalibration->isInitialized()) {
+        imagePositions = m_cameraCalibration->worldToImage(worldPositions);
+        for (int index = 0; index < imagePositions.size(); index++)
+            imagePositions[index].setValid(worldPositions.at(index).isValid());
+    } else {
+        qDebug() << "Conversion is not possible as the calibration is not initialized.";
+        for (int index = 0; index < worldPositions.size(); index++)
+            imagePositions.append(PositionPixels(0, 0, false));
+    }
+    return imagePositions;
+}
+
+/*!
+ * Converts the states from image to world. The positions and the orientations
+ * keep the validity of the image states.
+ */
+QList<StateWorld> CoordinatesConversion::imageToWorldStates(const QList<StateImage>& imageStates) const
+{
+    QList<StateWorld> worldStates;
+    if (m_cameraCalibration->isInitialized()) {
+        worldStates = m_cameraCalibration->imageToWorld(imageStates);
+        for (int index = 0; index < worldStates.size(); index++) {
+            const StateImage& imageState = imageStates.at(index);
+            PositionMeters position = worldStates[index].position();
+            position.setValid(imageState.position().isValid());
+            OrientationRad orientation = worldStates[index].orientation();
+            orientation.setValid(imageState.position().isValid() && imageState.orientation().isValid());
+            worldStates[index] = StateWorld(position, orientation);
+        }
+    } else {
+        qDebug() << "Conversion is not possible as the calibration is not initialized.";
+        for (int index = 0; index < imageStates.size(); index++)
+            worldStates.append(StateWorld());
+    }
+    return worldStates;
+}
+
+/*!
+ * Converts the states from world to image. The positions and the orientations
+ * keep the validity of the world states.
+ */
+QList<StateImage> CoordinatesConversion::worldToImageStates(const QList<StateWorld>& worldStates) const
+{
+    QList<StateImage> imageStates;
+    if (m_cameraCalibration->isInitialized()) {
+        imageStates = m_cameraCalibration->worldToImage(worldStates);
+        for (int index = 0; index < imageStates.size(); index++) {
+            const StateWorld& worldState = worldStates.at(index);
+            PositionPixels position = imageStates[index].position();
+            position.setValid(worldState.position().isValid());
+            OrientationRad orientation = imageStates[index].orientation();
+            orientation.setValid(worldState.position().isValid() && worldState.orientation().isValid());
+            imageStates[index] = StateImage(position, orientation);
+        }
+    } else {
+        qDebug() << "Conversion is not possible as the calibration is not initialized.";
+        for (int index = 0; index < worldStates.size(); index++)
+            imageStates.append(StateImage());
+    }
+    return imageStates;
+}
+
 /*!
  * Returns the status of the calibration initialization.
  */
-bool CoordinatesConversion::isValid()
+bool CoordinatesConversion::isValid() const
 {
     return m_cameraCalibration->isInitialized();
 }
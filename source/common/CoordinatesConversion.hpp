@@ -5,15 +5,19 @@
 
 #include <QtCore/QString>
 #include <QtCore/QSharedPointer>
+#include <QtCore/QList>
 
 class PositionPixels;
 class PositionMeters;
 class OrientationRad;
+class StateImage;
+class StateWorld;
 
 /*!
  * \brief The class that converts the position from the frame pixels
  * to the world coordinates in meters.
- * NOTE : this class is not thread-safe, so it should be used in the main thread only.
+ * The conversion is immutable after the construction and all its methods are
+ * const, hence it can be shared and used from several threads at once.
  */
 class CoordinatesConversion
 {
@@ -25,7 +29,7 @@ public:
 
 public:
     //! Returns the status of the calibration initialization.
-    bool isValid();
+    bool isValid() const;
     //! Converts the position in pixels to the position in meters.
     PositionMeters imageToWorldPosition(PositionPixels imageCoordinates) const;
     //! Converts the position in meters to the position in pixels.
@@ -36,9 +40,19 @@ public:
     //! Converts the orientation from world to image.
     OrientationRad worldToImageOrientation(PositionMeters worldCoordinates, OrientationRad worldOrientation) const;
 
+    //! Converts the positions from image to world in one call.
+    QList<PositionMeters> imageToWorldPositions(const QList<PositionPixels>& imagePositions) const;
+    //! Converts the positions from world to image in one call.
+    QList<PositionPixels> worldToImagePositions(const QList<PositionMeters>& worldPositions) const;
+    //! Converts the states from image to world in one call, it's faster than
+    //! converting the positions and the orientations one by one.
+    QList<StateWorld> imageToWorldStates(const QList<StateImage>& imageStates) const;
+    //! Converts the states from world to image in one call.
+    QList<StateImage> worldToImageStates(const QList<StateWorld>& worldStates) const;
+
 private:
     //! The object that calibrates the camera and basically makes the job of coordinates conversion.
-    CameraCalibrationPtr m_cameraCalibration;
+    const CameraCalibrationPtr m_cameraCalibration;
 };
 
 #endif // CATS2_COORDINATES_CONVERSION_HPP
@@ -0,0 +1,143 @@
+#include "MetricsRegistry.hpp"
+
+#include "TimestampedFrame.hpp"
+
+#include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
+
+const int MetricsRegistry::WindowPeriodMs = 1000;  // [ms]
+
+/*!
+ * The singleton getter.
+ */
+MetricsRegistry& MetricsRegistry::get()
+{
+    static MetricsRegistry instance;
+    return instance;
+}
+
+/*!
+ * Constructor.
+ */
+MetricsRegistry::MetricsRegistry() :
+    m_queues(),
+    m_values(),
+    m_mutex(),
+    m_stopped(false),
+    m_windowsMutex(),
+    m_windowsCondition()
+{
+    m_windowsThread = std::thread(&MetricsRegistry::runWindows, this);
+}
+
+/*!
+ * Destructor.
+ */
+MetricsRegistry::~MetricsRegistry()
+{
+    {
+        QMutexLocker locker(&m_windowsMutex);
+        m_stopped = true;
+        m_windowsCondition.wakeAll();
+    }
+    if (m_windowsThread.joinable())
+        m_windowsThread.join();
+}
+
+/*!
+ * Registers the queue under the given name.
+ */
+void MetricsRegistry::registerQueue(QString name, TimestampedFrameQueuePtr queue)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_queues.contains(name) && !m_queues[name].isNull())
+        qDebug() << QString("The queue %1 is already registered, replacing").arg(name);
+    m_queues[name] = queue.toWeakRef();
+}
+
+/*!
+ * Returns the statistics of all the alive registered queues. Taking the
+ * snapshots doesn't modify the statistics.
+ */
+QMap<QString, QueueMetrics::Snapshot> MetricsRegistry::queueSnapshots()
+{
+    QMap<QString, TimestampedFrameQueuePtr> queues = aliveQueues();
+    QMap<QString, QueueMetrics::Snapshot> snapshots;
+    for (auto it = queues.begin(); it != queues.end(); ++it)
+        snapshots[it.key()] = it.value()->metrics().snapshot();
+    return snapshots;
+}
+
+/*!
+ * Returns the alive registered queues, the strong references are taken to not
+ * block the registry while working with the queues.
+ */
+QMap<QString, TimestampedFrameQueuePtr> MetricsRegistry::aliveQueues()
+{
+    QMap<QString, TimestampedFrameQueuePtr> queues;
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_queues.begin(); it != m_queues.end(); ) {
+        TimestampedFrameQueuePtr queue = it.value().toStrongRef();
+        if (queue.isNull()) {
+            it = m_queues.erase(it);
+        } else {
+            queues[it.key()] = queue;
+            ++it;
+        }
+    }
+    return queues;
+}
+
+/*!
+ * Closes the statistics windows of all the queues every window period, until
+ * the registry is destroyed.
+ */
+void MetricsRegistry::runWindows()
+{
+    QMutexLocker locker(&m_windowsMutex);
+    while (!m_stopped) {
+        m_windowsCondition.wait(&m_windowsMutex, WindowPeriodMs);
+        if (m_stopped)
+            break;
+        QMap<QString, TimestampedFrameQueuePtr> queues = aliveQueues();
+        for (auto it = queues.begin(); it != queues.end(); ++it)
+            it.value()->metrics().closeWindow();
+    }
+}
+
+/*!
+ * Sets the named value.
+ */
+void MetricsRegistry::setValue(QString name, double value)
+{
+    QMutexLocker locker(&m_mutex);
+    m_values[name] = value;
+}
+
+/*!
+ * Returns all the metrics as the named values.
+ */
+QMap<QString, double> MetricsRegistry::values()
+{
+    QMap<QString, double> values;
+    {
+        QMutexLocker locker(&m_mutex);
+        values = m_values;
+    }
+
+    QMap<QString, QueueMetrics::Snapshot> snapshots = queueSnapshots();
+    for (auto it = snapshots.begin(); it != snapshots.end(); ++it) {
+        QString prefix = QString("queue/%1/").arg(it.key());
+        const QueueMetrics::Snapshot& snapshot = it.value();
+        values[prefix + "enqueueRateHz"] = snapshot.enqueueRateHz;
+        values[prefix + "dequeueRateHz"] = snapshot.dequeueRateHz;
+        values[prefix + "dropRateHz"] = snapshot.dropRateHz;
+        values[prefix + "dropped"] = snapshot.dropped;
+        values[prefix + "depth"] = snapshot.depth;
+        values[prefix + "meanAgeMs"] = snapshot.meanAgeMs;
+        values[prefix + "maxAgeMs"] = snapshot.maxAgeMs;
+        for (int bin = 0; bin < snapshot.depthHistogram.size(); ++bin)
+            values[prefix + QString("depthBin%1").arg(bin)] = snapshot.depthHistogram[bin];
+    }
+    return values;
+}
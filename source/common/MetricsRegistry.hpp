@@ -0,0 +1,86 @@
+#ifndef CATS2_METRICS_REGISTRY_HPP
+#define CATS2_METRICS_REGISTRY_HPP
+
+#include "CommonPointerTypes.hpp"
+#include "QueueMetrics.hpp"
+
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QWeakPointer>
+
+#include <atomic>
+#include <thread>
+
+/*!
+ * Class-signleton that gathers the runtime metrics of the application: the
+ * statistics of the frames queues and the named values (timings, latencies,
+ * etc.) updated by different modules. It's read by the GUI and by the
+ * statistics publisher. The registry owns the statistics windows of the
+ * queues, it closes them periodically in its own thread, hence the readers
+ * never reset what the others would read.
+ */
+class MetricsRegistry
+{
+public:
+    //! The singleton getter.
+    static MetricsRegistry& get();
+
+    // delete copy and move constructors and assign operators
+    //! Copy constructor.
+    MetricsRegistry(MetricsRegistry const&) = delete;
+    //! Move constructor.
+    MetricsRegistry(MetricsRegistry&&) = delete;
+    //! Copy assignment.
+    MetricsRegistry& operator=(MetricsRegistry const&) = delete;
+    //! Move assignment.
+    MetricsRegistry& operator=(MetricsRegistry &&) = delete;
+
+public:
+    //! Registers the queue under the given name, e.g. "mainCamera/tracker".
+    //! The registry doesn't own the queue, it's forgotten when destroyed.
+    void registerQueue(QString name, TimestampedFrameQueuePtr queue);
+    //! Returns the statistics of all the alive registered queues. The rates
+    //! and the ages are measured over the last window of WindowPeriodMs.
+    QMap<QString, QueueMetrics::Snapshot> queueSnapshots();
+
+    //! Sets the named value.
+    void setValue(QString name, double value);
+    //! Returns all the metrics as the named values, the queues statistics are
+    //! represented as "queue/<queue name>/<statistics>", the depth histogram
+    //! bins as "queue/<queue name>/depthBin<bin>" (see QueueMetrics).
+    QMap<QString, double> values();
+
+private:
+    //! Constructor. Defining it here prevents construction.
+    MetricsRegistry();
+    //! Destructor. Defining it here prevents unwanted destruction.
+    ~MetricsRegistry();
+
+    //! Returns the alive registered queues, forgets the destroyed ones.
+    QMap<QString, TimestampedFrameQueuePtr> aliveQueues();
+    //! Closes periodically the statistics windows of the queues.
+    void runWindows();
+
+private:
+    //! The registered queues.
+    QMap<QString, QWeakPointer<TimestampedFrameQueue>> m_queues;
+    //! The named values.
+    QMap<QString, double> m_values;
+    //! Protects the queues and the values.
+    QMutex m_mutex;
+
+    //! The flag to stop the windows thread.
+    std::atomic_bool m_stopped;
+    //! Used to wake up the windows thread when the registry is destroyed.
+    QMutex m_windowsMutex;
+    QWaitCondition m_windowsCondition;
+    //! The thread that closes the statistics windows.
+    std::thread m_windowsThread;
+
+    //! The duration of the statistics windows.
+    static const int WindowPeriodMs;  // [ms]
+};
+
+#endif // CATS2_METRICS_REGISTRY_HPP
@@ -0,0 +1,112 @@
+#include "QueueMetrics.hpp"
+
+#include <QtCore/QMutexLocker>
+
+constexpr int QueueMetrics::DepthHistogramSize;
+
+/*!
+ * Constructor.
+ */
+QueueMetrics::QueueMetrics() :
+    m_enqueued(0),
+    m_dequeued(0),
+    m_dropped(0),
+    m_depth(0),
+    m_ageSumUs(0),
+    m_ageCount(0),
+    m_maxAgeUs(0),
+    m_window(),
+    m_windowStartTime(std::chrono::steady_clock::now()),
+    m_windowMutex()
+{
+    for (auto& bin : m_depthHistogram)
+        bin = 0;
+}
+
+/*!
+ * Registers a dequeued frame, gets the queue depth after dequeuing and the
+ * frame age.
+ */
+void QueueMetrics::onDequeued(size_t depth, std::chrono::microseconds age)
+{
+    ++m_dequeued;
+    m_depth = static_cast<int>(depth);
+    ++m_depthHistogram[depthBin(depth)];
+
+    long long ageUs = age.count();
+    m_ageSumUs += ageUs;
+    ++m_ageCount;
+    long long maxAgeUs = m_maxAgeUs;
+    while ((ageUs > maxAgeUs) && !m_maxAgeUs.compare_exchange_weak(maxAgeUs, ageUs)) { }
+}
+
+/*!
+ * Returns the statistics. The counters are read as they are now, the rates and
+ * the ages are those of the last closed window.
+ */
+QueueMetrics::Snapshot QueueMetrics::snapshot() const
+{
+    Snapshot currentSnapshot;
+    {
+        QMutexLocker locker(&m_windowMutex);
+        currentSnapshot = m_window;
+    }
+    currentSnapshot.enqueued = m_enqueued;
+    currentSnapshot.dequeued = m_dequeued;
+    currentSnapshot.dropped = m_dropped;
+    currentSnapshot.depth = m_depth;
+    currentSnapshot.depthHistogram.clear();
+    currentSnapshot.depthHistogram.reserve(DepthHistogramSize);
+    for (auto& bin : m_depthHistogram)
+        currentSnapshot.depthHistogram.append(bin);
+    return currentSnapshot;
+}
+
+/*!
+ * Closes the current window: the rates are computed from the counters'
+ * increase since the previous window, the ages accumulated during the window
+ * are averaged and reset.
+ */
+void QueueMetrics::closeWindow()
+{
+    QMutexLocker locker(&m_windowMutex);
+
+    Snapshot window;
+    window.enqueued = m_enqueued;
+    window.dequeued = m_dequeued;
+    window.dropped = m_dropped;
+    window.depth = m_depth;
+
+    // the frame ages during the window
+    long long ageSumUs = m_ageSumUs.exchange(0);
+    long long ageCount = m_ageCount.exchange(0);
+    long long maxAgeUs = m_maxAgeUs.exchange(0);
+    if (ageCount > 0)
+        window.meanAgeMs = ageSumUs / 1000. / ageCount;
+    window.maxAgeMs = maxAgeUs / 1000.;
+
+    // the rates during the window
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double intervalSec = std::chrono::duration<double>(now - m_windowStartTime).count();
+    if (intervalSec > 0) {
+        window.enqueueRateHz = (window.enqueued - m_window.enqueued) / intervalSec;
+        window.dequeueRateHz = (window.dequeued - m_window.dequeued) / intervalSec;
+        window.dropRateHz = (window.dropped - m_window.dropped) / intervalSec;
+    }
+
+    m_window = window;
+    m_windowStartTime = now;
+}
+
+/*!
+ * Returns the depth histogram bin for the given depth.
+ */
+int QueueMetrics::depthBin(size_t depth)
+{
+    int bin = 0;
+    while ((depth > 0) && (bin < DepthHistogramSize - 1)) {
+        depth >>= 1;
+        ++bin;
+    }
+    return bin;
+}
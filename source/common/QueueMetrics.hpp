@@ -0,0 +1,107 @@
+#ifndef CATS2_QUEUE_METRICS_HPP
+#define CATS2_QUEUE_METRICS_HPP
+
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+
+/*!
+ * \brief Collects the statistics of a frames queue: the enqueue and dequeue
+ * counts, the queue depth histogram, the frame age at dequeue (the time the
+ * frame spent in the queue) and the number of dropped frames.
+ *
+ * The counters are updated from the producer and consumer threads without
+ * locking. The rates and the ages are measured over windows closed by one
+ * owner (see MetricsRegistry), the snapshots only read them, thus they can be
+ * taken from any thread by any number of readers.
+ */
+class QueueMetrics
+{
+public:
+    //! The number of the depth histogram bins. The bin 0 counts the empty
+    //! queue, the bin i > 0 counts the depths in [2^(i-1), 2^i), the last bin
+    //! counts all the bigger depths.
+    static constexpr int DepthHistogramSize = 12;
+
+    //! The queue statistics at a given time moment.
+    struct Snapshot
+    {
+        //! The total number of enqueued frames.
+        unsigned long long enqueued = 0;
+        //! The total number of dequeued frames.
+        unsigned long long dequeued = 0;
+        //! The total number of dropped frames.
+        unsigned long long dropped = 0;
+        //! The enqueue rate over the last window.
+        double enqueueRateHz = 0;
+        //! The dequeue rate over the last window.
+        double dequeueRateHz = 0;
+        //! The drop rate over the last window.
+        double dropRateHz = 0;
+        //! The queue depth measured at the last dequeue.
+        int depth = 0;
+        //! The histogram of the queue depth measured at dequeue.
+        QVector<unsigned long long> depthHistogram;
+        //! The average frame age at dequeue over the last window.
+        double meanAgeMs = 0;
+        //! The maximal frame age at dequeue over the last window.
+        double maxAgeMs = 0;
+    };
+
+public:
+    //! Constructor.
+    explicit QueueMetrics();
+
+public:
+    //! Registers an enqueued frame.
+    void onEnqueued() { ++m_enqueued; }
+    //! Registers a dropped frame.
+    void onDropped(unsigned long long count = 1) { m_dropped += count; }
+    //! Registers a dequeued frame, gets the queue depth after dequeuing and the
+    //! frame age.
+    void onDequeued(size_t depth, std::chrono::microseconds age);
+
+    //! Returns the total number of dropped frames.
+    unsigned long long dropped() const { return m_dropped; }
+
+    //! Returns the statistics. The rates and the ages are those of the last
+    //! closed window, nothing is reset.
+    Snapshot snapshot() const;
+    //! Closes the current window: computes its rates and ages and starts a new
+    //! one. Must be called by one owner only.
+    void closeWindow();
+
+private:
+    //! Returns the depth histogram bin for the given depth.
+    static int depthBin(size_t depth);
+
+private:
+    //! The total number of enqueued frames.
+    std::atomic<unsigned long long> m_enqueued;
+    //! The total number of dequeued frames.
+    std::atomic<unsigned long long> m_dequeued;
+    //! The total number of dropped frames.
+    std::atomic<unsigned long long> m_dropped;
+    //! The queue depth at the last dequeue.
+    std::atomic_int m_depth;
+    //! The depth histogram.
+    std::array<std::atomic<unsigned long long>, DepthHistogramSize> m_depthHistogram;
+    //! The sum of the frame ages in the current window.
+    std::atomic<long long> m_ageSumUs;
+    //! The number of the frame ages summed in the current window.
+    std::atomic<long long> m_ageCount;
+    //! The maximal frame age in the current window.
+    std::atomic<long long> m_maxAgeUs;
+
+    //! The statistics at the end of the last closed window.
+    Snapshot m_window;
+    //! The time when the current window started.
+    std::chrono::steady_clock::time_point m_windowStartTime;
+    //! Protects the last window's statistics.
+    mutable QMutex m_windowMutex;
+};
+
+#endif // CATS2_QUEUE_METRICS_HPP
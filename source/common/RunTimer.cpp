@@ -1,4 +1,5 @@
 #include "RunTimer.hpp"
+#include "TimestampClock.hpp"
 
 #include <QtCore/QDebug>
 
@@ -6,7 +7,7 @@
  * Constructor.
  */
 RunTimer::RunTimer() :
-    m_startTime(std::chrono::milliseconds::zero()),
+    m_startTime(std::chrono::microseconds::zero()),
     m_initialized(false)
 {
 }
@@ -33,7 +34,7 @@ RunTimer& RunTimer::get()
  */
 void RunTimer::init()
 {
-    m_startTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
+    m_startTime = TimestampClock::now();
     m_initialized = true;
 }
 
@@ -42,14 +43,13 @@ void RunTimer::init()
  */
 double RunTimer::currentRuntimeSec()
 {
-    return runtimeSecTo(std::chrono::duration_cast<std::chrono::milliseconds>
-                        (std::chrono::system_clock::now().time_since_epoch()));
+    return runtimeSecTo(TimestampClock::now());
 }
 
 /*!
  * The runtime in seconds to the provided timestamp.
  */
-double RunTimer::runtimeSecTo(std::chrono::milliseconds timestamp)
+double RunTimer::runtimeSecTo(std::chrono::microseconds timestamp)
 {
     if (m_initialized)
         return std::chrono::duration_cast<std::chrono::duration<double,std::ratio<1,1>>>(timestamp - m_startTime).count();
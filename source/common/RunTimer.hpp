@@ -27,9 +27,11 @@ public:
 
 public:
     //! The runtime in seconds to the provided timestamp.
-    double runtimeSecTo(std::chrono::milliseconds timestamp);
+    double runtimeSecTo(std::chrono::microseconds timestamp);
     //! The runtime in seconds to the current time moment.
     double currentRuntimeSec();
+    //! Returns the program start time, see TimestampClock.
+    std::chrono::microseconds startTime() const { return m_startTime; }
 
 private:
     //! Constructor. Defining it here prevents construction.
@@ -38,8 +40,9 @@ private:
     ~RunTimer();
 
 private:
-    //! Defines the moment when the program started as a time since epoch.
-    std::chrono::milliseconds m_startTime;
+    //! Defines the moment when the program started as a time since epoch,
+    //! see TimestampClock.
+    std::chrono::microseconds m_startTime;
     //! Initialization status.
     bool m_initialized;
 };
@@ -0,0 +1,31 @@
+#include "TimestampClock.hpp"
+
+/*!
+ * Returns the current timestamp.
+ */
+std::chrono::microseconds TimestampClock::now()
+{
+    return fromSteady(std::chrono::steady_clock::now());
+}
+
+/*!
+ * Converts the monotonic clock time point to the timestamp.
+ */
+std::chrono::microseconds TimestampClock::fromSteady(std::chrono::steady_clock::time_point timePoint)
+{
+    return steadyClockEpochOffset() +
+            std::chrono::duration_cast<std::chrono::microseconds>(timePoint.time_since_epoch());
+}
+
+/*!
+ * Returns the system time corresponding to the zero of the monotonic clock.
+ * It's computed once, on the first call, and is thread-safe as a static local
+ * variable.
+ */
+std::chrono::microseconds TimestampClock::steadyClockEpochOffset()
+{
+    static const std::chrono::microseconds offset =
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()) -
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch());
+    return offset;
+}
@@ -0,0 +1,29 @@
+#ifndef CATS2_TIMESTAMP_CLOCK_HPP
+#define CATS2_TIMESTAMP_CLOCK_HPP
+
+#include <chrono>
+
+/*!
+ * Provides the timestamps of the frames and the tracking results: the time
+ * since 1970-01-01T00:00:00 Universal Coordinated Time measured by the
+ * monotonic clock. The monotonic clock is anchored to the system clock once,
+ * hence the timestamps are comparable to the wall clock time but never jump
+ * when the system time is adjusted, and they keep the sub-millisecond
+ * resolution.
+ */
+class TimestampClock
+{
+public:
+    //! Returns the current timestamp.
+    static std::chrono::microseconds now();
+    //! Converts the monotonic clock time point to the timestamp. Used to
+    //! timestamp the events measured on the monotonic clock, e.g. the frame
+    //! capture.
+    static std::chrono::microseconds fromSteady(std::chrono::steady_clock::time_point timePoint);
+
+private:
+    //! Returns the system time corresponding to the zero of the monotonic clock.
+    static std::chrono::microseconds steadyClockEpochOffset();
+};
+
+#endif // CATS2_TIMESTAMP_CLOCK_HPP
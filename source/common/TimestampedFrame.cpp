@@ -1,12 +1,16 @@
 #include "TimestampedFrame.hpp"
 
+#include <QtCore/QMutexLocker>
+
+#include <algorithm>
+
 const int TimestampedFrameQueue::TimeOutMs = 250;  // [ms]
 
 
 /*!
  * Constructor.
  */
-TimestampedFrame::TimestampedFrame(cv::Mat image, std::chrono::milliseconds timestamp):
+TimestampedFrame::TimestampedFrame(cv::Mat image, std::chrono::microseconds timestamp):
     m_image(image),
     m_timestamp(timestamp)
 {
@@ -20,3 +24,308 @@ TimestampedFrame::~TimestampedFrame()
 {
 //    qDebug() << "Destroying the object";
 }
+
+/*!
+ * Constructor.
+ */
+QueuePolicy::QueuePolicy(Type type, size_t maxSize, size_t dropCount, std::chrono::milliseconds maxAge) :
+    m_type(type),
+    m_maxSize(std::max<size_t>(maxSize, 1)),
+    m_dropCount(std::max<size_t>(std::min(dropCount, m_maxSize), 1)),
+    m_maxAge(maxAge)
+{
+}
+
+/*!
+ * Returns the bounded ring policy.
+ */
+QueuePolicy QueuePolicy::dropOldest(size_t maxSize, size_t dropCount)
+{
+    return QueuePolicy(Type::DROP_OLDEST, maxSize, dropCount, std::chrono::milliseconds());
+}
+
+/*!
+ * Returns the single-slot mailbox policy.
+ */
+QueuePolicy QueuePolicy::latestOnly()
+{
+    return QueuePolicy(Type::LATEST_ONLY, 1, 1, std::chrono::milliseconds());
+}
+
+/*!
+ * Returns the age based eviction policy.
+ */
+QueuePolicy QueuePolicy::maxAge(std::chrono::milliseconds maxAge, size_t maxSize)
+{
+    return QueuePolicy(Type::MAX_AGE, maxSize, 1, maxAge);
+}
+
+/*!
+ * Returns the back-pressure policy.
+ */
+QueuePolicy QueuePolicy::blocking(size_t maxSize)
+{
+    return QueuePolicy(Type::BLOCKING, maxSize, 1, std::chrono::milliseconds());
+}
+
+/*!
+ * Constructor.
+ */
+TimestampedFrameQueue::TimestampedFrameQueue(QueuePolicy policy) :
+    m_policy(policy),
+    // the lock-free queue is not used by the latest-only and drop-oldest policies
+    m_queue(((policy.type() == QueuePolicy::Type::LATEST_ONLY) ||
+             (policy.type() == QueuePolicy::Type::DROP_OLDEST)) ? 1 : policy.maxSize() + policy.dropCount()),
+    m_hardMaxSize((policy.type() == QueuePolicy::Type::DROP_OLDEST) ? policy.maxSize()
+                                                                    : policy.maxSize() + policy.dropCount()),
+    m_mailbox(),
+    m_mailboxFull(false),
+    m_mailboxMutex(),
+    m_mailboxCondition(),
+    m_ring(),
+    m_ringMutex(),
+    m_ringCondition(),
+    m_freeSlots((policy.type() == QueuePolicy::Type::BLOCKING) ? static_cast<int>(policy.maxSize()) : 0),
+    m_emptyRequested(false),
+    m_metrics()
+{
+}
+
+/*!
+ * Returns the approximate number of frames in the queue.
+ */
+size_t TimestampedFrameQueue::size() const
+{
+    if (m_policy.type() == QueuePolicy::Type::LATEST_ONLY) {
+        QMutexLocker locker(&m_mailboxMutex);
+        return m_mailboxFull ? 1 : 0;
+    }
+    if (m_policy.type() == QueuePolicy::Type::DROP_OLDEST) {
+        QMutexLocker locker(&m_ringMutex);
+        return m_ring.size();
+    }
+    return m_queue.size_approx();
+}
+
+/*!
+ * Returns the maximal number of frames held by the queue at the same time.
+ */
+size_t TimestampedFrameQueue::capacity() const
+{
+    if (m_policy.type() == QueuePolicy::Type::LATEST_ONLY)
+        return 1;
+    return m_hardMaxSize;
+}
+
+/*!
+ * Empties the queue. The frames are dropped by the consumer on its next
+ * dequeue, thus the method can be called from both sides of the queue.
+ */
+void TimestampedFrameQueue::empty()
+{
+    if (m_policy.type() == QueuePolicy::Type::LATEST_ONLY) {
+        QMutexLocker locker(&m_mailboxMutex);
+        if (m_mailboxFull) {
+            m_mailbox = QueuedFrame();
+            m_mailboxFull = false;
+            m_metrics.onDropped();
+        }
+    } else if (m_policy.type() == QueuePolicy::Type::DROP_OLDEST) {
+        QMutexLocker locker(&m_ringMutex);
+        m_metrics.onDropped(m_ring.size());
+        m_ring.clear();
+    } else {
+        m_emptyRequested = true;
+    }
+}
+
+/*!
+ * Adds an element to the queue. With the drop-oldest policy the producer
+ * drops the oldest frames to make room for the new one. With the other
+ * policies the producer never removes the frames, when the consumer doesn't
+ * dequeue them the new frames are skipped.
+ */
+void TimestampedFrameQueue::enqueue(const TimestampedFrame& frame)
+{
+    if (m_policy.type() == QueuePolicy::Type::LATEST_ONLY) {
+        QMutexLocker locker(&m_mailboxMutex);
+        // the previous frame was never dequeued
+        if (m_mailboxFull)
+            m_metrics.onDropped();
+        m_mailbox = QueuedFrame{frame, std::chrono::steady_clock::now()};
+        m_mailboxFull = true;
+        m_metrics.onEnqueued();
+        m_mailboxCondition.wakeOne();
+        return;
+    }
+
+    if (m_policy.type() == QueuePolicy::Type::DROP_OLDEST) {
+        enqueueRing(frame);
+        return;
+    }
+
+    // the queue is full, the frame is not waited for
+    if ((m_policy.type() == QueuePolicy::Type::BLOCKING) && !m_freeSlots.tryAcquire()) {
+        m_metrics.onDropped();
+        return;
+    }
+
+    // the consumer doesn't take the frames
+    if ((m_queue.size_approx() >= m_hardMaxSize) ||
+            !m_queue.try_enqueue(QueuedFrame{frame, std::chrono::steady_clock::now()}))
+        m_metrics.onDropped();
+    else
+        m_metrics.onEnqueued();
+}
+
+/*!
+ * Adds an element to the queue, returns true if succeded. With the blocking
+ * policy the producer waits for the consumer to free a place, but not longer
+ * than the time out so that it can check if it's stopped. A frame that is not
+ * enqueued is not counted as dropped, the producer is expected to retry.
+ */
+bool TimestampedFrameQueue::tryEnqueue(const TimestampedFrame& frame)
+{
+    if (m_policy.type() != QueuePolicy::Type::BLOCKING) {
+        enqueue(frame);
+        return true;
+    }
+
+    if (!m_freeSlots.tryAcquire(1, TimeOutMs))
+        return false;
+    m_queue.enqueue(QueuedFrame{frame, std::chrono::steady_clock::now()});
+    m_metrics.onEnqueued();
+    return true;
+}
+
+/*!
+ * Gets an element from the queue, returns true if succeded. The outdated frames
+ * are dropped here according to the policy.
+ */
+bool TimestampedFrameQueue::dequeue(TimestampedFrame& frame)
+{
+    if (m_policy.type() == QueuePolicy::Type::LATEST_ONLY)
+        return dequeueLatest(frame);
+    if (m_policy.type() == QueuePolicy::Type::DROP_OLDEST)
+        return dequeueRing(frame);
+
+    if (m_emptyRequested.exchange(false))
+        dropHead(m_queue.size_approx());
+
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(TimeOutMs);
+    QueuedFrame queuedFrame;
+    while (true) {
+        std::chrono::microseconds timeout =
+                std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now());
+        if ((timeout.count() < 0) || !m_queue.wait_dequeue_timed(queuedFrame, timeout))
+            return false;
+        // skip the frames that are too old
+        if ((m_policy.type() == QueuePolicy::Type::MAX_AGE) && isStale(queuedFrame)) {
+            m_metrics.onDropped();
+            continue;
+        }
+        onFrameRemoved();
+        m_metrics.onDequeued(m_queue.size_approx(), frameAge(queuedFrame));
+        frame = queuedFrame.frame;
+        return true;
+    }
+}
+
+/*!
+ * Drops up to the given number of frames from the head of the queue.
+ */
+void TimestampedFrameQueue::dropHead(size_t count)
+{
+    QueuedFrame frameToForget;
+    for (size_t i = 0; (i < count) && m_queue.try_dequeue(frameToForget); ++i) {
+        onFrameRemoved();
+        m_metrics.onDropped();
+    }
+}
+
+/*!
+ * Called when a frame leaves the queue, with the blocking policy it frees the
+ * place for the producer.
+ */
+void TimestampedFrameQueue::onFrameRemoved()
+{
+    if (m_policy.type() == QueuePolicy::Type::BLOCKING)
+        m_freeSlots.release();
+}
+
+/*!
+ * Gets the frame from the mailbox, used with the latest-only policy.
+ */
+bool TimestampedFrameQueue::dequeueLatest(TimestampedFrame& frame)
+{
+    QMutexLocker locker(&m_mailboxMutex);
+    if (!m_mailboxFull)
+        m_mailboxCondition.wait(&m_mailboxMutex, TimeOutMs);
+    if (!m_mailboxFull)
+        return false;
+
+    frame = m_mailbox.frame;
+    m_metrics.onDequeued(0, frameAge(m_mailbox));
+    // release the image so that its buffer is not held by the mailbox
+    m_mailbox = QueuedFrame();
+    m_mailboxFull = false;
+    return true;
+}
+
+/*!
+ * Adds the frame to the ring, used with the drop-oldest policy. When the ring
+ * is full its oldest frames are dropped first, hence the consumer always gets
+ * the most recent frames.
+ */
+void TimestampedFrameQueue::enqueueRing(const TimestampedFrame& frame)
+{
+    QMutexLocker locker(&m_ringMutex);
+    if (m_ring.size() >= m_policy.maxSize()) {
+        for (size_t i = 0; (i < m_policy.dropCount()) && !m_ring.empty(); ++i) {
+            m_ring.pop_front();
+            m_metrics.onDropped();
+        }
+    }
+    m_ring.push_back(QueuedFrame{frame, std::chrono::steady_clock::now()});
+    m_metrics.onEnqueued();
+    m_ringCondition.wakeOne();
+}
+
+/*!
+ * Gets the oldest frame from the ring, used with the drop-oldest policy.
+ */
+bool TimestampedFrameQueue::dequeueRing(TimestampedFrame& frame)
+{
+    QMutexLocker locker(&m_ringMutex);
+    if (m_ring.empty())
+        m_ringCondition.wait(&m_ringMutex, TimeOutMs);
+    if (m_ring.empty())
+        return false;
+
+    frame = m_ring.front().frame;
+    std::chrono::microseconds age = frameAge(m_ring.front());
+    m_ring.pop_front();
+    m_metrics.onDequeued(m_ring.size(), age);
+    return true;
+}
+
+/*!
+ * Checks if the frame is too old according to the policy.
+ */
+bool TimestampedFrameQueue::isStale(const QueuedFrame& queuedFrame) const
+{
+    return (frameAge(queuedFrame) > m_policy.maxAge());
+}
+
+/*!
+ * Returns the time passed since the frame was put to the queue. The frame's
+ * timestamp is not used: the replayed frames are stamped with their position
+ * in the video, hence comparing it to the current time would make the MAX_AGE
+ * policy drop every frame when the video is processed slower than real time.
+ */
+std::chrono::microseconds TimestampedFrameQueue::frameAge(const QueuedFrame& queuedFrame)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                 queuedFrame.enqueueTime);
+}
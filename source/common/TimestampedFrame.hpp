@@ -1,116 +1,239 @@
 #ifndef CATS2_TIMESTAMPED_FRAME_HPP
 #define CATS2_TIMESTAMPED_FRAME_HPP
 
+#include "QueueMetrics.hpp"
+
 #include <readerwriterqueue.h>
 
 #include <opencv2/core/core.hpp>
 
 #include <QtCore/QDebug>
+#include <QtCore/QMutex>
+#include <QtCore/QSemaphore>
 #include <QtCore/QSharedPointer>
+#include <QtCore/QWaitCondition>
 
+#include <atomic>
 #include <chrono>
+#include <deque>
 #include <thread>
 
 /*!
 * \brief This class stores a video frame image and its timestamp
 *
+* The image is immutable and shared between all the copies of the frame, thus
+* copying a frame (e.g. to put it to several queues) does not copy the image
+* data. The consumers that need to modify the image must request a private
+* copy with mutableImage(). The image is kept in a reference counted cv::Mat
+* header, hence copying a frame makes no heap allocations and the image buffer
+* is released through its allocator (e.g. returned to a frame buffer pool) when
+* the last copy of the frame is destroyed.
 */
 class TimestampedFrame
 {
 public:
-    //! Constructor.
-    explicit TimestampedFrame(cv::Mat image = cv::Mat(), std::chrono::milliseconds timestamp = std::chrono::milliseconds());
+    //! Constructor. The frame takes the image buffer over, the caller must not
+    //! modify the image after that.
+    explicit TimestampedFrame(cv::Mat image = cv::Mat(), std::chrono::microseconds timestamp = std::chrono::microseconds());
     //! Destructor.
     virtual ~TimestampedFrame() final;
 
 public:
-    //! Returns the frame image.
-    cv::Mat image() const { return m_image; }
+    //! Returns the frame image. The image is shared between all the copies of
+    //! the frame and must not be modified.
+    const cv::Mat& image() const { return m_image; }
+    //! Returns a private deep copy of the image that can be modified.
+    cv::Mat mutableImage() const { return image().clone(); }
     //! Returns the time stamp.
-    std::chrono::milliseconds timestamp() const { return m_timestamp; }
+    std::chrono::microseconds timestamp() const { return m_timestamp; }
 
 private:
-    //! The frame image.
+    //! The frame image shared between the copies of the frame. It's never
+    //! modified after the construction.
     cv::Mat m_image;
-    //! The corresponding timestamp, in number of milliseconds since 1970-01-01T00:00:00
-    //! Universal Coordinated Time.
-    std::chrono::milliseconds m_timestamp;
+    //! The corresponding timestamp, in number of microseconds since 1970-01-01T00:00:00
+    //! Universal Coordinated Time measured by the monotonic clock, see TimestampClock.
+    //! When available, it's the capture time rather than the reception time.
+    std::chrono::microseconds m_timestamp;
+};
+
+/*!
+ * Defines which frames are dropped by the queue when its consumer doesn't keep
+ * up with the producer.
+ */
+class QueuePolicy
+{
+public:
+    //! The policy types.
+    enum class Type
+    {
+        //! A bounded ring, the given number of the oldest frames is dropped
+        //! when it's full.
+        DROP_OLDEST,
+        //! A single-slot mailbox, only the most recent frame is kept.
+        LATEST_ONLY,
+        //! The frames that waited in the queue longer than the given age are
+        //! dropped at dequeue time.
+        MAX_AGE,
+        //! A bounded queue that never drops the frames, the producer waits
+        //! for the consumer when it's full. Used for the offline processing.
+        BLOCKING
+    };
+
+public:
+    //! Returns the bounded ring policy, the given number of the oldest frames
+    //! is dropped when the queue reaches the maximal size.
+    static QueuePolicy dropOldest(size_t maxSize, size_t dropCount = 1);
+    //! Returns the single-slot mailbox policy.
+    static QueuePolicy latestOnly();
+    //! Returns the age based eviction policy, the queue is still bounded by
+    //! the maximal size. The age is the time spent in the queue, hence the
+    //! policy works the same for the live and the replayed videos.
+    static QueuePolicy maxAge(std::chrono::milliseconds maxAge, size_t maxSize = DefaultMaxSize);
+    //! Returns the back-pressure policy, the producer waits when the queue
+    //! reaches the maximal size.
+    static QueuePolicy blocking(size_t maxSize = DefaultMaxSize);
+
+public:
+    //! Returns the policy type.
+    Type type() const { return m_type; }
+    //! Returns the maximal number of frames in the queue.
+    size_t maxSize() const { return m_maxSize; }
+    //! Returns the number of frames dropped at once when the queue is full.
+    size_t dropCount() const { return m_dropCount; }
+    //! Returns the maximal time the dequeued frames spent in the queue.
+    std::chrono::milliseconds maxAge() const { return m_maxAge; }
+
+private:
+    //! Constructor. Private, the factory methods are to be used instead.
+    QueuePolicy(Type type, size_t maxSize, size_t dropCount, std::chrono::milliseconds maxAge);
+
+private:
+    //! The policy type.
+    Type m_type;
+    //! The maximal number of frames in the queue.
+    size_t m_maxSize;
+    //! The number of frames dropped at once when the queue is full.
+    size_t m_dropCount;
+    //! The maximal age of the dequeued frames.
+    std::chrono::milliseconds m_maxAge;
+
+    //! Default maximal queue size.
+    static constexpr size_t DefaultMaxSize = 100;
 };
 
 /*!
- * The queue of the timestamped frames.
+ * The queue of the timestamped frames. It has one producer and one consumer
+ * thread. With the drop-oldest policy the producer drops the oldest frames
+ * when the ring is full, thus the queue always keeps the most recent frames;
+ * with the other policies the frames are dropped by the consumer and the
+ * producer only skips the new frames when the consumer doesn't take them at
+ * all.
  */
 class TimestampedFrameQueue
 {
 public:
-    //! Constructor.
-    explicit TimestampedFrameQueue(int initialSize = DefaultInitialSize, size_t maxSize = DefaultMaxSize, bool dropTailWhenOutgrown = true):
-        m_queue(initialSize),
-        m_maxSize(maxSize),
-        m_dropTailWhenOutgrown(dropTailWhenOutgrown)
-    { }
+    //! Constructor. Gets the policy defining which frames are dropped.
+    explicit TimestampedFrameQueue(QueuePolicy policy = QueuePolicy::dropOldest(DefaultMaxSize));
     //! Destructor.
     virtual ~TimestampedFrameQueue() final { }
 
 public:
-    //! The queue became too big.
-    bool isOutgrown() const { return (m_queue.size_approx() > m_maxSize); }
-
-    //! Drops one element from the head.
-    void dropHead()
-    {
-        TimestampedFrame frameToForget;
-        m_queue.try_dequeue(frameToForget);
-    }
+    //! Returns the queue policy.
+    const QueuePolicy& policy() const { return m_policy; }
+    //! Returns the approximate number of frames in the queue.
+    size_t size() const;
+    //! Returns the maximal number of frames held by the queue at the same time.
+    size_t capacity() const;
+    //! Returns the number of frames dropped since the queue creation.
+    unsigned long long droppedFrames() const { return m_metrics.dropped(); }
+    //! Returns the queue statistics.
+    QueueMetrics& metrics() { return m_metrics; }
+
+    //! Empties the queue. Can be called from both sides of the queue, the
+    //! frames are dropped by the consumer on its next dequeue.
+    void empty();
+
+    //! Adds an element to the queue. Called by the producer.
+    void enqueue(const TimestampedFrame& frame);
+    //! Adds an element to the queue, returns true if succeded. With the
+    //! blocking policy waits for the free place during the time out, with
+    //! other policies it's the same as enqueue(). Called by the producer.
+    bool tryEnqueue(const TimestampedFrame& frame);
+
+    //! Gets an element from the queue, returns true if succeded. Called by the
+    //! consumer.
+    bool dequeue(TimestampedFrame& frame);
 
-    //! Empties the queue.
-    void empty()
+private:
+    //! The frame with the time it was put to the queue.
+    struct QueuedFrame
     {
+        //! The frame.
         TimestampedFrame frame;
-        int cnt = 0;
-        while (m_queue.try_dequeue(frame))
-            cnt++;
-        qDebug() << QObject::tr("Dropped %1 elements").arg(cnt);
-    }
-
-    //! Adds an element to the queue.
-    void enqueue(const TimestampedFrame& frame)
-    {
-        // first check if there is allows place in the queue otherwise remove the tail element
-        if (isOutgrown() && m_dropTailWhenOutgrown) {
-            dropHead();
-        }
-
-        // enqueue the new element
-        if (!m_queue.try_enqueue(frame))
-            qDebug() << "Could not enqueue new element, skipping";
-    }
-
-    //! Gets an element from the queue, returns true if succeded.
-    bool dequeue(TimestampedFrame& frame)
-    {
-        bool result = m_queue.wait_dequeue_timed(frame, std::chrono::milliseconds(TimeOutMs));
-        return result;
-    }
+        //! The time when the frame was put to the queue.
+        std::chrono::steady_clock::time_point enqueueTime;
+    };
 
 private:
+    //! Drops up to the given number of frames from the head of the queue.
+    void dropHead(size_t count);
+    //! Called when a frame leaves the queue, used to wake up the producer
+    //! with the blocking policy.
+    void onFrameRemoved();
+    //! Gets the frame from the mailbox, used with the latest-only policy.
+    bool dequeueLatest(TimestampedFrame& frame);
+    //! Adds the frame to the ring, used with the drop-oldest policy.
+    void enqueueRing(const TimestampedFrame& frame);
+    //! Gets the oldest frame from the ring, used with the drop-oldest policy.
+    bool dequeueRing(TimestampedFrame& frame);
+    //! Checks if the frame is too old according to the policy.
+    bool isStale(const QueuedFrame& queuedFrame) const;
+    //! Returns the time passed since the frame was put to the queue. It's not
+    //! measured from the frame's timestamp as the replayed frames are stamped
+    //! with their position in the video, not with the wall clock time.
+    static std::chrono::microseconds frameAge(const QueuedFrame& queuedFrame);
+
+private:
+    //! The queue policy.
+    const QueuePolicy m_policy;
     //! The queue to store data.
-    moodycamel::BlockingReaderWriterQueue<TimestampedFrame> m_queue;
+    moodycamel::BlockingReaderWriterQueue<QueuedFrame> m_queue;
     //! The max number of elements that can be put to the queue. Since it seems to be
     //! not supported by the "moodycamel::ReaderWriterQueue" to limit the size of the queue
-    //! we need to store it separately.
-    size_t m_maxSize;
-    //! Defines if the queue should drop the tail element when trying to add new element and
-    //! the size is too big
-    bool m_dropTailWhenOutgrown;
+    //! we need to store it separately. Above this size the producer skips the
+    //! new frames. With the drop-oldest policy it's the size of the ring.
+    size_t m_hardMaxSize;
+
+    //! The single frame slot used with the latest-only policy.
+    QueuedFrame m_mailbox;
+    //! Defines if the mailbox contains a frame.
+    bool m_mailboxFull;
+    //! Protects the mailbox.
+    mutable QMutex m_mailboxMutex;
+    //! Used to wake up the consumer waiting for the mailbox.
+    QWaitCondition m_mailboxCondition;
+
+    //! The frames ring used with the drop-oldest policy, the producer drops
+    //! its head when it's full.
+    std::deque<QueuedFrame> m_ring;
+    //! Protects the ring.
+    mutable QMutex m_ringMutex;
+    //! Used to wake up the consumer waiting for a frame in the ring.
+    QWaitCondition m_ringCondition;
+
+    //! The free places in the queue, used with the blocking policy.
+    QSemaphore m_freeSlots;
+
+    //! Set when the queue is to be emptied by the consumer.
+    std::atomic_bool m_emptyRequested;
+    //! The queue statistics.
+    QueueMetrics m_metrics;
 
     //! Dequeueing time out.
     static const int TimeOutMs;  // [ms]
     //! Default maximal queue size.
-    static constexpr size_t DefaultMaxSize = 1500;
-    //! Default initial queue size.
-    static constexpr size_t DefaultInitialSize = 300;
+    static constexpr size_t DefaultMaxSize = 100;
 };
 
 #endif // CATS2_TIMESTAMPED_FRAME_HPP
-
@@ -6,4 +6,5 @@
 const QMap<QString, StreamType>
 StreamDescriptor::m_streamTypeByName = {{"v4l", StreamType::VIDEO_4_LINUX},
                                         {"vf", StreamType::LOCAL_VIDEO_FILE},
-                                        {"if", StreamType::LOCAL_IMAGE_FILE}};
+                                        {"if", StreamType::LOCAL_IMAGE_FILE},
+                                        {"rf", StreamType::REPLAY_VIDEO_FILE}};
@@ -11,6 +11,7 @@ enum class StreamType
     VIDEO_4_LINUX,
     LOCAL_VIDEO_FILE,
     LOCAL_IMAGE_FILE, // still image (for the debug purposes)
+    REPLAY_VIDEO_FILE, // video file processed offline as fast as possible
     UNDEFINED
     // NOTE : to be extended
 };
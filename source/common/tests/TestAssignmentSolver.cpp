@@ -0,0 +1,66 @@
+#include "TestAssignmentSolver.hpp"
+
+#include "AssignmentSolver.hpp"
+
+/*!
+ * Tests that the solution is globally optimal where the greedy one isn't.
+ */
+void TestAssignmentSolver::optimalAssignment()
+{
+    // the greedy choice for the first row (column 0) forces the second row to
+    // take the expensive column
+    cv::Mat_<double> costs = (cv::Mat_<double>(2, 2) << 1, 2,
+                                                        2, 10);
+    std::vector<int> assignment = AssignmentSolver::solve(costs);
+    QCOMPARE(assignment, std::vector<int>({1, 0}));
+
+    costs = (cv::Mat_<double>(3, 3) << 4, 1, 3,
+                                       2, 0, 5,
+                                       3, 2, 2);
+    assignment = AssignmentSolver::solve(costs);
+    QCOMPARE(assignment, std::vector<int>({1, 0, 2}));
+}
+
+/*!
+ * Tests the matrices with more rows or more columns.
+ */
+void TestAssignmentSolver::rectangularAssignment()
+{
+    cv::Mat_<double> costs = (cv::Mat_<double>(2, 3) << 5, 1, 7,
+                                                        1, 2, 9);
+    std::vector<int> assignment = AssignmentSolver::solve(costs);
+    QCOMPARE(assignment, std::vector<int>({1, 0}));
+
+    costs = (cv::Mat_<double>(3, 2) << 5, 1,
+                                       7, 9,
+                                       1, 2);
+    assignment = AssignmentSolver::solve(costs);
+    QCOMPARE(assignment, std::vector<int>({1, -1, 0}));
+
+    QVERIFY(AssignmentSolver::solve(cv::Mat_<double>()).empty());
+}
+
+/*!
+ * Tests that the forbidden pairs are never matched.
+ */
+void TestAssignmentSolver::forbiddenPairs()
+{
+    const double forbidden = AssignmentSolver::Forbidden;
+
+    // the number of the allowed pairs is maximized before the cost
+    cv::Mat_<double> costs = (cv::Mat_<double>(2, 2) << 1, 100,
+                                                        1, forbidden);
+    std::vector<int> assignment = AssignmentSolver::solve(costs);
+    QCOMPARE(assignment, std::vector<int>({1, 0}));
+
+    costs = (cv::Mat_<double>(2, 2) << 1, forbidden,
+                                       forbidden, forbidden);
+    assignment = AssignmentSolver::solve(costs);
+    QCOMPARE(assignment, std::vector<int>({0, -1}));
+
+    costs = (cv::Mat_<double>(1, 2) << forbidden, forbidden);
+    assignment = AssignmentSolver::solve(costs);
+    QCOMPARE(assignment, std::vector<int>({-1}));
+}
+
+QTEST_MAIN(TestAssignmentSolver)
@@ -0,0 +1,23 @@
+#ifndef CATS2_TEST_ASSIGNMENT_SOLVER_HPP
+#define CATS2_TEST_ASSIGNMENT_SOLVER_HPP
+
+#include <QtTest/QtTest>
+
+/*!
+* \brief This class tests the assignment problem solver.
+*/
+class TestAssignmentSolver : public QObject
+{
+    Q_OBJECT
+private slots:
+    //! Tests that the solution is globally optimal where the greedy one isn't.
+    void optimalAssignment();
+
+    //! Tests the matrices with more rows or more columns.
+    void rectangularAssignment();
+
+    //! Tests that the forbidden pairs are never matched.
+    void forbiddenPairs();
+};
+
+#endif // CATS2_TEST_ASSIGNMENT_SOLVER_HPP
@@ -0,0 +1,208 @@
+#include "TestCameraCalibration.hpp"
+
+#include "CameraCalibration.hpp"
+#include "CoordinatesConversion.hpp"
+#include "AgentState.hpp"
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+//! The calibration of the 512x512 main camera.
+const QString CalibrationFile = QString(CATS2_CONFIG_DIR) +
+        "/camera-calibration/epfl-setup-180/cats2-epfl-main-camera-basler.xml";
+//! The acceptable difference between the interpolated and the precise positions.
+const double PositionToleranceMeters = 0.001; // i.e. 1 mm
+
+/*!
+ * Returns the maximal distance between the interpolated and the precise
+ * positions on the frame, the borders of the given width are not checked.
+ */
+double maxLookupError(CameraCalibration& calibration, QSize frameSize, int margin)
+{
+    double maxError = 0;
+    // the step is not a multiple of the grid's step to check between the nodes
+    for (double y = margin; y < frameSize.height() - margin; y += 7.3) {
+        for (double x = margin; x < frameSize.width() - margin; x += 7.3) {
+            PositionMeters interpolated = calibration.imageToWorld(PositionPixels(x, y));
+            PositionMeters precise = calibration.imageToWorldPrecise(PositionPixels(x, y));
+            maxError = qMax(maxError, interpolated.distance2dTo(precise));
+        }
+    }
+    return maxError;
+}
+
+} // namespace
+
+/*!
+ * Tests that the interpolated positions are close to the precise ones.
+ */
+void TestCameraCalibration::lookupGridAccuracy()
+{
+    QSize frameSize(512, 512);
+    CameraCalibration calibration(CalibrationFile, frameSize);
+    QVERIFY(calibration.isInitialized());
+
+    QVERIFY(maxLookupError(calibration, frameSize, frameSize.width() / 10) < PositionToleranceMeters);
+
+    // the grid's nodes are the precise positions
+    PositionMeters interpolated = calibration.imageToWorld(PositionPixels(256, 128));
+    PositionMeters precise = calibration.imageToWorldPrecise(PositionPixels(256, 128));
+    QVERIFY(interpolated.distance2dTo(precise) < 1e-9);
+
+    // the positions outside of the frame are converted precisely
+    interpolated = calibration.imageToWorld(PositionPixels(-20, 600));
+    precise = calibration.imageToWorldPrecise(PositionPixels(-20, 600));
+    QVERIFY(interpolated.distance2dTo(precise) < 1e-9);
+}
+
+/*!
+ * Tests the lookup grid when the target frame is bigger than the calibration frame.
+ */
+void TestCameraCalibration::scaledTargetFrame()
+{
+    QSize frameSize(1024, 1024);
+    CameraCalibration calibration(CalibrationFile, frameSize);
+    QVERIFY(calibration.isInitialized());
+
+    QVERIFY(maxLookupError(calibration, frameSize, frameSize.width() / 10) < PositionToleranceMeters);
+
+    // the same pixel of both frames is the same world position
+    CameraCalibration calibrationFrameCalibration(CalibrationFile, QSize(512, 512));
+    PositionMeters position = calibration.imageToWorldPrecise(PositionPixels(600, 400));
+    PositionMeters calibrationFramePosition = calibrationFrameCalibration.imageToWorldPrecise(PositionPixels(300, 200));
+    QVERIFY(position.distance2dTo(calibrationFramePosition) < 1e-6);
+}
+
+/*!
+ * Tests that the states' conversion gives the same results as the conversion
+ * of the positions and the orientations one by one.
+ */
+void TestCameraCalibration::statesConversion()
+{
+    QSize frameSize(512, 512);
+    CameraCalibration calibration(CalibrationFile, frameSize);
+    QVERIFY(calibration.isInitialized());
+
+    // the last state is outside of the frame
+    QList<StateImage> imageStates;
+    imageStates << StateImage(PositionPixels(100, 120), OrientationRad(0.3))
+                << StateImage(PositionPixels(256.5, 300.2), OrientationRad(-2.1))
+                << StateImage(PositionPixels(400, 80), OrientationRad(M_PI_2))
+                << StateImage(PositionPixels(530, -10), OrientationRad(1));
+
+    QList<StateWorld> worldStates = calibration.imageToWorld(imageStates);
+    QCOMPARE(worldStates.size(), imageStates.size());
+    for (int index = 0; index < imageStates.size(); index++) {
+        const StateImage& imageState = imageStates[index];
+        PositionMeters position = calibration.imageToWorld(imageState.position());
+        OrientationRad orientation = calibration.imageToWorldOrientation(imageState.position(),
+                                                                         imageState.orientation());
+        QVERIFY(worldStates[index].position().distance2dTo(position) < 1e-9);
+        QVERIFY(qAbs(worldStates[index].orientation().angleRad() - orientation.angleRad()) < 1e-9);
+    }
+
+    // an empty list is accepted
+    QVERIFY(calibration.imageToWorld(QList<StateImage>()).isEmpty());
+}
+
+/*!
+ * Tests that the world to image conversion of the lists gives the same results
+ * as the conversion one by one.
+ */
+void TestCameraCalibration::worldToImageConversion()
+{
+    CoordinatesConversion coordinatesConversion(CalibrationFile, QSize(512, 512));
+    QVERIFY(coordinatesConversion.isValid());
+
+    // the last state is not valid
+    QList<StateWorld> worldStates;
+    worldStates << StateWorld(PositionMeters(0.1, -0.05), OrientationRad(0.3))
+                << StateWorld(PositionMeters(-0.2, 0.15), OrientationRad(-2.1))
+                << StateWorld(PositionMeters(0, 0), OrientationRad(M_PI_2))
+                << StateWorld(PositionMeters(0.3, 0.3, 0, false), OrientationRad(1));
+
+    QList<StateImage> imageStates = coordinatesConversion.worldToImageStates(worldStates);
+    QList<PositionMeters> worldPositions;
+    foreach (const StateWorld& worldState, worldStates)
+        worldPositions.append(worldState.position());
+    QList<PositionPixels> imagePositions = coordinatesConversion.worldToImagePositions(worldPositions);
+    QCOMPARE(imageStates.size(), worldStates.size());
+    QCOMPARE(imagePositions.size(), worldStates.size());
+    for (int index = 0; index < worldStates.size(); index++) {
+        const StateWorld& worldState = worldStates[index];
+        PositionPixels position = coordinatesConversion.worldToImagePosition(worldState.position());
+        OrientationRad orientation = coordinatesConversion.worldToImageOrientation(worldState.position(),
+                                                                                   worldState.orientation());
+        QVERIFY(qAbs(imageStates[index].position().x() - position.x()) < 1e-6);
+        QVERIFY(qAbs(imageStates[index].position().y() - position.y()) < 1e-6);
+        QVERIFY(qAbs(imagePositions[index].x() - position.x()) < 1e-6);
+        QVERIFY(qAbs(imagePositions[index].y() - position.y()) < 1e-6);
+        QCOMPARE(imageStates[index].position().isValid(), position.isValid());
+        QCOMPARE(imageStates[index].orientation().isValid(), orientation.isValid());
+        if (orientation.isValid())
+            QVERIFY(qAbs(imageStates[index].orientation().angleRad() - orientation.angleRad()) < 1e-6);
+    }
+
+    // the validity is kept in the reverse conversion
+    QList<PositionMeters> backPositions = coordinatesConversion.imageToWorldPositions(imagePositions);
+    QCOMPARE(backPositions.size(), imagePositions.size());
+    QVERIFY(backPositions.first().isValid());
+    QVERIFY(!backPositions.last().isValid());
+}
+
+/*!
+ * Tests that the conversions give the same results from several threads.
+ */
+void TestCameraCalibration::concurrentConversions()
+{
+    CoordinatesConversion coordinatesConversion(CalibrationFile, QSize(512, 512));
+    QVERIFY(coordinatesConversion.isValid());
+
+    QList<StateImage> imageStates;
+    for (int index = 0; index < 100; index++)
+        imageStates << StateImage(PositionPixels(50 + 4.1 * index, 450 - 3.7 * index), OrientationRad(0.05 * index));
+    QList<StateWorld> referenceStates = coordinatesConversion.imageToWorldStates(imageStates);
+
+    const int NumberOfThreads = 4;
+    std::vector<int> mismatches(NumberOfThreads, 0);
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < NumberOfThreads; thread++) {
+        threads.push_back(std::thread([&, thread]()
+        {
+            for (int iteration = 0; iteration < 100; iteration++) {
+                QList<StateWorld> worldStates = coordinatesConversion.imageToWorldStates(imageStates);
+                QList<StateImage> backStates = coordinatesConversion.worldToImageStates(worldStates);
+                for (int index = 0; index < worldStates.size(); index++) {
+                    if ((worldStates[index].position().distance2dTo(referenceStates[index].position()) > 0) ||
+                            (backStates.size() != worldStates.size()))
+                        mismatches[thread]++;
+                }
+            }
+        }));
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    for (int threadMismatches : mismatches)
+        QCOMPARE(threadMismatches, 0);
+}
+
+/*!
+ * Tests that nothing is converted without the calibration.
+ */
+void TestCameraCalibration::missingCalibration()
+{
+    CoordinatesConversion coordinatesConversion("missing-calibration.xml", QSize(512, 512));
+    QVERIFY(!coordinatesConversion.isValid());
+
+    QList<StateImage> imageStates;
+    imageStates << StateImage(PositionPixels(100, 120), OrientationRad(0.3));
+    QList<StateWorld> worldStates = coordinatesConversion.imageToWorldStates(imageStates);
+    QCOMPARE(worldStates.size(), 1);
+    QVERIFY(!worldStates.first().position().isValid());
+    QVERIFY(!worldStates.first().orientation().isValid());
+}
+
+QTEST_MAIN(TestCameraCalibration)
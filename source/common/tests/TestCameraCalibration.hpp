@@ -0,0 +1,34 @@
+#ifndef CATS2_TEST_CAMERA_CALIBRATION_HPP
+#define CATS2_TEST_CAMERA_CALIBRATION_HPP
+
+#include <QtTest/QtTest>
+
+/*!
+* \brief This class tests the image to world lookup grid of the camera calibration.
+*/
+class TestCameraCalibration : public QObject
+{
+    Q_OBJECT
+private slots:
+    //! Tests that the interpolated positions are close to the precise ones.
+    void lookupGridAccuracy();
+
+    //! Tests the lookup grid when the target frame is bigger than the calibration frame.
+    void scaledTargetFrame();
+
+    //! Tests that the states' conversion gives the same results as the
+    //! conversion of the positions and the orientations one by one.
+    void statesConversion();
+
+    //! Tests that the world to image conversion of the lists gives the same
+    //! results as the conversion one by one.
+    void worldToImageConversion();
+
+    //! Tests that the conversions give the same results from several threads.
+    void concurrentConversions();
+
+    //! Tests that nothing is converted without the calibration.
+    void missingCalibration();
+};
+
+#endif // CATS2_TEST_CAMERA_CALIBRATION_HPP
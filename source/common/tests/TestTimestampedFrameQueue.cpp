@@ -0,0 +1,115 @@
+#include "TestTimestampedFrameQueue.hpp"
+
+#include "TimestampedFrame.hpp"
+#include "TimestampClock.hpp"
+
+#include <atomic>
+#include <thread>
+
+/*!
+ * Tests that the full drop-oldest queue drops its head for the new frame.
+ */
+void TestTimestampedFrameQueue::dropOldest()
+{
+    TimestampedFrameQueue queue(QueuePolicy::dropOldest(3));
+    for (int i = 1; i <= 3; ++i)
+        queue.enqueue(TimestampedFrame(cv::Mat(), std::chrono::microseconds(i)));
+    QCOMPARE(queue.size(), size_t(3));
+
+    // the newest frame is kept, the oldest one is dropped
+    queue.enqueue(TimestampedFrame(cv::Mat(), std::chrono::microseconds(4)));
+    QCOMPARE(queue.size(), size_t(3));
+    QCOMPARE(queue.droppedFrames(), 1ULL);
+
+    TimestampedFrame frame;
+    for (int i = 2; i <= 4; ++i) {
+        QVERIFY(queue.dequeue(frame));
+        QCOMPARE(frame.timestamp(), std::chrono::microseconds(i));
+    }
+}
+
+/*!
+ * Tests that the given number of the oldest frames is dropped at once.
+ */
+void TestTimestampedFrameQueue::dropOldestCount()
+{
+    TimestampedFrameQueue queue(QueuePolicy::dropOldest(4, 2));
+    for (int i = 1; i <= 5; ++i)
+        queue.enqueue(TimestampedFrame(cv::Mat(), std::chrono::microseconds(i)));
+    QCOMPARE(queue.size(), size_t(3));
+    QCOMPARE(queue.droppedFrames(), 2ULL);
+
+    TimestampedFrame frame;
+    QVERIFY(queue.dequeue(frame));
+    QCOMPARE(frame.timestamp(), std::chrono::microseconds(3));
+}
+
+/*!
+ * Tests that the latest-only queue keeps only the newest frame.
+ */
+void TestTimestampedFrameQueue::latestOnly()
+{
+    TimestampedFrameQueue queue(QueuePolicy::latestOnly());
+    for (int i = 1; i <= 3; ++i)
+        queue.enqueue(TimestampedFrame(cv::Mat(), std::chrono::microseconds(i)));
+    QCOMPARE(queue.size(), size_t(1));
+    QCOMPARE(queue.droppedFrames(), 2ULL);
+
+    TimestampedFrame frame;
+    QVERIFY(queue.dequeue(frame));
+    QCOMPARE(frame.timestamp(), std::chrono::microseconds(3));
+    // the mailbox is empty now
+    QVERIFY(!queue.dequeue(frame));
+}
+
+/*!
+ * Tests that the max-age queue skips the stale frames at dequeue.
+ */
+void TestTimestampedFrameQueue::maxAge()
+{
+    TimestampedFrameQueue queue(QueuePolicy::maxAge(std::chrono::milliseconds(50)));
+    std::chrono::microseconds staleTimestamp = TimestampClock::now();
+    queue.enqueue(TimestampedFrame(cv::Mat(), staleTimestamp));
+    QTest::qSleep(100);
+    std::chrono::microseconds freshTimestamp = TimestampClock::now();
+    queue.enqueue(TimestampedFrame(cv::Mat(), freshTimestamp));
+
+    // the stale frame is dropped, the fresh one is returned
+    TimestampedFrame frame;
+    QVERIFY(queue.dequeue(frame));
+    QCOMPARE(frame.timestamp(), freshTimestamp);
+    QCOMPARE(queue.droppedFrames(), 1ULL);
+}
+
+/*!
+ * Tests that the producer of the full blocking queue waits until the consumer
+ * dequeues a frame, and that no frame is dropped.
+ */
+void TestTimestampedFrameQueue::blocking()
+{
+    TimestampedFrameQueue queue(QueuePolicy::blocking(1));
+    QVERIFY(queue.tryEnqueue(TimestampedFrame(cv::Mat(), std::chrono::microseconds(1))));
+
+    // the producer waits for the free place
+    std::atomic_bool enqueued(false);
+    std::thread producer([&queue, &enqueued]()
+    {
+        while (!queue.tryEnqueue(TimestampedFrame(cv::Mat(), std::chrono::microseconds(2)))) { }
+        enqueued = true;
+    });
+    QTest::qSleep(100);
+    QVERIFY(!enqueued);
+
+    // the consumer frees the place
+    TimestampedFrame frame;
+    QVERIFY(queue.dequeue(frame));
+    QCOMPARE(frame.timestamp(), std::chrono::microseconds(1));
+    producer.join();
+    QVERIFY(enqueued);
+
+    QVERIFY(queue.dequeue(frame));
+    QCOMPARE(frame.timestamp(), std::chrono::microseconds(2));
+    QCOMPARE(queue.droppedFrames(), 0ULL);
+}
+
+QTEST_MAIN(TestTimestampedFrameQueue)
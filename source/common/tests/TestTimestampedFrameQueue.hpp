@@ -0,0 +1,30 @@
+#ifndef CATS2_TEST_TIMESTAMPED_FRAME_QUEUE_HPP
+#define CATS2_TEST_TIMESTAMPED_FRAME_QUEUE_HPP
+
+#include <QtTest/QtTest>
+
+/*!
+* \brief This class tests the policies of the timestamped frame queue.
+*/
+class TestTimestampedFrameQueue : public QObject
+{
+    Q_OBJECT
+private slots:
+    //! Tests that the full drop-oldest queue drops its head for the new frame.
+    void dropOldest();
+
+    //! Tests that the given number of the oldest frames is dropped at once.
+    void dropOldestCount();
+
+    //! Tests that the latest-only queue keeps only the newest frame.
+    void latestOnly();
+
+    //! Tests that the max-age queue skips the stale frames at dequeue.
+    void maxAge();
+
+    //! Tests that the producer of the full blocking queue waits until the
+    //! consumer dequeues a frame.
+    void blocking();
+};
+
+#endif // CATS2_TEST_TIMESTAMPED_FRAME_QUEUE_HPP
@@ -0,0 +1,182 @@
+#include "FrameBufferPool.hpp"
+
+#include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
+
+#include <algorithm>
+
+/*!
+ * Constructor. Gets the size and type of the images and the maximal number of
+ * buffers to keep.
+ */
+FrameBufferPool::FrameBufferPool(cv::Size frameSize, int type, int capacity) :
+    cv::MatAllocator(),
+    m_frameSize(frameSize),
+    m_type(CV_MAT_TYPE(type)),
+    m_bufferSize(static_cast<size_t>(frameSize.area()) * CV_ELEM_SIZE(type)),
+    m_capacity(std::max(capacity, 0)),
+    m_freeBuffers(),
+    m_allocated(0),
+    m_released(false),
+    m_mutex(),
+    m_hits(0),
+    m_misses(0),
+    m_inUse(0),
+    m_highWaterMark(0)
+{
+    // reserve the place for all the buffers so that returning them to the pool
+    // never allocates
+    m_freeBuffers.reserve(m_capacity);
+}
+
+/*!
+ * Destructor. Frees all the buffers, at this point they are all returned.
+ */
+FrameBufferPool::~FrameBufferPool()
+{
+    Statistics poolStatistics = statistics();
+    qDebug() << QString("Destroying the frame buffer pool: %1 hits, %2 misses, "
+                        "%3 buffers allocated, high-water mark %4")
+                .arg(poolStatistics.hits)
+                .arg(poolStatistics.misses)
+                .arg(poolStatistics.allocated)
+                .arg(poolStatistics.highWaterMark);
+
+    for (cv::UMatData* buffer : m_freeBuffers) {
+        cv::fastFree(buffer->origdata);
+        buffer->data = buffer->origdata = nullptr;
+        delete buffer;
+    }
+}
+
+/*!
+ * Releases the pool by its owner, the pool is destroyed as soon as all its
+ * buffers are returned.
+ */
+void FrameBufferPool::release(FrameBufferPool* pool)
+{
+    if (pool == nullptr)
+        return;
+
+    bool destroy = false;
+    {
+        QMutexLocker locker(&pool->m_mutex);
+        pool->m_released = true;
+        destroy = (pool->m_freeBuffers.size() == pool->m_allocated);
+    }
+    if (destroy)
+        delete pool;
+}
+
+/*!
+ * Returns an image of the pool's size and type. Its buffer is taken from the
+ * pool when possible, otherwise it's allocated on the heap.
+ */
+cv::Mat FrameBufferPool::acquire()
+{
+    cv::Mat image;
+    image.allocator = this;
+    image.create(m_frameSize, m_type);
+    // the buffer keeps the pointer to the pool to be returned to it; the header
+    // must not, otherwise its copies would take their new data from the pool
+    image.allocator = nullptr;
+    return image;
+}
+
+/*!
+ * Returns the usage statistics.
+ */
+FrameBufferPool::Statistics FrameBufferPool::statistics() const
+{
+    Statistics poolStatistics;
+    poolStatistics.hits = m_hits;
+    poolStatistics.misses = m_misses;
+    poolStatistics.inUse = m_inUse;
+    poolStatistics.highWaterMark = m_highWaterMark;
+    poolStatistics.capacity = m_capacity;
+    {
+        QMutexLocker locker(&m_mutex);
+        poolStatistics.allocated = m_allocated;
+    }
+    return poolStatistics;
+}
+
+/*!
+ * Allocates the image data. The images of the pool's size and type are served
+ * from the pool, the rest is forwarded to the standard allocator.
+ */
+cv::UMatData* FrameBufferPool::allocate(int dims, const int* sizes, int type,
+                                        void* data, size_t* step, int flags,
+                                        cv::UMatUsageFlags usageFlags) const
+{
+    bool poolFormat = (data == nullptr) && (dims == 2) &&
+            (sizes[0] == m_frameSize.height) && (sizes[1] == m_frameSize.width) &&
+            (CV_MAT_TYPE(type) == m_type);
+
+    cv::UMatData* buffer = nullptr;
+    if (poolFormat) {
+        QMutexLocker locker(&m_mutex);
+        if (!m_freeBuffers.isEmpty()) {
+            buffer = m_freeBuffers.takeLast();
+            ++m_hits;
+        } else if (m_allocated < m_capacity) {
+            // the pool is not yet full, allocate a new buffer
+            buffer = new cv::UMatData(this);
+            buffer->data = buffer->origdata = static_cast<uchar*>(cv::fastMalloc(m_bufferSize));
+            buffer->size = m_bufferSize;
+            ++m_allocated;
+            ++m_misses;
+        }
+    }
+
+    if (buffer == nullptr) {
+        // all the buffers are in use or the format is not supported
+        if (poolFormat)
+            ++m_misses;
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+
+    if (step) {
+        step[1] = CV_ELEM_SIZE(type);
+        step[0] = step[1] * sizes[1];
+    }
+
+    // update the high-water mark
+    int inUse = ++m_inUse;
+    int highWaterMark = m_highWaterMark;
+    while ((inUse > highWaterMark) &&
+           !m_highWaterMark.compare_exchange_weak(highWaterMark, inUse)) { }
+
+    return buffer;
+}
+
+/*!
+ * Allocates the data for a given UMatData, the pool buffers are always
+ * allocated.
+ */
+bool FrameBufferPool::allocate(cv::UMatData* data, int /*accessflags*/,
+                               cv::UMatUsageFlags /*usageFlags*/) const
+{
+    return (data != nullptr);
+}
+
+/*!
+ * Returns the buffer to the pool. Called by OpenCV when the last header
+ * referring to the buffer is released.
+ */
+void FrameBufferPool::deallocate(cv::UMatData* data) const
+{
+    if (data == nullptr)
+        return;
+
+    --m_inUse;
+    bool destroy = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_freeBuffers.append(data);
+        destroy = m_released && (m_freeBuffers.size() == m_allocated);
+    }
+    // the owner has already released the pool, and this was the last buffer
+    if (destroy)
+        delete this;
+}
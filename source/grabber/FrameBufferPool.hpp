@@ -0,0 +1,103 @@
+#ifndef CATS2_FRAME_BUFFER_POOL_HPP
+#define CATS2_FRAME_BUFFER_POOL_HPP
+
+#include <opencv2/core/core.hpp>
+
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+
+#include <atomic>
+
+/*!
+ * \brief The pool of the frame image buffers that recycles the buffers once
+ * the last consumer releases them.
+ *
+ * The pool is an OpenCV allocator: the images acquired from the pool are
+ * normal reference counted cv::Mat objects, and when the last header referring
+ * to the image is released the buffer returns to the pool instead of being
+ * freed. The buffers are allocated lazily up to the capacity, when all of them
+ * are in use the images are allocated on the heap as usual (and counted as
+ * misses), hence in the steady state the grabbing does no frame allocations.
+ *
+ * The pool can be released by its owner while some of its buffers are still
+ * in use (e.g. sitting in the queues), in this case it is destroyed when the
+ * last buffer is returned.
+ */
+class FrameBufferPool : public cv::MatAllocator
+{
+public:
+    //! The pool usage counters.
+    struct Statistics
+    {
+        //! The number of images served with a recycled buffer.
+        unsigned long long hits = 0;
+        //! The number of images that needed a new allocation.
+        unsigned long long misses = 0;
+        //! The number of pool buffers currently in use.
+        int inUse = 0;
+        //! The maximal number of pool buffers used at the same time.
+        int highWaterMark = 0;
+        //! The number of buffers allocated by the pool.
+        int allocated = 0;
+        //! The maximal number of buffers in the pool.
+        int capacity = 0;
+    };
+
+public:
+    //! Constructor. Gets the size and type of the images and the maximal
+    //! number of buffers to keep.
+    explicit FrameBufferPool(cv::Size frameSize, int type, int capacity);
+
+    //! Releases the pool by its owner, the pool is destroyed as soon as all
+    //! its buffers are returned. Used as a deleter for the shared pointer.
+    static void release(FrameBufferPool* pool);
+
+public:
+    //! Returns an image of the pool's size and type. Its buffer is taken from
+    //! the pool when possible, otherwise it's allocated on the heap.
+    cv::Mat acquire();
+    //! Returns the usage statistics.
+    Statistics statistics() const;
+
+public:
+    //! Allocates the image data. Overriden from cv::MatAllocator.
+    virtual cv::UMatData* allocate(int dims, const int* sizes, int type,
+                                   void* data, size_t* step, int flags,
+                                   cv::UMatUsageFlags usageFlags) const override;
+    //! Allocates the data for a given UMatData. Overriden from cv::MatAllocator.
+    virtual bool allocate(cv::UMatData* data, int accessflags,
+                          cv::UMatUsageFlags usageFlags) const override;
+    //! Returns the buffer to the pool. Overriden from cv::MatAllocator.
+    virtual void deallocate(cv::UMatData* data) const override;
+
+private:
+    //! Destructor. Private as the pool is destroyed via release().
+    virtual ~FrameBufferPool();
+
+private:
+    //! The image size.
+    const cv::Size m_frameSize;
+    //! The image type.
+    const int m_type;
+    //! The size of one buffer.
+    const size_t m_bufferSize;
+    //! The maximal number of buffers.
+    const int m_capacity;
+
+    //! The buffers ready to be reused.
+    mutable QVector<cv::UMatData*> m_freeBuffers;
+    //! The number of buffers allocated by the pool.
+    mutable int m_allocated;
+    //! The flag that is set when the owner released the pool.
+    mutable bool m_released;
+    //! Protects the free buffers list, the allocated counter and the release flag.
+    mutable QMutex m_mutex;
+
+    //! The usage counters.
+    mutable std::atomic<unsigned long long> m_hits;
+    mutable std::atomic<unsigned long long> m_misses;
+    mutable std::atomic_int m_inUse;
+    mutable std::atomic_int m_highWaterMark;
+};
+
+#endif // CATS2_FRAME_BUFFER_POOL_HPP
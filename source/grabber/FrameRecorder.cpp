@@ -0,0 +1,247 @@
+#include "FrameRecorder.hpp"
+
+#include <MetricsRegistry.hpp>
+#include <TimestampedFrame.hpp>
+
+#include <QGst/Parse>
+#include <QGst/Buffer>
+#include <QGst/Caps>
+#include <QGlib/Error>
+
+#include <QtCore/QDebug>
+
+#include <algorithm>
+#include <cstring>
+
+constexpr int FrameRecorder::EndOfStreamTimeOutSec;
+
+/*!
+ * Constructor.
+ */
+FrameRecorder::FrameRecorder(TimestampedFrameQueuePtr inputQueue,
+                             RecordingDescription parameters,
+                             QString outputFilePath,
+                             QString metricsPrefix) :
+    QObject(),
+    m_inputQueue(inputQueue),
+    m_parameters(parameters),
+    m_outputFilePath(outputFilePath),
+    m_metricsPrefix(metricsPrefix),
+    m_stopped(false),
+    m_pipeline(),
+    m_source(),
+    m_frameBytes(0),
+    m_firstTimestamp(),
+    m_timestampsFile(),
+    m_timestampsStream(),
+    m_recordedFrames(0),
+    m_droppedFrames(0)
+{
+}
+
+/*!
+ * Destructor.
+ */
+FrameRecorder::~FrameRecorder()
+{
+    qDebug() << "Destroying the object";
+}
+
+/*!
+ * Starts the recorder. The pipeline is launched on the first frame as its
+ * format is known only then. The frames are pushed to the pipeline until the
+ * encoder's input is full, then they are dropped.
+ */
+void FrameRecorder::process()
+{
+    if (!m_inputQueue.isNull()) {
+        m_stopped = false;
+        TimestampedFrame frame;
+
+        while (!m_stopped) {
+            if (!m_inputQueue->dequeue(frame))
+                continue;
+
+            const cv::Mat& image = frame.image();
+            if (m_pipeline.isNull()) {
+                if (!startPipeline(image))
+                    break;
+                m_firstTimestamp = frame.timestamp();
+            }
+
+            // the encoder is late
+            if (m_source.currentLevelBytes() + m_frameBytes > m_source.maxBytes()) {
+                ++m_droppedFrames;
+                publishMetrics();
+                continue;
+            }
+
+            GstBuffer* buffer = toBuffer(image);
+            std::chrono::nanoseconds presentationTime = frame.timestamp() - m_firstTimestamp;
+            GST_BUFFER_TIMESTAMP(buffer) = presentationTime.count();
+            if (m_source.pushBuffer(QGst::BufferPtr::wrap(buffer, false)) != QGst::FlowOk) {
+                qDebug() << "The recording pipeline doesn't accept the frames, stopped";
+                break;
+            }
+
+            m_timestampsStream << m_recordedFrames << "\t" << frame.timestamp().count() << "\n";
+            ++m_recordedFrames;
+            publishMetrics();
+        }
+
+        stopPipeline();
+    } else {
+        qDebug() << "Input queue is not set, finishing.";
+    }
+
+    emit finished();
+}
+
+/*!
+ * Stops the recorder.
+ */
+void FrameRecorder::stop()
+{
+    m_stopped = true;
+}
+
+/*!
+ * Launches the pipeline for the frames of the given format. The frames are
+ * converted and encoded in the queue's thread, thus the encoding doesn't
+ * compete with the frames dequeueing.
+ */
+bool FrameRecorder::startPipeline(const cv::Mat& image)
+{
+    QString capsString;
+    switch (image.type()) {
+    case CV_8UC3:
+        capsString = QString("video/x-raw-rgb, bpp=24, depth=24, endianness=4321, "
+                             "red_mask=16711680, green_mask=65280, blue_mask=255, "
+                             "width=%1, height=%2, framerate=0/1");
+        break;
+    case CV_8UC1:
+        capsString = QString("video/x-raw-gray, bpp=8, depth=8, "
+                             "width=%1, height=%2, framerate=0/1");
+        break;
+    default:
+        qDebug() << "Unsupported frame format, the recording is stopped";
+        return false;
+    }
+    capsString = capsString.arg(image.cols).arg(image.rows);
+
+    QString pipelineDescription = QString("appsrc name=recordingsource format=time is-live=true ! queue ! "
+                                          "ffmpegcolorspace ! "
+                                          "x264enc speed-preset=ultrafast tune=zerolatency "
+                                          "bitrate=%1 threads=%2 ! "
+                                          "matroskamux ! "
+                                          "filesink location=%3.mkv")
+            .arg(m_parameters.bitrateKbps)
+            .arg(m_parameters.encoderThreads)
+            .arg(m_outputFilePath);
+
+    m_timestampsFile.setFileName(m_outputFilePath + ".timestamps.txt");
+    if (!m_timestampsFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qDebug() << "Couldn't open the timestamps file" << m_timestampsFile.fileName();
+        return false;
+    }
+    m_timestampsStream.setDevice(&m_timestampsFile);
+    m_timestampsStream << "frame\ttimestampUs\n";
+
+    try {
+        qDebug() << "Launching recording pipeline" << pipelineDescription;
+        m_pipeline = QGst::Parse::launch(pipelineDescription).dynamicCast<QGst::Pipeline>();
+        m_source.setElement(m_pipeline->getElementByName("recordingsource"));
+        m_source.setCaps(QGst::Caps::fromString(capsString));
+        // limit the frames waiting to be encoded
+        m_frameBytes = GST_ROUND_UP_4(image.cols * image.elemSize()) * image.rows;
+        m_source.setMaxBytes(m_frameBytes * std::max(m_parameters.maxPendingFrames, 1));
+
+        m_pipeline->setState(QGst::StatePlaying);
+    }
+    catch (const QGlib::Error & error) {
+        qCritical() << "Failed to launch the recording pipeline:" << error;
+        m_pipeline.clear();
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * Finishes the video file and stops the pipeline. The end of stream is to be
+ * received by the muxer to write a valid file.
+ */
+void FrameRecorder::stopPipeline()
+{
+    if (m_pipeline.isNull())
+        return;
+
+    m_source.endOfStream();
+    GstBus* bus = gst_element_get_bus(GST_ELEMENT(static_cast<GstPipeline*>(m_pipeline)));
+    GstMessage* message = gst_bus_timed_pop_filtered(bus, EndOfStreamTimeOutSec * GST_SECOND,
+                                                     GstMessageType(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    if (message != nullptr)
+        gst_message_unref(message);
+    else
+        qDebug() << "The recording is not finished properly";
+    gst_object_unref(bus);
+
+    try {
+        m_pipeline->setState(QGst::StateNull);
+    }
+    catch (const QGlib::Error & error) {
+        qCritical() << "Failed to stop the recording pipeline:" << error;
+    }
+    m_pipeline.clear();
+
+    m_timestampsStream.flush();
+    m_timestampsFile.close();
+    qDebug() << QString("Recorded %1 frames to %2.mkv, dropped %3 frames")
+                .arg(m_recordedFrames)
+                .arg(m_outputFilePath)
+                .arg(m_droppedFrames);
+}
+
+/*!
+ * Publishes the numbers of the recorded and dropped frames.
+ */
+void FrameRecorder::publishMetrics()
+{
+    if (m_metricsPrefix.isEmpty())
+        return;
+    MetricsRegistry::get().setValue(QString("%1/recordedFrames").arg(m_metricsPrefix), m_recordedFrames);
+    MetricsRegistry::get().setValue(QString("%1/droppedFrames").arg(m_metricsPrefix), m_droppedFrames);
+}
+
+/*!
+ * Makes the GStreamer buffer from the frame's image. When the image rows are
+ * aligned as GStreamer expects it, the buffer points to the image data and
+ * holds a reference on the image, otherwise the data is copied.
+ */
+GstBuffer* FrameRecorder::toBuffer(const cv::Mat& image)
+{
+    size_t rowSize = image.cols * image.elemSize();
+    size_t step = GST_ROUND_UP_4(rowSize);
+
+    if (image.step == step) {
+        GstBuffer* buffer = gst_buffer_new();
+        cv::Mat* heldImage = new cv::Mat(image);
+        GST_BUFFER_DATA(buffer) = heldImage->data;
+        GST_BUFFER_SIZE(buffer) = step * image.rows;
+        GST_BUFFER_MALLOCDATA(buffer) = reinterpret_cast<guint8*>(heldImage);
+        GST_BUFFER_FREE_FUNC(buffer) = &FrameRecorder::releaseImage;
+        return buffer;
+    }
+
+    GstBuffer* buffer = gst_buffer_new_and_alloc(step * image.rows);
+    for (int row = 0; row < image.rows; ++row)
+        std::memcpy(GST_BUFFER_DATA(buffer) + row * step, image.ptr(row), rowSize);
+    return buffer;
+}
+
+/*!
+ * Releases the image held by the GStreamer buffer.
+ */
+void FrameRecorder::releaseImage(gpointer image)
+{
+    delete reinterpret_cast<cv::Mat*>(image);
+}
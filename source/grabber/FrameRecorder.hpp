@@ -0,0 +1,99 @@
+#ifndef CATS2_FRAME_RECORDER_HPP
+#define CATS2_FRAME_RECORDER_HPP
+
+#include "settings/GrabberSettings.hpp"
+
+#include <CommonPointerTypes.hpp>
+
+#include <QGst/Pipeline>
+#include <QGst/Utils/ApplicationSource>
+
+#include <gst/gst.h>
+
+#include <opencv2/core/core.hpp>
+
+#include <QtCore/QFile>
+#include <QtCore/QObject>
+#include <QtCore/QTextStream>
+
+#include <atomic>
+#include <chrono>
+
+/*!
+ * \brief This class records the frames from a queue to a video file. The
+ * frames are handed to a GStreamer pipeline that encodes them in its own
+ * threads, and their timestamps are written to a text file next to the video.
+ * When the encoder doesn't keep up the frames are dropped.
+ * Runs in a separated thread.
+ */
+class FrameRecorder : public QObject
+{
+    Q_OBJECT
+public:
+    //! Constructor. Gets the queue to record, the recording parameters, the
+    //! output file path without the extension and the prefix of the metrics,
+    //! no metrics are reported if it's empty.
+    explicit FrameRecorder(TimestampedFrameQueuePtr inputQueue,
+                           RecordingDescription parameters,
+                           QString outputFilePath,
+                           QString metricsPrefix = QString());
+    //! Destructor.
+    virtual ~FrameRecorder();
+
+signals:
+    //! Notifies that the recorder is stopped.
+    void finished();
+
+public slots:
+    //! Starts the recorder.
+    void process();
+    //! Stops the recorder.
+    void stop();
+
+private:
+    //! Launches the pipeline for the frames of the given format.
+    bool startPipeline(const cv::Mat& image);
+    //! Finishes the video file and stops the pipeline.
+    void stopPipeline();
+    //! Makes the GStreamer buffer from the frame's image.
+    static GstBuffer* toBuffer(const cv::Mat& image);
+    //! Releases the image held by the GStreamer buffer.
+    static void releaseImage(gpointer image);
+    //! Publishes the numbers of the recorded and dropped frames.
+    void publishMetrics();
+
+private:
+    //! The queue containing the frames to record.
+    TimestampedFrameQueuePtr m_inputQueue;
+    //! The recording parameters.
+    RecordingDescription m_parameters;
+    //! The output file path without the extension.
+    QString m_outputFilePath;
+    //! The prefix of the metrics.
+    QString m_metricsPrefix;
+    //! The flag that defines if the recorder is to be stopped.
+    std::atomic_bool m_stopped;
+
+    //! The encoding pipeline.
+    QGst::PipelinePtr m_pipeline;
+    //! The source that feeds the pipeline with the frames.
+    QGst::Utils::ApplicationSource m_source;
+    //! The size of the frame's data.
+    size_t m_frameBytes;
+    //! The timestamp of the first recorded frame, the video starts at it.
+    std::chrono::microseconds m_firstTimestamp;
+
+    //! The file to write the timestamps of the recorded frames.
+    QFile m_timestampsFile;
+    //! The text stream to write the timestamps.
+    QTextStream m_timestampsStream;
+    //! The number of the recorded frames.
+    unsigned long long m_recordedFrames;
+    //! The number of the frames dropped because the encoder is late.
+    unsigned long long m_droppedFrames;
+
+    //! The time to wait for the video file to be finished.
+    static constexpr int EndOfStreamTimeOutSec = 5;
+};
+
+#endif // CATS2_FRAME_RECORDER_HPP
@@ -8,14 +8,20 @@
 /*!
 * Constructor.
 */
-GrabberData::GrabberData(StreamDescriptor parameters, QSize targetFrameSize, TimestampedFrameQueuePtr outputQueue) :
+GrabberData::GrabberData(StreamDescriptor parameters, QSize targetFrameSize,
+                         FramePixelFormat pixelFormat,
+                         FrameBuffersDescription frameBuffers,
+                         TimestampedFrameQueuePtr outputQueue,
+                         QString metricsPrefix) :
     QObject(nullptr)
 {
     QThread* thread = new QThread;
-    m_streamReceiver = StreamReceiverPtr(new StreamReceiver(parameters, targetFrameSize, outputQueue));
+    m_streamReceiver = StreamReceiverPtr(new StreamReceiver(parameters, targetFrameSize, pixelFormat,
+                                                            frameBuffers, outputQueue, metricsPrefix));
 
     m_streamReceiver->moveToThread(thread);
     connect(m_streamReceiver.data(), &StreamReceiver::error, this, &GrabberData::onError);
+    connect(m_streamReceiver.data(), &StreamReceiver::endOfStream, this, &GrabberData::endOfStream);
     connect(thread, &QThread::started, m_streamReceiver.data(), &StreamReceiver::process);
     connect(m_streamReceiver.data(), &StreamReceiver::destroyed, thread, &QThread::quit);
     connect(thread, &QThread::finished, thread, &QThread::deleteLater);
@@ -4,6 +4,8 @@
 #include "GrabberPointerTypes.hpp"
 
 #include <CommonPointerTypes.hpp>
+#include "settings/GrabberSettings.hpp"
+
 #include <settings/CommandLineParameters.hpp>
 
 #include <QtCore/QObject>
@@ -17,11 +19,22 @@ class GrabberData : public QObject
 {
     Q_OBJECT
 public:
-    //! Constructor. The target frame size defines the expected video frame resolution.
-    explicit GrabberData(StreamDescriptor parameters, QSize targetFrameSize, TimestampedFrameQueuePtr outputQueue);
+    //! Constructor. The target frame size defines the expected video frame resolution,
+    //! the pixel format - the format of the delivered frames, the frame buffers
+    //! description - how the frame buffers are managed. The frame buffers'
+    //! usage is reported to the metrics registry under the metrics prefix.
+    explicit GrabberData(StreamDescriptor parameters, QSize targetFrameSize,
+                         FramePixelFormat pixelFormat,
+                         FrameBuffersDescription frameBuffers,
+                         TimestampedFrameQueuePtr outputQueue,
+                         QString metricsPrefix = QString());
     //! Destructor.
     virtual ~GrabberData();
 
+signals:
+    //! Emitted when the stream is over, e.g. the replayed video is finished.
+    void endOfStream();
+
 private slots:
     void onError(QString errorMessage);
 
@@ -3,18 +3,24 @@
 #include "GrabberData.hpp"
 #include "settings/GrabberSettings.hpp"
 
+#include <MetricsRegistry.hpp>
 #include <TimestampedFrame.hpp>
 
 /*!
 * Constructor.
 */
 GrabberHandler::GrabberHandler(SetupType::Enum setupType) :
-    m_queue(new TimestampedFrameQueue(100)),
+    m_queue(new TimestampedFrameQueue(queuePolicy(CommandLineParameters::get().cameraDescriptor(setupType)))),
     m_data(new GrabberData(CommandLineParameters::get().cameraDescriptor(setupType),
                            GrabberSettings::get().frameSize(setupType),
-                           m_queue))
+                           GrabberSettings::get().pixelFormat(setupType),
+                           GrabberSettings::get().frameBuffers(setupType),
+                           m_queue,
+                           QString("%1/grabber").arg(SetupType::toSettingsString(setupType))))
 {
-
+    MetricsRegistry::get().registerQueue(QString("%1/grabber")
+                                         .arg(SetupType::toSettingsString(setupType)),
+                                         m_queue);
 }
 
 /*!
@@ -24,3 +30,15 @@ GrabberHandler::~GrabberHandler()
 {
     qDebug() << "Destroying the object";
 }
+
+/*!
+ * Returns the policy of the grabber's queue for the given stream. The replayed
+ * video is processed without dropping frames, the live stream drops the oldest
+ * frames when the consumers are late.
+ */
+QueuePolicy GrabberHandler::queuePolicy(StreamDescriptor streamParameters)
+{
+    if (streamParameters.streamType() == StreamType::REPLAY_VIDEO_FILE)
+        return QueuePolicy::blocking(100);
+    return QueuePolicy::dropOldest(100);
+}
@@ -5,6 +5,8 @@
 
 #include <CommonPointerTypes.hpp>
 #include <SetupType.hpp>
+#include <TimestampedFrame.hpp>
+#include <settings/StreamDescriptor.hpp>
 
 /*!
 * \brief This class manages the creation on the grabber data and the corresponding queue.
@@ -25,6 +27,10 @@ public:
     //! Returns the shared pointer to the queue.
     TimestampedFrameQueuePtr inputQueue() { return m_queue; }
 
+private:
+    //! Returns the policy of the grabber's queue for the given stream.
+    static QueuePolicy queuePolicy(StreamDescriptor streamParameters);
+
 private:
     //! Input queue for the grabber.
     TimestampedFrameQueuePtr m_queue;
@@ -21,5 +21,29 @@ using GrabberHandlerPtr = QSharedPointer<GrabberHandler>;
 class StreamReceiver;
 using StreamReceiverPtr = QSharedPointer<StreamReceiver>;
 
+/*!
+ * The alias for the frame buffer pool shared pointer.
+ */
+class FrameBufferPool;
+using FrameBufferPoolPtr = QSharedPointer<FrameBufferPool>;
+
+/*!
+ * The alias for the GStreamer buffer allocator shared pointer.
+ */
+class GstBufferAllocator;
+using GstBufferAllocatorPtr = QSharedPointer<GstBufferAllocator>;
+
+/*!
+ * The alias for the frame recorder shared pointer.
+ */
+class FrameRecorder;
+using FrameRecorderPtr = QSharedPointer<FrameRecorder>;
+
+/*!
+ * The alias for the recorder handler shared pointer.
+ */
+class RecorderHandler;
+using RecorderHandlerPtr = QSharedPointer<RecorderHandler>;
+
 #endif // CATS2_GRABBER_POINTER_TYPES_HPP
 
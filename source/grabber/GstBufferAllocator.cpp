@@ -0,0 +1,132 @@
+#include "GstBufferAllocator.hpp"
+
+#include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
+
+#include <algorithm>
+
+/*!
+ * Constructor. Gets the maximal number of buffers to hold at the same time.
+ */
+GstBufferAllocator::GstBufferAllocator(int maxSharedBuffers) :
+    cv::MatAllocator(),
+    m_maxSharedBuffers(std::max(maxSharedBuffers, 0)),
+    m_freeDescriptors(),
+    m_inUse(0),
+    m_released(false),
+    m_mutex()
+{
+    // reserve the place for all the descriptors so that releasing the images
+    // never allocates
+    m_freeDescriptors.reserve(m_maxSharedBuffers);
+}
+
+/*!
+ * Destructor. At this point all the buffers are released.
+ */
+GstBufferAllocator::~GstBufferAllocator()
+{
+    qDebug() << "Destroying the object";
+    for (cv::UMatData* descriptor : m_freeDescriptors)
+        delete descriptor;
+}
+
+/*!
+ * Releases the allocator by its owner, it is destroyed as soon as all the
+ * buffers are released.
+ */
+void GstBufferAllocator::release(GstBufferAllocator* allocator)
+{
+    if (allocator == nullptr)
+        return;
+
+    bool destroy = false;
+    {
+        QMutexLocker locker(&allocator->m_mutex);
+        allocator->m_released = true;
+        destroy = (allocator->m_inUse == 0);
+    }
+    if (destroy)
+        delete allocator;
+}
+
+/*!
+ * Wraps the buffer's data in the image holding a reference on the buffer.
+ * Returns an empty image when too many buffers are already held.
+ */
+cv::Mat GstBufferAllocator::wrap(GstBuffer* buffer, cv::Size size, int type, size_t step)
+{
+    if (buffer == nullptr)
+        return cv::Mat();
+
+    cv::UMatData* descriptor = nullptr;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_inUse >= m_maxSharedBuffers)
+            return cv::Mat();
+        if (!m_freeDescriptors.isEmpty())
+            descriptor = m_freeDescriptors.takeLast();
+        else
+            descriptor = new cv::UMatData(this);
+        ++m_inUse;
+    }
+
+    uchar* data = GST_BUFFER_DATA(buffer);
+    descriptor->data = descriptor->origdata = data;
+    descriptor->size = step * size.height;
+    descriptor->flags |= cv::UMatData::USER_ALLOCATED;
+    descriptor->userdata = gst_buffer_ref(buffer);
+
+    // the image points to the buffer's data, and the descriptor makes it
+    // reference counted as if it was allocated by this allocator
+    cv::Mat image(size, type, data, step);
+    image.u = descriptor;
+    image.addref();
+    return image;
+}
+
+/*!
+ * Allocates the image data. The images are never allocated by this class,
+ * hence the request is forwarded to the standard allocator.
+ */
+cv::UMatData* GstBufferAllocator::allocate(int dims, const int* sizes, int type,
+                                           void* data, size_t* step, int flags,
+                                           cv::UMatUsageFlags usageFlags) const
+{
+    return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+}
+
+/*!
+ * Allocates the data for a given UMatData, the wrapped buffers are always
+ * allocated.
+ */
+bool GstBufferAllocator::allocate(cv::UMatData* data, int /*accessflags*/,
+                                  cv::UMatUsageFlags /*usageFlags*/) const
+{
+    return (data != nullptr);
+}
+
+/*!
+ * Releases the GStreamer buffer. Called by OpenCV when the last header
+ * referring to the image is released.
+ */
+void GstBufferAllocator::deallocate(cv::UMatData* data) const
+{
+    if (data == nullptr)
+        return;
+
+    gst_buffer_unref(static_cast<GstBuffer*>(data->userdata));
+    data->userdata = nullptr;
+    data->data = data->origdata = nullptr;
+
+    bool destroy = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_freeDescriptors.append(data);
+        --m_inUse;
+        // the owner has already released the allocator, and this was the last buffer
+        destroy = m_released && (m_inUse == 0);
+    }
+    if (destroy)
+        delete this;
+}
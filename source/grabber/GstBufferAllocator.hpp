@@ -0,0 +1,73 @@
+#ifndef CATS2_GST_BUFFER_ALLOCATOR_HPP
+#define CATS2_GST_BUFFER_ALLOCATOR_HPP
+
+#include <gst/gst.h>
+
+#include <opencv2/core/core.hpp>
+
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+
+#include <atomic>
+
+/*!
+ * \brief The OpenCV allocator that wraps the GStreamer buffers in the images
+ * without copying them.
+ *
+ * The image holds a reference on the GStreamer buffer that is released when
+ * the last header referring to the image is released. The number of the
+ * buffers held at the same time is limited since the sources like v4l2src
+ * have a small fixed buffers pool and stop capturing when it's exhausted.
+ *
+ * As for the frame buffer pool, the allocator can be released by its owner
+ * while some of the images are still in use, in this case it is destroyed
+ * when the last image is released.
+ */
+class GstBufferAllocator : public cv::MatAllocator
+{
+public:
+    //! Constructor. Gets the maximal number of buffers to hold at the same time.
+    explicit GstBufferAllocator(int maxSharedBuffers);
+
+    //! Releases the allocator by its owner, it is destroyed as soon as all the
+    //! buffers are released. Used as a deleter for the shared pointer.
+    static void release(GstBufferAllocator* allocator);
+
+public:
+    //! Wraps the buffer's data in the image holding a reference on the buffer.
+    //! Returns an empty image when too many buffers are already held.
+    cv::Mat wrap(GstBuffer* buffer, cv::Size size, int type, size_t step);
+    //! Returns the number of the buffers currently held by the images.
+    int sharedBuffers() const { return m_inUse; }
+
+public:
+    //! Allocates the image data. Overriden from cv::MatAllocator, the images
+    //! are never allocated by this class, hence the request is forwarded to
+    //! the standard allocator.
+    virtual cv::UMatData* allocate(int dims, const int* sizes, int type,
+                                   void* data, size_t* step, int flags,
+                                   cv::UMatUsageFlags usageFlags) const override;
+    //! Allocates the data for a given UMatData. Overriden from cv::MatAllocator.
+    virtual bool allocate(cv::UMatData* data, int accessflags,
+                          cv::UMatUsageFlags usageFlags) const override;
+    //! Releases the GStreamer buffer. Overriden from cv::MatAllocator.
+    virtual void deallocate(cv::UMatData* data) const override;
+
+private:
+    //! Destructor. Private as the allocator is destroyed via release().
+    virtual ~GstBufferAllocator();
+
+private:
+    //! The maximal number of buffers held at the same time.
+    const int m_maxSharedBuffers;
+    //! The buffers descriptors ready to be reused.
+    mutable QVector<cv::UMatData*> m_freeDescriptors;
+    //! The number of the buffers currently held by the images.
+    mutable std::atomic_int m_inUse;
+    //! The flag that is set when the owner released the allocator.
+    mutable bool m_released;
+    //! Protects the free descriptors list and the release flag.
+    mutable QMutex m_mutex;
+};
+
+#endif // CATS2_GST_BUFFER_ALLOCATOR_HPP
@@ -1,11 +1,17 @@
 #include "QueueingApplicationSink.hpp"
 
+#include "GstBufferAllocator.hpp"
+
+#include <MetricsRegistry.hpp>
 #include <TimestampedFrame.hpp>
+#include <RunTimer.hpp>
+#include <TimestampClock.hpp>
 
 #include <gst/gstcaps.h>
 #include <gst/video/video.h>
 
 #include <QGst/buffer.h>
+#include <QGst/Element>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
@@ -13,16 +19,77 @@
 
 #include <QtGui/QImage>
 
+#include <algorithm>
 #include <chrono>
 
+constexpr std::chrono::nanoseconds QueueingApplicationSink::MaxCaptureDelay;
+constexpr std::chrono::milliseconds QueueingApplicationSink::MetricsPeriodMs;
+
 /*!
- * Constructor. Gets a queue to put the frames in.
+ * Constructor. Gets a queue to put the frames in, the expected frame size, the
+ * pixel format of the frames, the parameters defining how the frame buffers
+ * are managed and the prefix of the buffers' usage metrics.
  */
-QueueingApplicationSink::QueueingApplicationSink(TimestampedFrameQueuePtr outputQueue, QSize expectedFrameSize):
+QueueingApplicationSink::QueueingApplicationSink(TimestampedFrameQueuePtr outputQueue, QSize expectedFrameSize,
+                                                 FramePixelFormat pixelFormat,
+                                                 FrameBuffersDescription frameBuffers,
+                                                 QString metricsPrefix):
      QGst::Utils::ApplicationSink(),
     m_outputQueue(outputQueue),
-    m_expectedFrameSize(expectedFrameSize.width(), expectedFrameSize.height())
+    m_expectedFrameSize(expectedFrameSize.width(), expectedFrameSize.height()),
+    m_pixelFormat(pixelFormat),
+    m_imageType((pixelFormat == FramePixelFormat::GRAY) ? CV_8UC1 : CV_8UC3),
+    m_framePool(new FrameBufferPool(m_expectedFrameSize, m_imageType, poolCapacity(outputQueue, frameBuffers)),
+                &FrameBufferPool::release),
+    m_gstBufferAllocator(),
+    m_metricsPrefix(metricsPrefix),
+    m_metricsTime(),
+    m_replayMode(false),
+    m_stopped(false)
+{
+    if (frameBuffers.shareGStreamerBuffers)
+        m_gstBufferAllocator = GstBufferAllocatorPtr(new GstBufferAllocator(frameBuffers.maxSharedBuffers),
+                                                     &GstBufferAllocator::release);
+}
+
+/*!
+ * Returns the capacity of the frame buffer pool. Unless it's set explicitly,
+ * the pool holds every frame that can be in the output queue, as many frames
+ * again for the hub's output queues that are as deep by default, and the
+ * frames in flight in the consumers, thus the buffers are recycled whatever
+ * the queues' depth and policy are. The buffers are allocated lazily, a
+ * generous capacity costs no memory until it is used.
+ */
+int QueueingApplicationSink::poolCapacity(TimestampedFrameQueuePtr outputQueue,
+                                          const FrameBuffersDescription& frameBuffers)
+{
+    if (frameBuffers.poolCapacity > 0)
+        return frameBuffers.poolCapacity;
+    int queueCapacity = outputQueue.isNull() ? 0 : static_cast<int>(outputQueue->capacity());
+    return 2 * queueCapacity + std::max(frameBuffers.framesInFlight, 0);
+}
+
+/*!
+ * Returns the caps accepted by the sink. For the grayscale frames the planar
+ * YUV formats are accepted along with the gray one: their first plane is the
+ * luminance, hence when the source provides them the colorspace convertor
+ * works in the passthrough mode and no conversion is done at all.
+ */
+QString QueueingApplicationSink::capsString() const
 {
+    QString sizeString = QString("width=%1, height=%2")
+            .arg(m_expectedFrameSize.width)
+            .arg(m_expectedFrameSize.height);
+
+    switch (m_pixelFormat) {
+    case FramePixelFormat::GRAY:
+        return QString("video/x-raw-yuv, format=(fourcc)I420, %1; "
+                       "video/x-raw-yuv, format=(fourcc)NV12, %1; "
+                       "video/x-raw-gray, bpp=8, depth=8, %1").arg(sizeString);
+    case FramePixelFormat::RGB:
+    default:
+        return QString("video/x-raw-rgb, %1").arg(sizeString);
+    }
 }
 
 /*!
@@ -31,6 +98,13 @@ QueueingApplicationSink::QueueingApplicationSink(TimestampedFrameQueuePtr output
 QGst::FlowReturn QueueingApplicationSink::newBuffer()
 {
     QGst::BufferPtr buffer = pullBuffer();
+    // the reception time and the pipeline clock are read as soon as possible,
+    // before the frame is copied, to estimate well the capture time
+    std::chrono::steady_clock::time_point receptionTime = std::chrono::steady_clock::now();
+    std::chrono::microseconds timestamp = m_replayMode ?
+                replayTimestamp(static_cast<GstBuffer*>(buffer), receptionTime) :
+                captureTimestamp(static_cast<GstBuffer*>(buffer), receptionTime);
+    publishMetrics(receptionTime);
 
     if (!buffer.isNull()) {
         // get the image attributes
@@ -55,20 +129,119 @@ QGst::FlowReturn QueueingApplicationSink::newBuffer()
                 return QGst::FlowNotSupported;
             }
 
-            // create the image from the buffer data (it makes a pointer to the data in buffer)
-            cv::Mat image(height, width, CV_8UC3, const_cast<uchar*>(buffer->data()));
-
-            // copy the image to be placed in the queue (to have data in the image out of the buffer)
-            cv::Mat frameImage(height, width, CV_8UC3);
-            image.copyTo(frameImage);
+            // the rows of the raw video in GStreamer are aligned to 4 bytes;
+            // for the planar YUV formats the image is the luminance plane that
+            // comes first in the buffer and is aligned the same way
+            size_t step = GST_ROUND_UP_4(width * CV_ELEM_SIZE(m_imageType));
+
+            // when possible the frame holds a reference on the buffer, thus
+            // the data stays valid after the buffer is dropped here
+            cv::Mat frameImage;
+            if (!m_gstBufferAllocator.isNull())
+                frameImage = m_gstBufferAllocator->wrap(static_cast<GstBuffer*>(buffer), cv::Size(width, height), m_imageType, step);
+
+            if (frameImage.empty()) {
+                // create the image from the buffer data (it makes a pointer to the data in buffer)
+                cv::Mat image(height, width, m_imageType, const_cast<uchar*>(buffer->data()), step);
+
+                // copy the image to be placed in the queue (to have data in the image out of the buffer),
+                // the destination buffer is recycled by the pool when all the consumers release it
+                frameImage = m_framePool->acquire();
+                image.copyTo(frameImage);
+            }
 
-//            buffer.clear();
             // and push it to the queue
-            std::chrono::milliseconds ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
-            TimestampedFrame frame(frameImage, ms);
-            m_outputQueue->enqueue(frame);
+            if (m_replayMode) {
+                TimestampedFrame frame(frameImage, timestamp);
+                // the pipeline waits for the consumer, this way the video is
+                // decoded as fast as it's processed
+                while (!m_outputQueue->tryEnqueue(frame)) {
+                    if (m_stopped)
+                        return QGst::FlowWrongState;
+                }
+            } else {
+                TimestampedFrame frame(frameImage, timestamp);
+                m_outputQueue->enqueue(frame);
+            }
         }
     }
 
     return QGst::FlowOk;
 }
+
+/*!
+ * Publishes the frame buffer pool's statistics and the number of the shared
+ * GStreamer buffers. The high-water mark close to the capacity or the growing
+ * misses mean that the pool is too small for the queues' depth.
+ */
+void QueueingApplicationSink::publishMetrics(std::chrono::steady_clock::time_point now)
+{
+    if (m_metricsPrefix.isEmpty() || (now - m_metricsTime < MetricsPeriodMs))
+        return;
+    m_metricsTime = now;
+
+    FrameBufferPool::Statistics statistics = m_framePool->statistics();
+    MetricsRegistry& metrics = MetricsRegistry::get();
+    metrics.setValue(QString("%1/framePoolHits").arg(m_metricsPrefix), statistics.hits);
+    metrics.setValue(QString("%1/framePoolMisses").arg(m_metricsPrefix), statistics.misses);
+    metrics.setValue(QString("%1/framePoolInUse").arg(m_metricsPrefix), statistics.inUse);
+    metrics.setValue(QString("%1/framePoolHighWaterMark").arg(m_metricsPrefix), statistics.highWaterMark);
+    metrics.setValue(QString("%1/framePoolAllocated").arg(m_metricsPrefix), statistics.allocated);
+    if (!m_gstBufferAllocator.isNull())
+        metrics.setValue(QString("%1/sharedGstBuffers").arg(m_metricsPrefix),
+                         m_gstBufferAllocator->sharedBuffers());
+}
+
+/*!
+ * Computes the frame's timestamp in the replay mode. The buffer's timestamp is
+ * its position in the video, it's counted from the program start so that the
+ * results obtained from the same video are the same for every replay.
+ */
+std::chrono::microseconds QueueingApplicationSink::replayTimestamp(GstBuffer* buffer,
+                                                                   std::chrono::steady_clock::time_point receptionTime) const
+{
+    if ((buffer == nullptr) || !GST_BUFFER_TIMESTAMP_IS_VALID(buffer))
+        return TimestampClock::fromSteady(receptionTime);
+
+    return RunTimer::get().startTime() +
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::nanoseconds(GST_BUFFER_TIMESTAMP(buffer)));
+}
+
+/*!
+ * Computes the frame's capture time from the buffer's timestamp. The live
+ * sources (v4l2src) stamp the buffers with the running time of the pipeline
+ * clock at capture, hence the delay between the capture and the reception is
+ * the difference between the current pipeline clock time and the buffer's
+ * timestamp shifted by the base time. This delay is then subtracted from the
+ * reception time measured on the monotonic clock. If the buffer has no
+ * timestamp or the delay is not plausible (e.g. the buffers come from a file)
+ * the reception time is used instead.
+ */
+std::chrono::microseconds QueueingApplicationSink::captureTimestamp(GstBuffer* buffer,
+                                                                    std::chrono::steady_clock::time_point receptionTime) const
+{
+    std::chrono::microseconds timestamp = TimestampClock::fromSteady(receptionTime);
+    if ((buffer == nullptr) || !GST_BUFFER_TIMESTAMP_IS_VALID(buffer))
+        return timestamp;
+
+    GstElement* sink = static_cast<GstElement*>(element());
+    if (sink == nullptr)
+        return timestamp;
+
+    GstClock* clock = gst_element_get_clock(sink);
+    if (clock == nullptr)
+        return timestamp;
+    GstClockTime clockTime = gst_clock_get_time(clock);
+    gst_object_unref(clock);
+
+    GstClockTime captureClockTime = GST_BUFFER_TIMESTAMP(buffer) + gst_element_get_base_time(sink);
+    if (captureClockTime > clockTime)
+        return timestamp;
+
+    std::chrono::nanoseconds captureDelay(clockTime - captureClockTime);
+    if (captureDelay > MaxCaptureDelay)
+        return timestamp;
+
+    return TimestampClock::fromSteady(receptionTime -
+                                      std::chrono::duration_cast<std::chrono::steady_clock::duration>(captureDelay));
+}
@@ -1,15 +1,24 @@
 #ifndef CATS2_QUEUEING_APPLICATION_SINK_HPP
 #define CATS2_QUEUEING_APPLICATION_SINK_HPP
 
+#include "FrameBufferPool.hpp"
+#include "GrabberPointerTypes.hpp"
+#include "settings/GrabberSettings.hpp"
+
 #include <CommonPointerTypes.hpp>
 
 #include <QGst/Utils/ApplicationSink>
 #include <QGst/Structure>
 
+#include <gst/gst.h>
+
 #include <opencv2/core/core.hpp>
 
 #include <QtCore/QObject>
 
+#include <atomic>
+#include <chrono>
+
 /*!
  * \brief The application sink that puts the recived frames to the queue.
  * Inspired by thsi QtGStreamer example:
@@ -18,18 +27,81 @@
 class QueueingApplicationSink : public QGst::Utils::ApplicationSink
 {
 public:
-    //! Constructor. Gets a queue to put the frames in.
-    explicit QueueingApplicationSink(TimestampedFrameQueuePtr outputQueue, QSize expectedFrameSize);
+    //! Constructor. Gets a queue to put the frames in, the expected frame size,
+    //! the pixel format of the frames, the parameters defining how the frame
+    //! buffers are managed and the prefix of the buffers' usage metrics.
+    explicit QueueingApplicationSink(TimestampedFrameQueuePtr outputQueue, QSize expectedFrameSize,
+                                     FramePixelFormat pixelFormat,
+                                     FrameBuffersDescription frameBuffers,
+                                     QString metricsPrefix);
+
+public:
+    //! Returns the caps accepted by the sink, they define the formats that the
+    //! pipeline negotiates with the source.
+    QString capsString() const;
+
+    //! Sets the replay mode. In this mode the frames are never dropped, the
+    //! sink waits for the consumer instead, and the frames are stamped with
+    //! the buffer's position in the stream counted from the program start.
+    void setReplayMode(bool replayMode) { m_replayMode = replayMode; }
+    //! Unblocks the sink waiting for the consumer, called when the pipeline
+    //! is stopped.
+    void stop() { m_stopped = true; }
 
 protected:
     //! Called when a new sample arrives
     virtual QGst::FlowReturn newBuffer() override;
 
 private:
+    //! Returns the capacity of the frame buffer pool for the given output
+    //! queue and frame buffers parameters.
+    static int poolCapacity(TimestampedFrameQueuePtr outputQueue,
+                            const FrameBuffersDescription& frameBuffers);
+    //! Computes the frame's timestamp in the replay mode.
+    std::chrono::microseconds replayTimestamp(GstBuffer* buffer,
+                                              std::chrono::steady_clock::time_point receptionTime) const;
+    //! Computes the frame's capture time from the buffer's timestamp and the
+    //! pipeline clock, falls back to the reception time when not possible.
+    std::chrono::microseconds captureTimestamp(GstBuffer* buffer,
+                                               std::chrono::steady_clock::time_point receptionTime) const;
+    //! Publishes the frame buffers' usage to the metrics registry, at most
+    //! once per MetricsPeriodMs.
+    void publishMetrics(std::chrono::steady_clock::time_point now);
+
+private:
+    //! The maximal plausible delay between the capture and the reception of a
+    //! frame, bigger delays mean that the buffer's timestamp is not the capture
+    //! time.
+    static constexpr std::chrono::nanoseconds MaxCaptureDelay = std::chrono::seconds(1);
+    //! The period to publish the frame buffers' usage.
+    static constexpr std::chrono::milliseconds MetricsPeriodMs = std::chrono::milliseconds(1000);
+
+
     //! The queue to put incoming frames.
     TimestampedFrameQueuePtr m_outputQueue;
     //! The target frame size.
     cv::Size m_expectedFrameSize;
+    //! The pixel format of the frames.
+    FramePixelFormat m_pixelFormat;
+    //! The OpenCV type of the frames corresponding to the pixel format.
+    int m_imageType;
+    //! The pool of the frame buffers. It's released when the sink is destroyed
+    //! but lives until all its buffers are returned.
+    FrameBufferPoolPtr m_framePool;
+    //! The allocator that wraps the GStreamer buffers in the frames, it's set
+    //! only when the buffers are shared. As the pool it lives until all the
+    //! buffers are released.
+    GstBufferAllocatorPtr m_gstBufferAllocator;
+
+    //! The prefix of the published metrics.
+    QString m_metricsPrefix;
+    //! The last time the metrics were published.
+    std::chrono::steady_clock::time_point m_metricsTime;
+
+    //! The replay mode flag.
+    bool m_replayMode;
+    //! Set when the pipeline is stopped.
+    std::atomic_bool m_stopped;
 };
 
 
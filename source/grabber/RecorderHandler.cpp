@@ -0,0 +1,49 @@
+#include "RecorderHandler.hpp"
+
+#include "FrameRecorder.hpp"
+
+#include <QtCore/QDebug>
+#include <QtCore/QThread>
+
+constexpr unsigned long RecorderHandler::StopTimeOutMs;
+
+/*!
+ * Constructor.
+ */
+RecorderHandler::RecorderHandler(TimestampedFrameQueuePtr inputQueue,
+                                 RecordingDescription parameters,
+                                 QString outputFilePath,
+                                 QString metricsPrefix)
+{
+    // launch the recording in separated thread
+    QThread* thread = new QThread;
+    m_thread = thread;
+    m_recorder = FrameRecorderPtr(new FrameRecorder(inputQueue, parameters, outputFilePath, metricsPrefix),
+                                  &FrameRecorder::deleteLater); // delete later is used for security as multithreaded
+                                                                // signals and slots might result is crashes when a
+                                                                // a sender is deleted before a signal is received for instance
+    m_recorder->moveToThread(thread);
+
+    QObject::connect(thread, &QThread::started, m_recorder.data(), &FrameRecorder::process);
+    // NOTE : direct connection as the destructor blocks the main thread
+    // waiting for the thread to quit
+    QObject::connect(m_recorder.data(), &FrameRecorder::finished, thread, &QThread::quit,
+                     Qt::DirectConnection);
+    QObject::connect(thread, &QThread::finished, thread, &QThread::deleteLater);
+
+    thread->start();
+}
+
+/*!
+ * Destructor. Stops the recorder and waits until it sends the end of stream
+ * and the muxer finalizes the video file, otherwise the file would be
+ * truncated when the application quits right after, e.g. at the end of a
+ * replay.
+ */
+RecorderHandler::~RecorderHandler()
+{
+    qDebug() << "Destroying the object";
+    m_recorder->stop();
+    if (!m_thread.isNull() && !m_thread->wait(StopTimeOutMs))
+        qDebug() << "The recorder is not finished in time, the video file might be truncated";
+}
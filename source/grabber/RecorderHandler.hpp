@@ -0,0 +1,45 @@
+#ifndef CATS2_RECORDER_HANDLER_HPP
+#define CATS2_RECORDER_HANDLER_HPP
+
+#include "GrabberPointerTypes.hpp"
+#include "settings/GrabberSettings.hpp"
+
+#include <CommonPointerTypes.hpp>
+
+#include <QtCore/QPointer>
+#include <QtCore/QString>
+
+class QThread;
+
+/*!
+ * \brief This class manages the video recording from one queue. It creates and
+ * launches a frame recorder in a separated thread.
+ * NOTE : handler classes should managed through smart pointers without using the Qt's mechanism
+ * of ownership.
+ */
+class RecorderHandler
+{
+public:
+    //! Constructor. Gets the queue to record, the recording parameters, the
+    //! output file path without the extension and the prefix of the
+    //! recorder's metrics.
+    explicit RecorderHandler(TimestampedFrameQueuePtr inputQueue,
+                             RecordingDescription parameters,
+                             QString outputFilePath,
+                             QString metricsPrefix = QString());
+    //! Destructor. Waits for the recorder to finish the video file.
+    virtual ~RecorderHandler() final;
+
+private:
+    //! The recorder that writes the frames to the file.
+    //! Doesn't have a Qt owner as it is managed by another thread.
+    FrameRecorderPtr m_recorder;
+    //! The recorder's thread, it deletes itself when finished.
+    QPointer<QThread> m_thread;
+
+    //! The time to wait for the recorder to finish the video file, longer
+    //! than the time the recorder waits for the muxer.
+    static constexpr unsigned long StopTimeOutMs = 10000;
+};
+
+#endif // CATS2_RECORDER_HANDLER_HPP
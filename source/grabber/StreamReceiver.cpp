@@ -13,30 +13,74 @@
 /*!
 * Constructor.
 */
-StreamReceiver::StreamReceiver(StreamDescriptor streamParameters, QSize expectedFrameSize, TimestampedFrameQueuePtr outputQueue) :
+StreamReceiver::StreamReceiver(StreamDescriptor streamParameters, QSize expectedFrameSize,
+                               FramePixelFormat pixelFormat,
+                               FrameBuffersDescription frameBuffers,
+                               TimestampedFrameQueuePtr outputQueue,
+                               QString metricsPrefix) :
     QObject(nullptr),
     m_pipelineDescription(),
-    m_sink(outputQueue, expectedFrameSize),
-    m_restartOnEos(false),
+    m_sink(outputQueue, expectedFrameSize, pixelFormat, frameBuffers, metricsPrefix),
+    m_restartOnEos(streamParameters.streamType() == StreamType::LOCAL_VIDEO_FILE),
     m_expectedFrameSize(expectedFrameSize)
 {
+    m_pipelineDescription = pipelineDescription(streamParameters, pixelFormat, frameBuffers);
+    m_sink.setReplayMode(streamParameters.streamType() == StreamType::REPLAY_VIDEO_FILE);
+}
+
+/*!
+ * Builds the pipeline description for the given stream. For the color frames
+ * the source is converted to RGB. For the grayscale frames the colorspace
+ * convertor is only asked for the luminance: when the source provides a
+ * planar YUV format (most of the cameras and decoders do) the conversion is
+ * skipped, otherwise only the luminance is computed.
+ */
+QString StreamReceiver::pipelineDescription(StreamDescriptor streamParameters,
+                                            FramePixelFormat pixelFormat,
+                                            FrameBuffersDescription frameBuffers)
+{
+    QString description;
+    bool color = (pixelFormat == FramePixelFormat::RGB);
+
     switch (streamParameters.streamType()) {
         case StreamType::VIDEO_4_LINUX:
         {
             int videoDeviceId = streamParameters.parameters().toInt();
-            m_pipelineDescription = QString("v4l2src device=/dev/video%1 ! "
-                                           "video/x-raw-rgb ! ffmpegcolorspace ! "
-                                           "appsink name=queueingsink").arg(videoDeviceId);
+            // when the frames hold the GStreamer buffers the capture needs
+            // more buffers than the two it has by default
+            QString queueSize;
+            if (frameBuffers.shareGStreamerBuffers)
+                queueSize = QString(" queue-size=%1").arg(frameBuffers.maxSharedBuffers + 2);
+            description = QString("v4l2src device=/dev/video%1%2 ! "
+                                  "%3ffmpegcolorspace ! "
+                                  "appsink name=queueingsink")
+                    .arg(videoDeviceId)
+                    .arg(queueSize)
+                    .arg(color ? "video/x-raw-rgb ! " : "");
             break;
         }
         case StreamType::LOCAL_VIDEO_FILE:
         {
-            m_pipelineDescription = QString("filesrc location=%1 ! qtdemux ! "
-                                            "decodebin ! ffmpegcolorspace ! "
-                                            "deinterlace ! "
-                                            "video/x-raw-rgb ! ffmpegcolorspace !"
-                                            "appsink name=queueingsink").arg(streamParameters.parameters());
-            m_restartOnEos = true;
+            description = QString("filesrc location=%1 ! qtdemux ! "
+                                  "decodebin ! ffmpegcolorspace ! "
+                                  "deinterlace ! "
+                                  "%2ffmpegcolorspace !"
+                                  "appsink name=queueingsink")
+                    .arg(streamParameters.parameters())
+                    .arg(color ? "video/x-raw-rgb ! " : "");
+            break;
+        }
+        case StreamType::REPLAY_VIDEO_FILE:
+        {
+            // the sink is not synchronized on the clock, thus the video is
+            // played as fast as the sink takes the frames
+            description = QString("filesrc location=%1 ! qtdemux ! "
+                                  "decodebin ! ffmpegcolorspace ! "
+                                  "deinterlace ! "
+                                  "%2ffmpegcolorspace !"
+                                  "appsink name=queueingsink sync=false")
+                    .arg(streamParameters.parameters())
+                    .arg(color ? "video/x-raw-rgb ! " : "");
             break;
         }
         case StreamType::LOCAL_IMAGE_FILE:
@@ -48,9 +92,9 @@ StreamReceiver::StreamReceiver(StreamDescriptor streamParameters, QSize expected
                     decoder = "pngdec";
                 else if ((fileInfo.suffix() == "jpeg") || (fileInfo.suffix() == "jpg"))
                     decoder = "jpegdec";
-                m_pipelineDescription = QString("filesrc location=%1 ! %2 ! "
-                                                "ffmpegcolorspace ! videoscale ! imagefreeze !"
-                                                "appsink name=queueingsink").arg(streamParameters.parameters()).arg(decoder);
+                description = QString("filesrc location=%1 ! %2 ! "
+                                      "ffmpegcolorspace ! videoscale ! imagefreeze !"
+                                      "appsink name=queueingsink").arg(streamParameters.parameters()).arg(decoder);
             }
             break;
         }
@@ -59,6 +103,8 @@ StreamReceiver::StreamReceiver(StreamDescriptor streamParameters, QSize expected
         default:
             break;
     }
+
+    return description;
 }
 
 /*!
@@ -85,11 +131,8 @@ void StreamReceiver::process()
         m_sink.setElement(m_pipeline->getElementByName("queueingsink"));
         QGlib::connect(m_pipeline->bus(), "message", this, &StreamReceiver::onMessage);
 
-        // set the specific resolution on the video
-        QString capsString = QString("video/x-raw-rgb, width=%1, height=%2")
-                .arg(m_expectedFrameSize.width())
-                .arg(m_expectedFrameSize.height());
-        m_pipeline->getElementByName("queueingsink")->setProperty("caps", QGst::Caps::fromString(capsString));
+        // set the specific resolution and format on the video
+        m_pipeline->getElementByName("queueingsink")->setProperty("caps", QGst::Caps::fromString(m_sink.capsString()));
 
         m_pipeline->bus()->addSignalWatch();
         // start the pipeline
@@ -111,6 +154,8 @@ void StreamReceiver::process()
 void StreamReceiver::stop()
 {
     qDebug() << "Stopping the pipeline";
+    // the sink might wait for the consumer
+    m_sink.stop();
     try {
         m_pipeline->setState(QGst::StateNull);
     }
@@ -158,8 +203,13 @@ void StreamReceiver::onMessage(const QGst::MessagePtr & message)
     switch (message->type()) {
         case QGst::MessageEos:
             informationMessage = "End of stream ";
-            if (m_restartOnEos)
+            if (m_restartOnEos) {
                 restart();
+            } else {
+                qDebug() << informationMessage;
+                stop();
+                emit endOfStream();
+            }
             break;
         case QGst::MessageError:
             informationMessage = message.staticCast<QGst::ErrorMessage>()->error().message();
@@ -20,7 +20,11 @@ class StreamReceiver : public QObject
     Q_OBJECT
 public:
     //! Constructor for a typified input stream.
-    explicit StreamReceiver(StreamDescriptor parameters, QSize expectedFrameSize, TimestampedFrameQueuePtr outputQueue);
+    explicit StreamReceiver(StreamDescriptor parameters, QSize expectedFrameSize,
+                            FramePixelFormat pixelFormat,
+                            FrameBuffersDescription frameBuffers,
+                            TimestampedFrameQueuePtr outputQueue,
+                            QString metricsPrefix = QString());
 
     //! Destructor.
     virtual ~StreamReceiver();
@@ -38,10 +42,17 @@ private slots:
 signals:
     //! Emitted when an error is encountered.
     void error(QString errorMessage);
+    //! Emitted when the stream is over and is not restarted.
+    void endOfStream();
 
 private:
     //! Tries to restart the video stream.
     void restart();
+    //! Builds the pipeline description for the given stream. The colorspace
+    //! conversion is requested only when the pixel format needs it.
+    QString pipelineDescription(StreamDescriptor streamParameters,
+                                FramePixelFormat pixelFormat,
+                                FrameBuffersDescription frameBuffers);
 
 private:
     //! The pipeline description to set the gstreamer.
@@ -34,6 +34,52 @@ bool GrabberSettings::init(QString configurationFileName, SetupType::Enum setupT
                                                                                    // invalid size if the correct valus is not read
     m_targetFrameSizes[setupType] = QSize(width, height);
 
+    // read the frame buffers management parameters
+    FrameBuffersDescription frameBuffers;
+    settings.readVariable(QString("%1/frameBuffers/poolCapacity").arg(prefix),
+                          frameBuffers.poolCapacity, frameBuffers.poolCapacity);
+    settings.readVariable(QString("%1/frameBuffers/framesInFlight").arg(prefix),
+                          frameBuffers.framesInFlight, frameBuffers.framesInFlight);
+    settings.readVariable(QString("%1/frameBuffers/shareGStreamerBuffers").arg(prefix),
+                          frameBuffers.shareGStreamerBuffers, frameBuffers.shareGStreamerBuffers);
+    settings.readVariable(QString("%1/frameBuffers/maxSharedBuffers").arg(prefix),
+                          frameBuffers.maxSharedBuffers, frameBuffers.maxSharedBuffers);
+    m_frameBuffers[setupType] = frameBuffers;
+
+    // read the pixel format, the grayscale frames are enough for the tracking
+    // routines that don't use the color
+    std::string pixelFormat;
+    settings.readVariable(QString("%1/pixelFormat").arg(prefix), pixelFormat, std::string("rgb"));
+    if (pixelFormat == "gray") {
+        m_pixelFormats[setupType] = FramePixelFormat::GRAY;
+    } else {
+        if (pixelFormat != "rgb")
+            qDebug() << "Unknown pixel format" << QString::fromStdString(pixelFormat) << ", using rgb";
+        m_pixelFormats[setupType] = FramePixelFormat::RGB;
+    }
+
+    // read the recording parameters
+    RecordingDescription recording;
+    settings.readVariable(QString("%1/recording/enabled").arg(prefix),
+                          recording.enabled, recording.enabled);
+    std::string outputPath;
+    settings.readVariable(QString("%1/recording/outputPath").arg(prefix),
+                          outputPath, recording.outputPath.toStdString());
+    recording.outputPath = QString::fromStdString(outputPath);
+    settings.readVariable(QString("%1/recording/bitrateKbps").arg(prefix),
+                          recording.bitrateKbps, recording.bitrateKbps);
+    settings.readVariable(QString("%1/recording/encoderThreads").arg(prefix),
+                          recording.encoderThreads, recording.encoderThreads);
+    settings.readVariable(QString("%1/recording/maxPendingFrames").arg(prefix),
+                          recording.maxPendingFrames, recording.maxPendingFrames);
+    m_recordings[setupType] = recording;
+
+    // read the cameras synchronization parameters, they are not setup specific
+    settings.readVariable(QString("frameSets/enabled"),
+                          m_frameSets.enabled, m_frameSets.enabled);
+    settings.readVariable(QString("frameSets/maxSkewMs"),
+                          m_frameSets.maxSkewMs, m_frameSets.maxSkewMs);
+
     // check that the settings are valid
     bool foundTargetFrameSize = m_targetFrameSizes[setupType].isValid();
     if (!foundTargetFrameSize) {
@@ -5,6 +5,90 @@
 #include "SetupType.hpp"
 
 #include <QtCore/QSize>
+#include <QtCore/QString>
+
+/*!
+ * \brief The pixel format of the frames delivered by the grabber.
+ */
+enum class FramePixelFormat
+{
+    RGB,  // 8-bit three channels image, needed by the color based tracking routines
+    GRAY, // 8-bit one channel image, the luminance negotiated directly from the source
+    // NOTE : to be extended
+};
+
+/*!
+ * The parameters defining how the frame buffers are managed by the grabber.
+ */
+struct FrameBuffersDescription
+{
+    //! Initialization.
+    FrameBuffersDescription() :
+        poolCapacity(0),
+        framesInFlight(8),
+        shareGStreamerBuffers(false),
+        maxSharedBuffers(4)
+    {}
+    //! The maximal number of frame buffers kept for recycling. The pool should
+    //! be big enough to hold all the frames that are in the queues at the same
+    //! time, otherwise the frames are allocated on the heap. When 0, it's
+    //! derived from the grabber's queue capacity and the frames in flight.
+    int poolCapacity;
+    //! The number of frames held by the consumers outside the queues, e.g. in
+    //! the tracking pipeline stages, the viewer and the encoder.
+    int framesInFlight;
+    //! When set, the frames hold a reference on the GStreamer buffers instead
+    //! of copying them.
+    bool shareGStreamerBuffers;
+    //! The maximal number of GStreamer buffers held by the frames at the same
+    //! time. The sources like v4l2src have a small buffers pool and stop when
+    //! it's exhausted, hence above this number the frames are copied.
+    int maxSharedBuffers;
+};
+
+/*!
+ * The parameters of the video recording done alongside the tracking.
+ */
+struct RecordingDescription
+{
+    //! Initialization.
+    RecordingDescription() :
+        enabled(false),
+        outputPath("."),
+        bitrateKbps(8000),
+        encoderThreads(0),
+        maxPendingFrames(30)
+    {}
+    //! When set, the frames are recorded.
+    bool enabled;
+    //! The folder to write the video and the timestamps files.
+    QString outputPath;
+    //! The encoding bitrate.
+    int bitrateKbps;
+    //! The number of the encoder threads, 0 to choose automatically.
+    int encoderThreads;
+    //! The maximal number of frames waiting to be encoded, above this number
+    //! the frames are dropped, thus the recording never slows down the tracking.
+    int maxPendingFrames;
+};
+
+/*!
+ * The parameters of the cameras synchronization.
+ */
+struct FrameSetsDescription
+{
+    //! Initialization.
+    FrameSetsDescription() :
+        enabled(false),
+        maxSkewMs(20)
+    {}
+    //! When set, the frames of all the cameras are grouped in frame sets.
+    bool enabled;
+    //! The maximal timestamp difference between the frames of a set. The
+    //! frames keep their timestamps, thus it must stay below the tolerance of
+    //! the tracking results' matching (50 ms, see TrackingDataManager).
+    int maxSkewMs;
+};
 
 /*!
  * Class-signleton that is used to store parameters of the grabber.
@@ -36,6 +120,15 @@ public:
 public:
     //! Returns the size of the video frames.
     QSize frameSize(SetupType::Enum setupType) const { return m_targetFrameSizes[setupType]; }
+    //! Returns the frame buffers management parameters.
+    FrameBuffersDescription frameBuffers(SetupType::Enum setupType) const { return m_frameBuffers.value(setupType); }
+    //! Returns the pixel format of the frames.
+    FramePixelFormat pixelFormat(SetupType::Enum setupType) const { return m_pixelFormats.value(setupType, FramePixelFormat::RGB); }
+    //! Returns the recording parameters.
+    RecordingDescription recording(SetupType::Enum setupType) const { return m_recordings.value(setupType); }
+    //! Returns the cameras synchronization parameters, they are common for
+    //! all the setups.
+    FrameSetsDescription frameSets() const { return m_frameSets; }
 
 private:
     //! Constructor. Defining it here prevents construction.
@@ -47,6 +140,14 @@ private:
     //! Stores the target video frame sizes for every available setup. It's used to
     //! interpolate the calibration values if they were measured for another frame size.
     QMap<SetupType::Enum, QSize> m_targetFrameSizes;
+    //! Stores the frame buffers management parameters for every available setup.
+    QMap<SetupType::Enum, FrameBuffersDescription> m_frameBuffers;
+    //! Stores the pixel format of the frames for every available setup.
+    QMap<SetupType::Enum, FramePixelFormat> m_pixelFormats;
+    //! Stores the recording parameters for every available setup.
+    QMap<SetupType::Enum, RecordingDescription> m_recordings;
+    //! The cameras synchronization parameters.
+    FrameSetsDescription m_frameSets;
 };
 
 
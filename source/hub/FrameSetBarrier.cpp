@@ -0,0 +1,135 @@
+#include "FrameSetBarrier.hpp"
+
+#include <MetricsRegistry.hpp>
+
+#include <algorithm>
+
+/*!
+ * Constructor.
+ */
+FrameSetBarrier::FrameSetBarrier(std::chrono::microseconds maxSkew) :
+    QObject(),
+    m_sources(),
+    m_maxSkew(maxSkew),
+    m_frameSets(0),
+    m_unmatchedFrames(0),
+    m_started(false),
+    m_stopped(false)
+{
+}
+
+/*!
+ * Destructor.
+ */
+FrameSetBarrier::~FrameSetBarrier()
+{
+    qDebug() << "Destroying the object";
+}
+
+/*!
+ * Adds a camera to synchronize. The sources are not protected as the barrier's
+ * thread is the only one to use them once it's started.
+ */
+void FrameSetBarrier::addSource(SetupType::Enum setupType,
+                                TimestampedFrameQueuePtr inputQueue,
+                                TimestampedFrameQueuePtr outputQueue)
+{
+    if (m_started) {
+        qDebug() << "The barrier is already started, the source"
+                 << SetupType::toString(setupType) << "is ignored";
+        return;
+    }
+
+    Source source;
+    source.setupType = setupType;
+    source.inputQueue = inputQueue;
+    source.outputQueue = outputQueue;
+    source.hasFrame = false;
+    m_sources.append(source);
+}
+
+/*!
+ * Starts the barrier. When every camera has a frame, the frames make a set if
+ * their timestamps are close enough. Otherwise the oldest frame is dropped:
+ * the next frames of other cameras are even newer, hence it can't be in any
+ * set.
+ */
+void FrameSetBarrier::process()
+{
+    m_started = true;
+    if (!m_sources.isEmpty()) {
+        m_stopped = false;
+
+        while (!m_stopped) {
+            if (!fillFrames())
+                continue;
+
+            auto byTimestamp = [](const Source& left, const Source& right)
+            { return left.frame.timestamp() < right.frame.timestamp(); };
+            auto oldest = std::min_element(m_sources.begin(), m_sources.end(), byTimestamp);
+            auto newest = std::max_element(m_sources.begin(), m_sources.end(), byTimestamp);
+            std::chrono::microseconds skew = newest->frame.timestamp() - oldest->frame.timestamp();
+
+            if (skew <= m_maxSkew) {
+                sendFrameSet(skew);
+            } else {
+                oldest->frame = TimestampedFrame();
+                oldest->hasFrame = false;
+                ++m_unmatchedFrames;
+                MetricsRegistry::get().setValue("frameSets/unmatchedFrames", m_unmatchedFrames);
+            }
+        }
+    } else {
+        qDebug() << "No sources are set, finishing.";
+    }
+
+    emit finished();
+}
+
+/*!
+ * Stops the barrier.
+ */
+void FrameSetBarrier::stop()
+{
+    m_stopped = true;
+}
+
+/*!
+ * Reads the frames for the sources that have none, returns true when all the
+ * sources have a frame. Returns on the first dequeue time out to check if the
+ * barrier is stopped.
+ */
+bool FrameSetBarrier::fillFrames()
+{
+    for (Source& source : m_sources) {
+        if (!source.hasFrame) {
+            source.hasFrame = source.inputQueue->dequeue(source.frame);
+            if (!source.hasFrame)
+                return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * Sends out the frames as a set. The frames keep their own capture timestamps,
+ * the tracking results obtained on them are matched by the data manager as
+ * their skew is below its matching tolerance.
+ */
+void FrameSetBarrier::sendFrameSet(std::chrono::microseconds skew)
+{
+    for (Source& source : m_sources) {
+        // the queues with the blocking policy make the barrier wait for their
+        // consumer: every attempt sleeps until a place is free or the queue's
+        // time out expires, then the stop flag is checked
+        bool enqueued = false;
+        while (!enqueued && !m_stopped)
+            enqueued = source.outputQueue->tryEnqueue(source.frame);
+        source.frame = TimestampedFrame();
+        source.hasFrame = false;
+    }
+
+    ++m_frameSets;
+    MetricsRegistry::get().setValue("frameSets/sent", m_frameSets);
+    MetricsRegistry::get().setValue("frameSets/skewMs", skew.count() / 1000.);
+}
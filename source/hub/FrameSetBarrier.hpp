@@ -0,0 +1,82 @@
+#ifndef CATS2_FRAME_SET_BARRIER_HPP
+#define CATS2_FRAME_SET_BARRIER_HPP
+
+#include <CommonPointerTypes.hpp>
+#include <SetupType.hpp>
+#include <TimestampedFrame.hpp>
+
+#include <QtCore/QList>
+#include <QtCore/QObject>
+
+#include <atomic>
+#include <chrono>
+
+/*!
+ * \brief Gets the frames from several cameras and groups them in the frame sets
+ * with the timestamps that differ by no more than the given skew. Only the
+ * complete sets are sent to the output queues, the frames keep their capture
+ * timestamps. Runs in a separated thread.
+ */
+class FrameSetBarrier : public QObject
+{
+    Q_OBJECT
+public:
+    //! Constructor. Gets the maximal timestamp difference in a frame set.
+    explicit FrameSetBarrier(std::chrono::microseconds maxSkew);
+    //! Destructor.
+    virtual ~FrameSetBarrier();
+
+    //! Adds a camera to synchronize, must be called before the barrier is
+    //! started. The synchronized frames are placed to the output queue.
+    void addSource(SetupType::Enum setupType,
+                   TimestampedFrameQueuePtr inputQueue,
+                   TimestampedFrameQueuePtr outputQueue);
+
+signals:
+    //! Notifies that the barrier is stopped.
+    void finished();
+
+public slots:
+    //! Starts the barrier.
+    void process();
+    //! Stops the barrier.
+    void stop();
+
+private:
+    //! The camera's queues and its frame waiting for a set.
+    struct Source
+    {
+        //! The camera.
+        SetupType::Enum setupType;
+        //! The queue from the camera's grabber.
+        TimestampedFrameQueuePtr inputQueue;
+        //! The queue to put the synchronized frames.
+        TimestampedFrameQueuePtr outputQueue;
+        //! The frame waiting for a set.
+        TimestampedFrame frame;
+        //! Defines if the frame is set.
+        bool hasFrame;
+    };
+
+    //! Reads the frames for the sources that have none, returns true when all
+    //! the sources have a frame.
+    bool fillFrames();
+    //! Sends out the frames as a set.
+    void sendFrameSet(std::chrono::microseconds skew);
+
+private:
+    //! The synchronized cameras.
+    QList<Source> m_sources;
+    //! The maximal timestamp difference in a frame set.
+    std::chrono::microseconds m_maxSkew;
+    //! The number of sent frame sets.
+    unsigned long long m_frameSets;
+    //! The number of the frames dropped as they don't match any set.
+    unsigned long long m_unmatchedFrames;
+    //! The flag that defines if the barrier is running.
+    std::atomic_bool m_started;
+    //! The flag that defines if the barrier is to be stopped.
+    std::atomic_bool m_stopped;
+};
+
+#endif // CATS2_FRAME_SET_BARRIER_HPP
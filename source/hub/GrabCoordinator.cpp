@@ -0,0 +1,61 @@
+#include "GrabCoordinator.hpp"
+
+#include "FrameSetBarrier.hpp"
+
+#include <MetricsRegistry.hpp>
+
+#include <QtCore/QThread>
+
+/*!
+ * Constructor.
+ */
+GrabCoordinator::GrabCoordinator(std::chrono::microseconds maxSkew) :
+    m_barrier(new FrameSetBarrier(maxSkew),
+              &FrameSetBarrier::deleteLater), // delete later is used for security as multithreaded
+                                              // signals and slots might result is crashes when a
+                                              // a sender is deleted before a signal is received for instance
+    m_started(false)
+{
+}
+
+/*!
+ * Destructor.
+ */
+GrabCoordinator::~GrabCoordinator()
+{
+    qDebug() << "Destroying the object";
+    m_barrier->stop();
+}
+
+/*!
+ * Adds a camera to synchronize and returns the queue with its synchronized
+ * frames.
+ */
+TimestampedFrameQueuePtr GrabCoordinator::addSource(SetupType::Enum setupType, TimestampedFrameQueuePtr inputQueue)
+{
+    TimestampedFrameQueuePtr outputQueue(new TimestampedFrameQueue(inputQueue->policy()));
+    m_barrier->addSource(setupType, inputQueue, outputQueue);
+    MetricsRegistry::get().registerQueue(QString("%1/synchronized")
+                                         .arg(SetupType::toSettingsString(setupType)),
+                                         outputQueue);
+    return outputQueue;
+}
+
+/*!
+ * Starts the synchronization in a separated thread.
+ */
+void GrabCoordinator::start()
+{
+    if (m_started)
+        return;
+    m_started = true;
+
+    QThread* thread = new QThread;
+    m_barrier->moveToThread(thread);
+
+    QObject::connect(thread, &QThread::started, m_barrier.data(), &FrameSetBarrier::process);
+    QObject::connect(m_barrier.data(), &FrameSetBarrier::finished, thread, &QThread::quit);
+    QObject::connect(thread, &QThread::finished, thread, &QThread::deleteLater);
+
+    thread->start();
+}
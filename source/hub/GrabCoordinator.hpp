@@ -0,0 +1,41 @@
+#ifndef CATS2_GRAB_COORDINATOR_HPP
+#define CATS2_GRAB_COORDINATOR_HPP
+
+#include "HubPointerTypes.hpp"
+
+#include <CommonPointerTypes.hpp>
+#include <SetupType.hpp>
+#include <TimestampedFrame.hpp>
+
+#include <chrono>
+
+/*!
+ * \brief The class that synchronizes the frames of several cameras. Every
+ * camera's grabber queue is replaced by an output queue that gets only the
+ * frames belonging to the complete, timestamp-aligned, frame sets.
+ */
+class GrabCoordinator
+{
+public:
+    //! Constructor. Gets the maximal timestamp difference in a frame set.
+    explicit GrabCoordinator(std::chrono::microseconds maxSkew);
+    //! Destructor.
+    virtual ~GrabCoordinator() final;
+
+public:
+    //! Adds a camera to synchronize and returns the queue with its synchronized
+    //! frames. The policy of the output queue is the same as of the input one.
+    //! All the cameras must be added before the coordinator is started.
+    TimestampedFrameQueuePtr addSource(SetupType::Enum setupType, TimestampedFrameQueuePtr inputQueue);
+    //! Starts the synchronization.
+    void start();
+
+private:
+    //! The barrier that groups the frames in the sets.
+    //! Doesn't have a Qt owner as it is managed by another thread.
+    FrameSetBarrierPtr m_barrier;
+    //! Defines if the synchronization is started.
+    bool m_started;
+};
+
+#endif // CATS2_GRAB_COORDINATOR_HPP
@@ -15,5 +15,17 @@ using MultiplicatorPtr = QSharedPointer<Multiplicator>;
 class QueueHub;
 using QueueHubPtr = QSharedPointer<QueueHub>;
 
+/*!
+ * The alias for the shared pointer to the frame set barrier.
+ */
+class FrameSetBarrier;
+using FrameSetBarrierPtr = QSharedPointer<FrameSetBarrier>;
+
+/*!
+ * The alias for the shared pointer to the grab coordinator.
+ */
+class GrabCoordinator;
+using GrabCoordinatorPtr = QSharedPointer<GrabCoordinator>;
+
 #endif // CATS2_HUB_POINTER_TYPES_HPP
 
@@ -23,14 +23,10 @@ Multiplicator::~Multiplicator()
 }
 
 /*!
- * Starts the dispatcher. It reads the frames from the input queue, and duplicates the frames to several output queues.
- * TODO : consider if it is possible to not duplicate the data by copying only the pointers. The risk is that several threads
- * might try to modify the same image thus corrupting it, and thus some kind of a protection mechanism is needed. One option would be
- * to modify the TimestampedFrame::image() getter to return a copy of the image instead of the pointer, but it means that we would still
- * need to copy the data. Other option is to return a const reference to the image, but this could end with the dangling reference when the
- * TimestampedFrame's object is deleted. And, by the way, OpenCV gives no possibility to describe a const reference to an image, since cv::Mat
- * is a shared pointer.
- * http://stackoverflow.com/questions/13713625/is-cvmat-class-flawed-by-design
+ * Starts the dispatcher. It reads the frames from the input queue, and
+ * distributes them to several output queues. The frames' images are immutable
+ * and shared, hence all the output queues get the same image buffer and no
+ * image data is copied here.
  */
 void Multiplicator::process()
 {
@@ -40,15 +36,17 @@ void Multiplicator::process()
         while (!m_stopped) {
             TimestampedFrame frame;
             if (m_inputQueue->dequeue(frame)) {
+                // take a snapshot of the output queues to not block the
+                // addOutputQueue() calls while enqueueing
                 m_outputQueuesMutex.lock();
-                // all output queues but the very first
-                for (size_t i = m_outputQueues.size() - 1; i > 0; --i) {
-                    TimestampedFrame newFrame(frame);
-                    m_outputQueues[i]->enqueue(newFrame);
-                }
-                // and the very first queue gets the original image
-                m_outputQueues[0]->enqueue(frame);
+                QList<TimestampedFrameQueuePtr> outputQueues = m_outputQueues;
                 m_outputQueuesMutex.unlock();
+
+                // the queues with the blocking policy make the dispatcher
+                // wait for their consumer
+                for (TimestampedFrameQueuePtr& outputQueue : outputQueues) {
+                    while (!outputQueue->tryEnqueue(frame) && !m_stopped) { }
+                }
             }
         }
     } else {
@@ -37,11 +37,12 @@ QueueHub::~QueueHub()
 
 /*!
  * Creates new queue, add it to the dispatcher output list and returns the pointer.
+ * The policy defines which frames are dropped when the consumer doesn't keep up.
  */
-TimestampedFrameQueuePtr QueueHub::addOutputQueue()
+TimestampedFrameQueuePtr QueueHub::addOutputQueue(QueuePolicy policy)
 {
     // create new queue
-    TimestampedFrameQueuePtr queue(new TimestampedFrameQueue(100));
+    TimestampedFrameQueuePtr queue(new TimestampedFrameQueue(policy));
     // add to the dispatcher's list
     m_multiplicator->addOutputQueue(queue);
     // return a pointer
@@ -4,6 +4,7 @@
 #include "HubPointerTypes.hpp"
 
 #include <CommonPointerTypes.hpp>
+#include <TimestampedFrame.hpp>
 
 /*!
  * \brief The class that provides one input queue and several output queues. The data from the input queue
@@ -19,7 +20,8 @@ public:
 
 public:
     //! Creates new queue, add it to the dispatcher output list and returns the pointer.
-    TimestampedFrameQueuePtr addOutputQueue();
+    //! The policy defines which frames are dropped when the consumer doesn't keep up.
+    TimestampedFrameQueuePtr addOutputQueue(QueuePolicy policy = QueuePolicy::dropOldest(100));
 
 private:
     //! The tracking routine that tracks agents on the scene.
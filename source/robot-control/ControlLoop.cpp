@@ -6,6 +6,8 @@
 #include "statistics/StatisticsPublisher.hpp"
 
 #include <settings/CommandLineParameters.hpp>
+#include <MetricsRegistry.hpp>
+#include <TimestampClock.hpp>
 
 /*!
  * Constructor.
@@ -15,7 +17,9 @@ ControlLoop::ControlLoop() :
     m_sharedRobotInterface(nullptr),
     m_selectedRobot(),
     m_sendNavigationData(false),
-    m_sendControlAreas(false)
+    m_sendControlAreas(false),
+    m_trackingResultsTimestamp(0),
+    m_newTrackingResults(false)
 {
     // create the robots
     for (QString id : RobotControlSettings::get().ids()) {
@@ -128,13 +132,20 @@ ControlLoop::~ControlLoop()
 }
 
 /*!
- * The main step of the control system.
+ * The main step of the control system. The first step after new tracking
+ * results gives the latency from the frame capture to the robots' commands.
  */
 void ControlLoop::step()
 {
     for (auto& robot : m_robots) {
         robot->stepControl();
     }
+
+    if (m_newTrackingResults) {
+        m_newTrackingResults = false;
+        std::chrono::duration<double, std::milli> latency = TimestampClock::now() - m_trackingResultsTimestamp;
+        MetricsRegistry::get().setValue("robotControl/frameToCommandLatencyMs", latency.count());
+    }
 }
 
 /*!
@@ -239,6 +250,9 @@ void ControlLoop::onTrackingResultsReceived(QList<AgentDataWorld> agentsData,
             robot->setFishStates(fishStates);
     }
 
+    m_trackingResultsTimestamp = timestamp;
+    m_newTrackingResults = true;
+
     // update statistics if necessary
     if (CommandLineParameters::get().publishRobotsStatistics()) {
         updateStatistics(agentsData, timestamp);
@@ -122,6 +122,12 @@ private:
     bool m_sendNavigationData;
     //! The flag that defines if the control areas for the current robot are to be submitted.
     bool m_sendControlAreas;
+
+    //! The timestamp of the last received tracking results, used to measure
+    //! the latency from the frame capture to the robots' commands.
+    std::chrono::milliseconds m_trackingResultsTimestamp;
+    //! Set when the tracking results were received after the last control step.
+    bool m_newTrackingResults;
 };
 
 #endif // CATS2_CONTROL_LOOP_HPP
@@ -2,6 +2,8 @@
 
 #include <settings/RobotControlSettings.hpp>
 
+#include <MetricsRegistry.hpp>
+
 #include <zmqHelpers.hpp>
 
 #include <QtCore/QDebug>
@@ -97,11 +99,12 @@ void StatisticsPublisher::updateStatistics(QString id, double value)
  */
 void StatisticsPublisher::publishStatistics()
 {
+    QMap<QString, double> statistics = allStatistics();
     QString message;
     for (auto& id : m_statisticsToPost) {
         message.append(id);
         message.append(":");
-        message.append(QString::number(m_statistics[id], 'f', 3));
+        message.append(QString::number(statistics.value(id), 'f', 3));
         message.append(";");
     }
     // remove last ";"
@@ -142,7 +145,7 @@ void StatisticsPublisher::sendMessage(std::string& name, std::string& device,
  */
 void StatisticsPublisher::onGetStatisticsReceived()
 {
-    std::string data = m_statistics.keys().join(";").toStdString();
+    std::string data = allStatistics().keys().join(";").toStdString();
     std::string name = "optimiser";
     std::string device = "";
     std::string command = "statistics";
@@ -156,9 +159,22 @@ void StatisticsPublisher::onGetStatisticsReceived()
  */
 void StatisticsPublisher::onPostStatisticsReceived(QStringList statisticsIdsList)
 {
+    QMap<QString, double> statistics = allStatistics();
     m_statisticsToPost.clear();
     for (auto& id : statisticsIdsList) {
-        if (m_statistics.contains(id))
+        if (statistics.contains(id))
             m_statisticsToPost.append(id);
     }
 }
+
+/*!
+ * Returns the registered statistics together with the runtime metrics of the
+ * application.
+ */
+QMap<QString, double> StatisticsPublisher::allStatistics() const
+{
+    QMap<QString, double> statistics = MetricsRegistry::get().values();
+    for (auto it = m_statistics.begin(); it != m_statistics.end(); ++it)
+        statistics[it.key()] = it.value();
+    return statistics;
+}
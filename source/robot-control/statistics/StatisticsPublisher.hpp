@@ -52,6 +52,9 @@ private slots:
     void publishStatistics();
 
 private:
+    //! Returns the registered statistics together with the runtime metrics of
+    //! the application.
+    QMap<QString, double> allStatistics() const;
     //! Sends a message.
     void sendMessage(std::string& name, std::string& device,
                      std::string& desc, std::string& data);
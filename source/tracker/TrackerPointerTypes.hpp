@@ -22,6 +22,12 @@ using TrackingRoutinePtr = QSharedPointer<TrackingRoutine>;
 class TrackingRoutineSettings;
 using TrackingRoutineSettingsPtr = QSharedPointer<TrackingRoutineSettings>;
 
+/*!
+ * The alias for the shared pointer to the background model.
+ */
+class BackgroundModel;
+using BackgroundModelPtr = QSharedPointer<BackgroundModel>;
+
 /*!
  * The alias for the shared pointer to the tracking data.
  */
@@ -40,6 +46,13 @@ using TrackingSetupPtr = QSharedPointer<TrackingSetup>;
 class TrackingDataManager;
 using TrackingDataManagerPtr = QSharedPointer<TrackingDataManager>;
 
+/*!
+ * The alias for the shared pointer to the queue of the tracking results.
+ */
+template <typename Data> class TrackingResultsQueue;
+struct TimestampedWorldAgentsData;
+using TrackingResultsQueuePtr = QSharedPointer<TrackingResultsQueue<TimestampedWorldAgentsData>>;
+
 /*!
  * The alias for the shared pointer to the trajectory writer.
  */
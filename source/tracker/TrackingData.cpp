@@ -18,6 +18,7 @@ TrackingData::TrackingData(SetupType::Enum setupType,
                            TimestampedFrameQueuePtr debugQueue) :
     QObject(nullptr),
     m_setupType(setupType),
+    m_trackingThread(nullptr),
     m_coordinatesConversion(coordinatesConversion)
 {
     qRegisterMetaType<TimestampedImageAgentsData>("TimestampedImageAgentsData");
@@ -28,16 +29,22 @@ TrackingData::TrackingData(SetupType::Enum setupType,
     if (!m_trackingRoutine.isNull()) {
 
         // launch the tracking routine in a separated thread
-        QThread* thread = new QThread;
-        m_trackingRoutine->moveToThread(thread);
+        m_trackingThread = new QThread;
+        m_trackingRoutine->moveToThread(m_trackingThread);
 
-        connect(thread, &QThread::started, m_trackingRoutine.data(), &TrackingRoutine::process);
-        connect(m_trackingRoutine.data(), &TrackingRoutine::finished, thread, &QThread::quit);
-        connect(thread, &QThread::finished, thread, &QThread::deleteLater);
-        connect(m_trackingRoutine.data(), &TrackingRoutine::trackedAgents, this, &TrackingData::onTrackedAgents);
+        connect(m_trackingThread, &QThread::started, m_trackingRoutine.data(), &TrackingRoutine::process);
+        // NOTE : direct connection is to let the thread finish while the destructor waits for it
+        connect(m_trackingRoutine.data(), &TrackingRoutine::finished, m_trackingThread, &QThread::quit, Qt::DirectConnection);
+        connect(m_trackingThread, &QThread::finished, m_trackingThread, &QThread::deleteLater);
+        // NOTE : direct connection is to convert the results in the tracking (or publishing) thread, the coordinates
+        // conversion is thread-safe and the destructor waits for the thread to finish
+        connect(m_trackingRoutine.data(), &TrackingRoutine::trackedAgents,
+                this, &TrackingData::onTrackedAgents, Qt::DirectConnection);
+        connect(m_trackingRoutine.data(), &TrackingRoutine::streamProcessed,
+                this, &TrackingData::streamProcessed, Qt::DirectConnection);
         connect(this, &TrackingData::sendDebugImages,
                 m_trackingRoutine.data(), &TrackingRoutine::onSendDebugImages, Qt::DirectConnection);  // NOTE : direct connection is to ensure that the slot is called, but we need to ensure that it is thread safe
-        thread->start();
+        m_trackingThread->start();
     }
 }
 
@@ -47,30 +54,50 @@ TrackingData::TrackingData(SetupType::Enum setupType,
 TrackingData::~TrackingData()
 {
     qDebug() << "Destroying the object";
-    if (!m_trackingRoutine.isNull())
+    if (!m_trackingRoutine.isNull()) {
         m_trackingRoutine->stop();
+        // the tracking thread uses this object to send the results, it's
+        // already deleted if the tracking is finished with the stream
+        if (!m_trackingThread.isNull())
+            m_trackingThread->wait();
+    }
+}
+
+/*!
+ * Stops the tracking once the frames waiting in the input queue are tracked.
+ */
+void TrackingData::finish()
+{
+    if (!m_trackingRoutine.isNull())
+        m_trackingRoutine->finish();
 }
 
 /*!
  * Gets the agents from the tracking routine, converts their position in the  world coordinates
- * and sends them further.
+ * and sends them further. Called in the thread that sends the tracking results.
  */
 void TrackingData::onTrackedAgents(TimestampedImageAgentsData timestampedImageAgents)
 {
     if (!m_coordinatesConversion.isNull() && m_coordinatesConversion->isValid()) {
-        TimestampedWorldAgentsData timestampedWorldAgents;
+        // only agents with valid positions are sent further
+        QList<AgentDataImage> imageAgents;
+        QList<StateImage> imageStates;
         foreach (AgentDataImage imageAgent, timestampedImageAgents.agentsData) {
-            // only agents with valid positions are sent further
             if (imageAgent.state().position().isValid()) {
-                PositionMeters worldPosition = m_coordinatesConversion->imageToWorldPosition(imageAgent.state().position());
-                OrientationRad worldOrientation = m_coordinatesConversion->imageToWorldOrientation(imageAgent.state().position(),
-                                                                                                     imageAgent.state().orientation());
-                AgentDataWorld worldAgent(imageAgent.id(),
-                                          imageAgent.type(),
-                                          StateWorld(worldPosition, worldOrientation));
-                timestampedWorldAgents.agentsData.append(worldAgent);
+                imageAgents.append(imageAgent);
+                imageStates.append(imageAgent.state());
             }
         }
+
+        // all the agents are converted at once
+        QList<StateWorld> worldStates = m_coordinatesConversion->imageToWorldStates(imageStates);
+        TimestampedWorldAgentsData timestampedWorldAgents;
+        for (int index = 0; index < imageAgents.size(); index++) {
+            AgentDataWorld worldAgent(imageAgents[index].id(),
+                                      imageAgents[index].type(),
+                                      worldStates[index]);
+            timestampedWorldAgents.agentsData.append(worldAgent);
+        }
 //        if (!timestampedAgentsData.agentsData.isEmpty()) {
             // NOTE : we send the data even if the tracking doesn't find any
             // agents and thus we don't block the tracking result's matching and
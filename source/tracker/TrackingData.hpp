@@ -10,9 +10,11 @@
 #include <SetupType.hpp>
 
 #include <QtCore/QObject>
+#include <QtCore/QPointer>
 
 class AgentDataWorld;
 class AgentDataImage;
+class QThread;
 
 /*!
  * \brief The data class that launches the tracking routine.
@@ -51,15 +53,26 @@ public:
     //! Reports on what type of agent can be tracked by this routine.
     QList<AgentType> routineCapabilities() const { return m_trackingRoutine->capabilities(); }
 
+public slots:
+    //! Stops the tracking once the frames waiting in the input queue are
+    //! tracked, called at the end of the stream.
+    void finish();
+
 signals:
     //! Sends out the tracked agents in world coordinates. Also the setup type is send to "sign" the signal.
+    //! Emitted in the tracking thread, or in its publishing thread when the
+    //! tracking is pipelined.
     void trackedAgents(SetupType::Enum setupType, TimestampedWorldAgentsData worldAgents);
+    //! Notifies that the stream is over and all its frames are tracked.
+    //! Emitted in the tracking thread after the last results are sent.
+    void streamProcessed();
     //! Request to start/stop enqueueing the debug images to the debug queue.
     void sendDebugImages(bool send);
 
 private slots:
     //! Gets the agents from the tracking routine, converts their position in the
-    //! world coordinates and sends them further.
+    //! world coordinates and sends them further. Called in the thread that
+    //! sends the tracking results.
     void onTrackedAgents(TimestampedImageAgentsData agents);
 
 private:
@@ -70,6 +83,9 @@ private:
     //! The tracking routine that tracks agents on the scene.
     //! Doesn't have a Qt owner as it is managed by another thread.
     TrackingRoutinePtr m_trackingRoutine;
+    //! The thread of the tracking routine, it deletes itself when finished,
+    //! for instance at the end of the stream.
+    QPointer<QThread> m_trackingThread;
 
     //! The coordinates conversion to get world state of the agents.
     CoordinatesConversionPtr m_coordinatesConversion;
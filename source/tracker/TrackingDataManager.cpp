@@ -3,8 +3,12 @@
 #include "settings/TrackingSettings.hpp"
 
 #include <CoordinatesConversion.hpp>
+#include <AssignmentSolver.hpp>
+#include <MetricsRegistry.hpp>
+#include <TimestampClock.hpp>
 
 #include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
 
 constexpr std::chrono::duration<double> TrackingDataManager::MaxTimeDifferenceMs;
 constexpr float TrackingDataManager::IdentityDistanceThresholdMeters;
@@ -12,9 +16,12 @@ constexpr float TrackingDataManager::OrientationThresholdRad;
 constexpr float TrackingDataManager::OrientationWeightCoefficient;
 constexpr float TrackingDataManager::WeightedThreshold;
 constexpr float TrackingDataManager::InvalidOrientationPenaltyRad;
+constexpr size_t TrackingDataManager::InputQueueSize;
+constexpr size_t TrackingDataManager::MergedQueueSize;
+constexpr std::chrono::milliseconds TrackingDataManager::FusionTimeOutMs;
 
 /*!
- * Constructor.
+ * Constructor. Starts the fusion thread.
  */
 TrackingDataManager::TrackingDataManager(QString dataLoggingPath, bool logResults) :
     QObject(nullptr),
@@ -22,11 +29,16 @@ TrackingDataManager::TrackingDataManager(QString dataLoggingPath, bool logResult
     m_primaryDataSourceCapability(AgentType::UNDEFINED),
     m_typeForGenericAgents(AgentType::FISH), // TODO : find a better way to do this(?)
     m_logResults(logResults),
-    m_dataLoggingPath(dataLoggingPath)
+    m_dataLoggingPath(dataLoggingPath),
+    m_blockingResults(false),
+    m_mergedData(MergedQueueSize),
+    m_mergedDataNotified(false),
+    m_stopped(false)
 {
     if (m_logResults) {
         m_trajectoryWriter.reset(new TrajectoryWriter(dataLoggingPath));
     }
+    m_fusionThread = std::thread(&TrackingDataManager::runFusion, this);
 #if 0
     // this code is used purely for a debug when in a no-setup mode
     // it starts the timer that sends a data with the fake robots and fish
@@ -56,22 +68,82 @@ TrackingDataManager::TrackingDataManager(QString dataLoggingPath, bool logResult
 }
 
 /*!
- * Destructor.
+ * Destructor. Stops the fusion thread.
  */
 TrackingDataManager::~TrackingDataManager()
 {
+    stop();
+}
 
+/*!
+ * Stops the fusion thread once the results waiting in the input queues are
+ * merged, and closes the trajectory file with the results that the writer
+ * still keeps. Can be called several times.
+ */
+void TrackingDataManager::stop()
+{
+    m_stopped = true;
+    if (m_fusionThread.joinable())
+        m_fusionThread.join();
+
+    // the sources that still send their results don't wait anymore
+    {
+        QMutexLocker locker(&m_sourcesMutex);
+        foreach (TrackingResultsQueuePtr inputQueue, m_inputQueues)
+            inputQueue->close();
+    }
+
+    QMutexLocker locker(&m_loggingMutex);
+    if (m_trajectoryWriter)
+        m_trajectoryWriter->stop();
+    m_trajectoryWriter.reset();
+}
+
+/*!
+ * Called when the source's stream is over and all its frames are tracked.
+ * When all the sources are processed the tracking is finished.
+ */
+void TrackingDataManager::onStreamProcessed(SetupType::Enum setupType)
+{
+    {
+        QMutexLocker locker(&m_sourcesMutex);
+        if (!m_processedSources.contains(setupType))
+            m_processedSources.append(setupType);
+        foreach (SetupType::Enum dataSource, m_inputQueues.keys()) {
+            if (!m_processedSources.contains(dataSource))
+                return;
+        }
+    }
+
+    qDebug() << "All the streams are processed, stopping the tracking";
+    stop();
+    // send out the last results
+    onMergedDataReady();
+    emit trackingFinished();
 }
 
 /*!
  * Adds new data source to the list. Also defines what kind of objects this
- * source is able to track.
+ * source is able to track. Returns the source's input queue.
  */
-void TrackingDataManager::addDataSource(SetupType::Enum setupType,
-                                        QList<AgentType> capabilities)
+TrackingResultsQueuePtr TrackingDataManager::addDataSource(SetupType::Enum setupType,
+                                                           QList<AgentType> capabilities,
+                                                           bool blockingResults)
 {
+    // the results of the blocking source are not dropped by the writer either
+    if (blockingResults) {
+        QMutexLocker locker(&m_loggingMutex);
+        m_blockingResults = true;
+        if (m_trajectoryWriter)
+            m_trajectoryWriter->setBlocking(true);
+    }
+
+    QMutexLocker locker(&m_sourcesMutex);
+
     // add new data source
-    m_trackingData[setupType] = QQueue<TimestampedWorldAgentsData>();
+    TrackingResultsQueuePtr inputQueue(new TrackingResultsQueue<TimestampedWorldAgentsData>(InputQueueSize));
+    inputQueue->setBlocking(blockingResults);
+    m_inputQueues[setupType] = inputQueue;
 
     // update the primary data source if necessary (smaller value means more data)
     foreach (AgentType capability, capabilities) {
@@ -80,6 +152,7 @@ void TrackingDataManager::addDataSource(SetupType::Enum setupType,
             m_primaryDataSource = setupType;
         }
     }
+    return inputQueue;
 }
 
 /*!
@@ -87,6 +160,7 @@ void TrackingDataManager::addDataSource(SetupType::Enum setupType,
  */
 void TrackingDataManager::addCoordinatesConversion(SetupType::Enum setupType, CoordinatesConversionPtr coordinatesConversion)
 {
+    QMutexLocker locker(&m_sourcesMutex);
     m_coordinatesConversions.insert(setupType, coordinatesConversion);
 }
 
@@ -95,10 +169,12 @@ void TrackingDataManager::addCoordinatesConversion(SetupType::Enum setupType, Co
  */
 void TrackingDataManager::setLogResults(bool value)
 {
+    QMutexLocker locker(&m_loggingMutex);
     if (m_logResults != value) {
         m_logResults = value;
         if (m_logResults) {
             m_trajectoryWriter.reset(new TrajectoryWriter(m_dataLoggingPath));
+            m_trajectoryWriter->setBlocking(m_blockingResults);
         } else {
             m_trajectoryWriter.reset();
         }
@@ -106,74 +182,156 @@ void TrackingDataManager::setLogResults(bool value)
 }
 
 /*!
- * New tracking results arrive. The data from the "secondary" data source (in our
+ * The fusion thread's loop. The data from the "secondary" data source (in our
  * case - the top camera) are placed in a queue, in the same time the data from
- * the "primary" data source (bottom camera) are treated right away. If in the queue
- * there are recent data from the secondary source then we try to merge them together
- * otherwise the primary source data is sent as it is.
+ * the "primary" data source (bottom camera) are treated right away. The
+ * secondary sources' data are collected after the primary data arrive, hence
+ * those that came just before are taken into account.
  */
-void TrackingDataManager::onNewData(SetupType::Enum setupType,
-                                    TimestampedWorldAgentsData timestampedAgentsData)
+void TrackingDataManager::runFusion()
 {
-    // if the new data comes from a secondary data source then it is stored in the input queue
-    if (setupType != m_primaryDataSource) {
-        if (m_trackingData.contains(setupType)) {
-            m_trackingData[setupType].enqueue(timestampedAgentsData);
-        } else {
-            qDebug() << "Unknown data source: " << SetupType::toString(setupType);
-        }
-    } else {
-        // if the data comes from the primary source then it needs to be treated right away
-        QList<AgentDataWorld> agentDataList = timestampedAgentsData.agentsData;
-        // get the new data's timestamp
-        std::chrono::milliseconds timestamp = timestampedAgentsData.timestamp;
-        // the flag that defines if all data sources could be merged together
-        bool allDataMerged = true;
-        // look throught data from other sources to make a merge
-        foreach (SetupType::Enum dataSource, m_trackingData.keys()) {
-            if (dataSource != m_primaryDataSource) {
-                // we look for the data with the closest timestamp.
-                TimestampedWorldAgentsData closestAgentData;
-                if (getDataByTimestamp(timestamp, m_trackingData[dataSource], closestAgentData)) {
-                    // if the data list is found than we take the agent from this list that are not
-                    // yet in the final list
-                    QList<AgentDataWorld> mergedAgentDataList;
-                    matchAgents(agentDataList, closestAgentData.agentsData, mergedAgentDataList);
-                    // update the agent data list with the newly merged data
-                    agentDataList = mergedAgentDataList;
-                } else {
-                    allDataMerged = false;
-                }
-            }
-        }
+    while (!m_stopped)
+        fuseData(FusionTimeOutMs);
+    // the results waiting in the queues are merged before stopping
+    while (fuseData(std::chrono::milliseconds(0))) { }
+}
+
+/*!
+ * Waits for the primary source's data during the time out and merges them
+ * with the secondary sources' data. Returns false if no primary data came.
+ */
+bool TrackingDataManager::fuseData(std::chrono::milliseconds timeOut)
+{
+    // the sources are copied to be used without the lock, the copy is cheap
+    // as the containers are implicitly shared
+    QMap<SetupType::Enum, TrackingResultsQueuePtr> inputQueues;
+    SetupType::Enum primaryDataSource;
+    {
+        QMutexLocker locker(&m_sourcesMutex);
+        inputQueues = m_inputQueues;
+        primaryDataSource = m_primaryDataSource;
+    }
 
-        // set the type of all the agent of the undefined type to the specified type
-        for (auto& agentData : agentDataList) {
-            if (agentData.type() == AgentType::GENERIC)
-                agentData.setType(m_typeForGenericAgents);
+    TimestampedWorldAgentsData primaryData;
+    bool primaryDataReceived = false;
+    if (inputQueues.contains(primaryDataSource))
+        primaryDataReceived = inputQueues[primaryDataSource]->waitDequeue(primaryData, timeOut);
+    else
+        std::this_thread::sleep_for(timeOut);
+
+    // the data from the secondary data sources are stored in the queues
+    foreach (SetupType::Enum dataSource, inputQueues.keys()) {
+        if (dataSource != primaryDataSource) {
+            TimestampedWorldAgentsData secondaryData;
+            while (inputQueues[dataSource]->dequeue(secondaryData))
+                m_trackingData[dataSource].enqueue(secondaryData);
         }
+        MetricsRegistry::get().setValue(QString("%1/fusionDroppedResults").arg(SetupType::toSettingsString(dataSource)),
+                                        inputQueues[dataSource]->droppedResults());
+    }
 
-        // send the results
-        emit notifyAgentDataWorldMerged(agentDataList, timestamp);
+    if (primaryDataReceived)
+        mergeData(primaryData);
+    return primaryDataReceived;
+}
 
-        // sends results in main setup image coordinates
-        // NOTE : this is a temporary code to share results with CATS
-        QList<AgentDataImage> agentDataListImage = convertToFrameCoordinates(SetupType::MAIN_CAMERA, agentDataList);
-        emit notifyAgentDataImageMerged(agentDataListImage);
+/*!
+ * Merges the data of the primary source with the data from the secondary
+ * sources. If in the queues there are recent data from the secondary sources
+ * then we try to merge them together otherwise the primary source data is sent
+ * as it is.
+ */
+void TrackingDataManager::mergeData(const TimestampedWorldAgentsData& primaryData)
+{
+    std::chrono::steady_clock::time_point mergingStartTime = std::chrono::steady_clock::now();
+
+    SetupType::Enum primaryDataSource;
+    AgentType typeForGenericAgents;
+    {
+        QMutexLocker locker(&m_sourcesMutex);
+        primaryDataSource = m_primaryDataSource;
+        typeForGenericAgents = m_typeForGenericAgents;
+    }
 
-        // save the results to a file only if all the data could be merged
-        if (allDataMerged ) {
-            if (m_logResults && m_trajectoryWriter) {
-                m_trajectoryWriter->writeData(timestamp, agentDataList);
+    QList<AgentDataWorld> agentDataList = primaryData.agentsData;
+    // get the new data's timestamp
+    std::chrono::microseconds timestamp = primaryData.timestamp;
+    // the flag that defines if all data sources could be merged together
+    bool allDataMerged = true;
+    // look throught data from other sources to make a merge
+    foreach (SetupType::Enum dataSource, m_trackingData.keys()) {
+        if (dataSource != primaryDataSource) {
+            // we look for the data with the closest timestamp.
+            TimestampedWorldAgentsData closestAgentData;
+            if (getDataByTimestamp(timestamp, m_trackingData[dataSource], closestAgentData)) {
+                // if the data list is found than we take the agent from this list that are not
+                // yet in the final list
+                QList<AgentDataWorld> mergedAgentDataList;
+                matchAgents(agentDataList, closestAgentData.agentsData, mergedAgentDataList);
+                // update the agent data list with the newly merged data
+                agentDataList = mergedAgentDataList;
+            } else {
+                allDataMerged = false;
             }
         }
     }
+
+    // set the type of all the agent of the undefined type to the specified type
+    for (auto& agentData : agentDataList) {
+        if (agentData.type() == AgentType::GENERIC)
+            agentData.setType(typeForGenericAgents);
+    }
+
+    // the results are passed to this object's thread to be sent out, they are
+    // also converted to the main setup image coordinates
+    // NOTE : this is a temporary code to share results with CATS
+    MergedAgentsData mergedData;
+    mergedData.worldAgents = agentDataList;
+    mergedData.imageAgents = convertToFrameCoordinates(SetupType::MAIN_CAMERA, agentDataList);
+    mergedData.timestamp = timestamp;
+    if (m_mergedData.enqueue(mergedData) && !m_mergedDataNotified.exchange(true))
+        QMetaObject::invokeMethod(this, "onMergedDataReady", Qt::QueuedConnection);
+
+    // save the results to a file only if all the data could be merged
+    if (allDataMerged) {
+        QMutexLocker locker(&m_loggingMutex);
+        if (m_logResults && m_trajectoryWriter) {
+            m_trajectoryWriter->writeData(timestamp, agentDataList);
+        }
+    }
+
+    std::chrono::duration<double, std::milli> mergingDuration = std::chrono::steady_clock::now() - mergingStartTime;
+    MetricsRegistry::get().setValue("fusion/mergingMs", mergingDuration.count());
+    MetricsRegistry::get().setValue("fusion/droppedMergedResults", m_mergedData.droppedResults());
+}
+
+/*!
+ * Sends out the merged results waiting in the queue.
+ */
+void TrackingDataManager::onMergedDataReady()
+{
+    // reset before emptying the queue, the results that come meanwhile
+    // request to be sent again
+    m_mergedDataNotified = false;
+
+    MergedAgentsData mergedData;
+    while (m_mergedData.dequeue(mergedData)) {
+        // the robot control works with the millisecond timestamps
+        emit notifyAgentDataWorldMerged(mergedData.worldAgents,
+                                        std::chrono::duration_cast<std::chrono::milliseconds>(mergedData.timestamp));
+        emit notifyAgentDataImageMerged(mergedData.imageAgents);
+
+        // the time since the frame capture till the results are received
+        // by the robot control and the viewer
+        std::chrono::duration<double, std::milli> latency = TimestampClock::now() - mergedData.timestamp;
+        MetricsRegistry::get().setValue("fusion/latencyMs", latency.count());
+    }
 }
 
 /*!
  * Find the best match to the provided timestamp in the given queue.
  */
-bool TrackingDataManager::getDataByTimestamp(std::chrono::milliseconds timestamp,
+bool TrackingDataManager::getDataByTimestamp(std::chrono::microseconds timestamp,
                                              QQueue<TimestampedWorldAgentsData>& dataQueue,
                                              TimestampedWorldAgentsData& bestMatchData)
 {
@@ -186,7 +344,7 @@ bool TrackingDataManager::getDataByTimestamp(std::chrono::milliseconds timestamp
     // (this can only happen if by some mistery we get the data from
     // the deep past)
     if (dataQueue.head().timestamp >= timestamp) {
-        if (std::chrono::duration_cast<std::chrono::milliseconds>(dataQueue.head().timestamp - timestamp) < MaxTimeDifferenceMs) { // FIXME : no need in cast timestamp is already the duration value
+        if (dataQueue.head().timestamp - timestamp < MaxTimeDifferenceMs) {
             bestMatchData = dataQueue.dequeue();
             return true;
         } else {
@@ -202,14 +360,14 @@ bool TrackingDataManager::getDataByTimestamp(std::chrono::milliseconds timestamp
     std::chrono::duration<double> minTimeDifferenceMs = MaxTimeDifferenceMs;
     while ((dataQueue.size() > 0) && (!dataFound)) {
         // the data is too old
-        if (std::chrono::duration_cast<std::chrono::milliseconds>(timestamp - dataQueue.head().timestamp) > MaxTimeDifferenceMs) {
+        if (timestamp - dataQueue.head().timestamp > MaxTimeDifferenceMs) {
             dataQueue.dequeue(); // forget old data
         } else { // if we are still in the old data
             if (timestamp > dataQueue.head().timestamp) { // then we cache the last used data (*)
                 bestMatchData = dataQueue.dequeue();
-                minTimeDifferenceMs = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp - bestMatchData.timestamp);
+                minTimeDifferenceMs = timestamp - bestMatchData.timestamp;
             } else { // we happen to pass to the new data now
-                if (std::chrono::duration_cast<std::chrono::milliseconds>(dataQueue.head().timestamp - timestamp) <  minTimeDifferenceMs) {
+                if (dataQueue.head().timestamp - timestamp < minTimeDifferenceMs) {
                     bestMatchData = dataQueue.dequeue();
                 }
                 dataFound = true;
@@ -237,31 +395,26 @@ void TrackingDataManager::matchAgents(QList<AgentDataWorld>& currentAgents, QLis
     // result : list one is never longer than list two
 
     // cost matrices
-    QVector<QVector<float>> costMatrix(listOne.size());
-    float maxCost = initializeCostMatrices(listOne, listTwo, costMatrix);
+    cv::Mat_<double> costMatrix;
+    initializeCostMatrices(listOne, listTwo, costMatrix);
 
 //    // NOTE : uncomment to debug agent matching
 //    qDebug() << "Cost matrix" ;
 //    qDebug() << "Threshold" << WeightedThreshold;
-//    qDebug() << "Max cost" << maxCost;
 //    for (int i = 0; i < listOne.size(); i++)
-//        qDebug() << costMatrix[i];
+//        qDebug() << QVector<double>(costMatrix[i], costMatrix[i] + costMatrix.cols);
 
-    // find best match
-    QVector<bool> usedIndices(listTwo.size(), false);
-    QVector<int> combination(listOne.size(), -1);
-    QVector<int> bestCombination(listOne.size(), -1);
-    float minCost = maxCost + 1; // +1 to make it work for single agent case when minCost is equal to maxCost
-    searchBestMatch(0, listOne.size(), listTwo.size(), usedIndices, combination, bestCombination,  minCost, costMatrix);
+    // find best match, the agents that are too far are never matched
+    std::vector<int> bestCombination = AssignmentSolver::solve(costMatrix);
 
-//    qDebug() << "Best combination" << bestCombination;
+//    qDebug() << "Best combination" << QVector<int>::fromStdVector(bestCombination);
 
     // generate the joined list
     // first add duplicated agents to the output list
     QList<QPair<int, int>> indecesToRemove;
     for (int i1 = 0; i1 < listOne.size(); i1++) {
-        // analyse the winning combination to remove elements that are too far
-        if (costMatrix[i1][bestCombination[i1]] < WeightedThreshold) { // i.e. the elements are close enough
+        // the unmatched elements are too far from all the others
+        if (bestCombination[i1] >= 0) { // i.e. the elements are close enough
             AgentDataWorld& agentOne = listOne[i1];
             AgentDataWorld& agentTwo = listTwo[bestCombination[i1]];
 
@@ -309,11 +462,6 @@ void TrackingDataManager::matchAgents(QList<AgentDataWorld>& currentAgents, QLis
 //                            .arg(joinedAgentsList.last().state().orientation().isValid());
             }
             indecesToRemove.append(qMakePair(i1, bestCombination[i1]));
-        } else {
-//            qDebug() <<  QString("Matched agents at %2 and %3 are too far : %1")
-//                                            .arg(costMatrix[i1][bestCombination[i1]])
-//                    .arg(listOne.at(i1).state().position().toString())
-//                    .arg(listTwo.at(bestCombination[i1]).state().position().toString());
         }
     }
 
@@ -340,19 +488,18 @@ void TrackingDataManager::matchAgents(QList<AgentDataWorld>& currentAgents, QLis
 
 /*!
  * Computes the distances and angles between the agents while analyzing this
- * values to remove the impossible combinations.
+ * values to remove the impossible combinations: the pairs whose cost is above
+ * the weighted threshold are forbidden.
  */
-float TrackingDataManager::initializeCostMatrices(const QList<AgentDataWorld>& listOne,
+void TrackingDataManager::initializeCostMatrices(const QList<AgentDataWorld>& listOne,
                                                  const QList<AgentDataWorld>& listTwo,
-                                                 QVector<QVector<float>>& costMatrix)
+                                                 cv::Mat_<double>& costMatrix)
 {
     // set sizes
-    for (int i = 0; i < listOne.size(); i++)
-        costMatrix[i].fill(0, listTwo.size());
+    costMatrix.create(listOne.size(), listTwo.size());
 
 //    float angle;
     float distance;
-    float maxCost = 0;
     // fill the costs matrices
     for (int i1 = 0; i1 < listOne.size(); i1++){
         for (int i2 = 0; i2 < listTwo.size(); i2++) {
@@ -376,57 +523,11 @@ float TrackingDataManager::initializeCostMatrices(const QList<AgentDataWorld>& l
 //            } else
 //                angle = InvalidOrientationPenaltyRad;
 
-            costMatrix[i1][i2] = distance/* + OrientationWeightCoefficient * angle*/;
-            // increase the max cost value
-            maxCost += costMatrix[i1][i2];
+            float cost = distance/* + OrientationWeightCoefficient * angle*/;
+            // the agents that are too far can't be the same
+            costMatrix(i1, i2) = (cost < WeightedThreshold) ? cost : AssignmentSolver::Forbidden;
         }
     }
-
-    return maxCost;
-}
-
-/*!
- * Generates all the possible ordered combinations k indices (shorter list one)
- * out of n indices (longer list two), taking into account which combinations
- * make sense.
- */
-void TrackingDataManager::searchBestMatch(int depth,  // depth of the recursion = current elemetn in the combination
-                                           int k, int n, // we compute A{^k}{_n}
-                                           QVector<bool>& usedIndices,  // tells which values are already used in the combination
-                                           QVector<int>& combination,  // the combination that is constructed
-                                           QVector<int>& bestCombination,  // the combination that is constructed
-                                           float& minCost,
-                                           const QVector<QVector<float>>& costMatrix)
-{
-    if (depth == k) {
-        float cost = getCombinationCost(combination, costMatrix);
-        if (cost < minCost) {
-            bestCombination = combination;
-            minCost = cost;
-        }
-        return;
-    }
-
-    for (int i = 0; i < n; i++) {
-        if (! usedIndices[i]) {
-            usedIndices[i] = true;
-            combination[depth] = i;
-            searchBestMatch(depth + 1, k, n, usedIndices, combination, bestCombination, minCost, costMatrix);
-            usedIndices[i] = false;
-        }
-    }
-}
-
-/*!
- * Computes the costs of the given combination.
- */
-float TrackingDataManager::getCombinationCost(const QVector<int>& combination,
-                                             const QVector<QVector<float>>& costMatrix)
-{
-    float cost = 0;
-    for (int i1 = 0; i1 < combination.size(); i1++)
-        cost += costMatrix[i1][combination[i1]];
-    return cost;
 }
 
 /*!
@@ -435,19 +536,24 @@ float TrackingDataManager::getCombinationCost(const QVector<int>& combination,
 QList<AgentDataImage> TrackingDataManager::convertToFrameCoordinates(SetupType::Enum setupType,
                                                                      QList<AgentDataWorld> mergedAgentDataList)
 {
+    CoordinatesConversionPtr coordinatesConversion;
+    {
+        QMutexLocker locker(&m_sourcesMutex);
+        coordinatesConversion = m_coordinatesConversions.value(setupType);
+    }
+
     QList<AgentDataImage> agentsDataImageList;
     // if the conversion is available
-    if (m_coordinatesConversions.contains(setupType)) {
-        // convert all agents
-        foreach (AgentDataWorld agentDataWorld, mergedAgentDataList) {
-            PositionPixels imagePosition = m_coordinatesConversions[setupType]->
-                    worldToImagePosition(agentDataWorld.state().position());
-            OrientationRad imageOrientation = m_coordinatesConversions[setupType]->
-                    worldToImageOrientation(agentDataWorld.state().position(),
-                                            agentDataWorld.state().orientation());
-            agentsDataImageList.append(AgentDataImage(agentDataWorld.id(),
-                                                      agentDataWorld.type(),
-                                                      StateImage(imagePosition, imageOrientation)));
+    if (!coordinatesConversion.isNull()) {
+        // convert all agents at once
+        QList<StateWorld> worldStates;
+        foreach (const AgentDataWorld& agentDataWorld, mergedAgentDataList)
+            worldStates.append(agentDataWorld.state());
+        QList<StateImage> imageStates = coordinatesConversion->worldToImageStates(worldStates);
+        for (int index = 0; index < mergedAgentDataList.size(); index++) {
+            agentsDataImageList.append(AgentDataImage(mergedAgentDataList[index].id(),
+                                                      mergedAgentDataList[index].type(),
+                                                      imageStates[index]));
         }
     }
     return agentsDataImageList;
@@ -458,6 +564,7 @@ QList<AgentDataImage> TrackingDataManager::convertToFrameCoordinates(SetupType::
  */
 void TrackingDataManager::setGenericAgentReplacementType(AgentType type)
 {
+    QMutexLocker locker(&m_sourcesMutex);
     m_typeForGenericAgents = type;
 }
 
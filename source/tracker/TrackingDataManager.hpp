@@ -2,22 +2,32 @@
 #define CATS2_TRACKING_DATA_MANAGER_HPP
 
 #include "TrackerPointerTypes.hpp"
+#include "TrackingResultsQueue.hpp"
 
 #include <CommonPointerTypes.hpp>
 
 #include <SetupType.hpp>
 #include <AgentData.hpp>
 
+#include <opencv2/core/core.hpp>
+
 #include <QtCore/QObject>
 #include <QtCore/QQueue>
 #include <QtCore/QtMath>
 #include <QtCore/QTimer>
+#include <QtCore/QMutex>
 
+#include <atomic>
 #include <chrono>
+#include <thread>
 
 /*!
  * \brief The class that receives the tracking data from different trackers, analyses it to find the
  * common data, merges together, sends out to the viewer and writes to the disk.
+ * The data are merged and written in a dedicated fusion thread, the trackers hand
+ * their results over through the lock-free input queues and the merged results
+ * come back to the thread of this object through a bounded queue, the signals
+ * are emitted from this object's thread.
  * NOTE : this class shold be managed with the smart pointers instead of the Qt's parenting mechanism.
  */
 class TrackingDataManager : public QObject
@@ -30,8 +40,12 @@ public:
     virtual ~TrackingDataManager() final;
 
     //! Adds new data source to the list. Also defines what kind of objects this source
-    //! is able to track.
-    void addDataSource(SetupType::Enum setupType, QList<AgentType> capabilities);
+    //! is able to track. Returns the queue to which the source puts its tracking
+    //! results, the source must be its only producer. When the results are
+    //! blocking, e.g. for the replayed videos, the source waits when the queue is
+    //! full and the results are never dropped up to the trajectory file.
+    TrackingResultsQueuePtr addDataSource(SetupType::Enum setupType, QList<AgentType> capabilities,
+                                          bool blockingResults = false);
     //! Adds new coordinates conversion.
     void addCoordinatesConversion(SetupType::Enum setupType, CoordinatesConversionPtr coordinatesConversion);
 
@@ -41,6 +55,18 @@ public:
     //! Sets the type of the agent to use in the output data for a generic agent.
     void setGenericAgentReplacementType(AgentType type);
 
+    //! Stops the fusion thread once the results waiting in the input queues
+    //! are merged, and closes the trajectory file with all the results written
+    //! down. Called at the end of the tracking and on the shutdown.
+    void stop();
+
+public slots:
+    //! Called when the source's stream is over and all its frames are
+    //! tracked. Once all the sources are processed, the remaining results are
+    //! merged and sent out, the trajectory file is closed and the
+    //! trackingFinished signal is emitted.
+    void onStreamProcessed(SetupType::Enum setupType);
+
 signals:
     //! The results of merging the data from various sources.
     void notifyAgentDataWorldMerged(QList<AgentDataWorld> agentsDataList,
@@ -48,35 +74,63 @@ signals:
     //! The results of merging the data from various sources,
     //! converted to main setup's frame coordinates.
     void notifyAgentDataImageMerged(QList<AgentDataImage> agentsDataList);
+    //! Notifies that the streams of all the sources are over and their
+    //! results are sent out and written down, e.g. when the replayed videos
+    //! are finished.
+    void trackingFinished();
 
-public slots:
-    //! New tracking results arrive.
-    void onNewData(SetupType::Enum setupType, TimestampedWorldAgentsData agentsData);
+private slots:
+    //! Sends out the merged results waiting in the queue. Called in this object's
+    //! thread when the fusion thread provides new results.
+    void onMergedDataReady();
+
+private:
+    //! The merged data sent out by the manager.
+    struct MergedAgentsData
+    {
+        //! The merged agents.
+        QList<AgentDataWorld> worldAgents;
+        //! The merged agents in the main setup's frame coordinates.
+        QList<AgentDataImage> imageAgents;
+        //! The timestamp of the primary source's data.
+        std::chrono::microseconds timestamp;
+    };
 
 private:
+    //! The fusion thread's loop: waits for the primary source's data, collects
+    //! the data of the secondary sources and merges them together.
+    void runFusion();
+    //! Waits for the primary source's data during the time out and merges
+    //! them with the secondary sources' data. Returns false if no primary
+    //! data came. Called in the fusion thread.
+    bool fuseData(std::chrono::milliseconds timeOut);
+    //! Merges the data of the primary source with the secondary sources' data
+    //! having the closest timestamps, writes the results and passes them to
+    //! this object's thread. Called in the fusion thread.
+    void mergeData(const TimestampedWorldAgentsData& primaryData);
     //! Find the best match to the provided timestamp in the given queue.
-    bool getDataByTimestamp(std::chrono::milliseconds timestamp,
+    bool getDataByTimestamp(std::chrono::microseconds timestamp,
                               QQueue<TimestampedWorldAgentsData>&,
                               TimestampedWorldAgentsData&);
     //! Merges together two data sets by adding newly received agents to
     //! already available and removing the duplicates.
     void matchAgents(QList<AgentDataWorld>& currentAgents, QList<AgentDataWorld>& agentsToJoin, QList<AgentDataWorld>& joinedAgentsList);
     //! Computes the distances and angles between the agents while analyzing this values to remove the impossible combinations.
-    float initializeCostMatrices(const QList<AgentDataWorld>& listOne, const QList<AgentDataWorld>& listTwo, QVector<QVector<float>>& costMatrix);
-    //! Generates all the possible ordered combinations k indices (shorter list one) out of n indices (longer list two),
-    //! taking into account which combinations make sense.
-    void searchBestMatch(int depth, int k, int n, QVector<bool>& usedIndices,
-                         QVector<int>& combination, QVector<int>& bestCombination,
-                         float& minCost, const QVector<QVector<float>>& costMatrix);
-    //! Computes the costs of the given combination.
-    float getCombinationCost(const QVector<int>& combination,
-                                                 const QVector<QVector<float>>& costMatrix);
+    void initializeCostMatrices(const QList<AgentDataWorld>& listOne, const QList<AgentDataWorld>& listTwo, cv::Mat_<double>& costMatrix);
     //! Converts a list of agent data objects from world to image coordinates.
     QList<AgentDataImage> convertToFrameCoordinates(SetupType::Enum setupType, QList<AgentDataWorld> mergedAgentDataList);
 
 private:
-    //! The tracking results recieved from various sources.
+    //! The input queues of the sources.
+    QMap<SetupType::Enum, TrackingResultsQueuePtr> m_inputQueues;
+    //! The sources whose streams are over.
+    QList<SetupType::Enum> m_processedSources;
+    //! The tracking results recieved from the secondary sources, used only
+    //! in the fusion thread.
     QMap<SetupType::Enum, QQueue<TimestampedWorldAgentsData>> m_trackingData;
+    //! Protects the sources, the coordinates conversions and the type for
+    //! generic agents that are set from this object's thread.
+    QMutex m_sourcesMutex;
 
     //! The source whose input that triggers the input data processing,
     //! normally it's the source that provide the most advanced data.
@@ -104,12 +158,36 @@ private:
     //! The penalty for the invalid orientation.
     static constexpr float InvalidOrientationPenaltyRad = M_PI / 16; // i.e. 11.25 degrees
 
+    //! The number of results that the input queues can store.
+    static constexpr size_t InputQueueSize = 10;
+    //! The number of merged results waiting to be sent out.
+    static constexpr size_t MergedQueueSize = 10;
+    //! The period at which the fusion thread checks if it is stopped when
+    //! there is no data.
+    static constexpr std::chrono::milliseconds FusionTimeOutMs = std::chrono::milliseconds(100);
+
     //! Writes down the tracking results to the file.
     TrajectoryWriterPtr m_trajectoryWriter;
     //! The flag that specify if to write trajectories.
     bool m_logResults;
     //! The path to store logs.
     QString m_dataLoggingPath;
+    //! Protects the trajectory writer that is used in the fusion thread.
+    QMutex m_loggingMutex;
+    //! Defines if the fusion thread waits for the trajectory writer instead of
+    //! dropping the results, set when a source's results are blocking.
+    bool m_blockingResults;
+
+    //! The merged results waiting to be sent out from this object's thread.
+    TrackingResultsQueue<MergedAgentsData> m_mergedData;
+    //! Set when the fusion thread has requested to send out the merged
+    //! results, used to not flood this object's thread with the requests.
+    std::atomic_bool m_mergedDataNotified;
+
+    //! The flag to stop the fusion thread.
+    std::atomic_bool m_stopped;
+    //! The fusion thread.
+    std::thread m_fusionThread;
 
     //! Keeps the coordinates conversion map in case if we need to export results in
     //! the image coordinates.
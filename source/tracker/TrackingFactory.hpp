@@ -28,22 +28,32 @@ public:
     {
         TrackingRoutineSettingsPtr settings = TrackingSettings::get().trackingRoutineSettings(setupType);
 
+        TrackingRoutinePtr routine;
         if (!settings.isNull()) {
             switch (settings->type()) {
             case TrackingRoutineType::BLOB_DETECTOR:
-                return TrackingRoutinePtr(new BlobDetector(settings, inputQueue, debugQueue), &QObject::deleteLater);
+                routine = TrackingRoutinePtr(new BlobDetector(settings, inputQueue, debugQueue), &QObject::deleteLater);
+                break;
             case TrackingRoutineType::COLOR_DETECTOR:
-                return TrackingRoutinePtr(new ColorDetector(settings, inputQueue, debugQueue), &QObject::deleteLater);
+                routine = TrackingRoutinePtr(new ColorDetector(settings, inputQueue, debugQueue), &QObject::deleteLater);
+                break;
             case TrackingRoutineType::FISHBOT_LEDS_TRACKING:
-                return TrackingRoutinePtr(new FishBotLedsTracking(settings, inputQueue, debugQueue), &QObject::deleteLater);
+                routine = TrackingRoutinePtr(new FishBotLedsTracking(settings, inputQueue, debugQueue), &QObject::deleteLater);
+                break;
             case TrackingRoutineType::TWO_COLORS_TAG_TRACKING:
-                return TrackingRoutinePtr(new TwoColorsTagTracking(settings, inputQueue, debugQueue), &QObject::deleteLater);
+                routine = TrackingRoutinePtr(new TwoColorsTagTracking(settings, inputQueue, debugQueue), &QObject::deleteLater);
+                break;
             default:
                 qDebug() << "Tracking routine could not be created.";
                 break;
             }
         }
-        return TrackingRoutinePtr();
+        if (!routine.isNull()) {
+            routine->setMotionPrediction(TrackingSettings::get().motionPrediction(setupType));
+            routine->setPipeline(TrackingSettings::get().pipeline(setupType));
+            routine->setMetricsPrefix(QString("%1/tracking").arg(SetupType::toSettingsString(setupType)));
+        }
+        return routine;
     }
 
     /*!
@@ -4,6 +4,7 @@
 #include "gui/TrackingRoutineWidget.hpp"
 
 #include <CoordinatesConversion.hpp>
+#include <MetricsRegistry.hpp>
 #include <TimestampedFrame.hpp>
 
 /*!
@@ -13,13 +14,17 @@ TrackingHandler::TrackingHandler(SetupType::Enum setupType,
                                  CoordinatesConversionPtr coordinatesConversion,
                                  TimestampedFrameQueuePtr inputQueue) :
     QObject(nullptr),
-    m_debugQueue(new TimestampedFrameQueue(100)),
+    m_debugQueue(new TimestampedFrameQueue(QueuePolicy::latestOnly())),
     m_data(new TrackingData(setupType,
                             coordinatesConversion,
                             inputQueue,
                             m_debugQueue)),
     m_widget(new TrackingRoutineWidget(m_data, nullptr)) // on creation the widget's parent is not set, it is treated in the destructor
 {
+    MetricsRegistry::get().registerQueue(QString("%1/trackingDebug")
+                                         .arg(SetupType::toSettingsString(setupType)),
+                                         m_debugQueue);
+
     // NOTE : this code is commented out because the lambda was called after the
     // destruction of TrackingHandler resulting in a crash
 //    // some security: when the tracking widget is destroyed, reset the pointer to it
@@ -0,0 +1,94 @@
+#ifndef CATS2_TRACKING_RESULTS_QUEUE_HPP
+#define CATS2_TRACKING_RESULTS_QUEUE_HPP
+
+#include <readerwriterqueue.h>
+
+#include <QtCore/QSharedPointer>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/*!
+ * \brief The bounded lock-free queue that hands the tracking results over
+ * between two threads. It has one producer and one consumer thread; the memory
+ * is allocated once on creation. When the queue is full the producer drops the
+ * new results instead of waiting, the live tracking is never blocked by a slow
+ * consumer; when the queue is blocking, e.g. for the replayed videos, the
+ * producer waits for a free place until the queue is closed.
+ */
+template <typename Data>
+class TrackingResultsQueue
+{
+public:
+    //! Constructor. Gets the maximal number of results in the queue.
+    explicit TrackingResultsQueue(size_t maxSize) :
+        m_queue(maxSize),
+        m_droppedResults(0),
+        m_blocking(false),
+        m_closed(false)
+    {
+    }
+
+public:
+    //! Adds the results to the queue, returns false if they were dropped
+    //! because the queue is full, or closed when blocking. Called by the
+    //! producer.
+    bool enqueue(const Data& data)
+    {
+        while (!m_queue.try_enqueue(data)) {
+            if (!m_blocking || m_closed) {
+                m_droppedResults++;
+                return false;
+            }
+            std::this_thread::sleep_for(RetryPeriod);
+        }
+        return true;
+    }
+
+    //! Sets if the producer waits for a free place instead of dropping the
+    //! results.
+    void setBlocking(bool blocking) { m_blocking = blocking; }
+    //! Returns true if the producer waits for a free place.
+    bool isBlocking() const { return m_blocking; }
+    //! Releases the waiting producer, the results that don't fit are dropped
+    //! afterwards. Called when the consumer stops.
+    void close() { m_closed = true; }
+
+    //! Gets the results from the queue if any, returns true if succeded.
+    //! Called by the consumer.
+    bool dequeue(Data& data)
+    {
+        return m_queue.try_dequeue(data);
+    }
+
+    //! Gets the results from the queue, waits for them during the time out,
+    //! returns true if succeded. Called by the consumer.
+    bool waitDequeue(Data& data, std::chrono::microseconds timeOut)
+    {
+        return m_queue.wait_dequeue_timed(data, timeOut);
+    }
+
+    //! Returns the approximate number of results in the queue.
+    size_t size() const { return m_queue.size_approx(); }
+    //! Returns the number of results dropped since the queue creation.
+    unsigned long long droppedResults() const { return m_droppedResults; }
+
+private:
+    //! The queue to store data.
+    moodycamel::BlockingReaderWriterQueue<Data> m_queue;
+    //! The number of the dropped results.
+    std::atomic<unsigned long long> m_droppedResults;
+    //! Defines if the producer waits for a free place.
+    std::atomic_bool m_blocking;
+    //! Set when the consumer doesn't take the results anymore.
+    std::atomic_bool m_closed;
+
+    //! The period at which the waiting producer retries to add the results.
+    static constexpr std::chrono::microseconds RetryPeriod = std::chrono::microseconds(200);
+};
+
+template <typename Data>
+constexpr std::chrono::microseconds TrackingResultsQueue<Data>::RetryPeriod;
+
+#endif // CATS2_TRACKING_RESULTS_QUEUE_HPP
@@ -3,20 +3,29 @@
 #include "TrackingDataManager.hpp"
 #include "TrackingHandler.hpp"
 
+#include <MetricsRegistry.hpp>
 #include <TimestampedFrame.hpp>
 #include <CoordinatesConversion.hpp>
 #include <GrabberHandler.hpp>
+#include <GrabberData.hpp>
+#include <RecorderHandler.hpp>
+#include <settings/GrabberSettings.hpp>
 #include <QueueHub.hpp>
+#include <GrabCoordinator.hpp>
 #include <AgentData.hpp>
 
 #include <settings/CalibrationSettings.hpp>
 
 #include <gui/TrackingRoutineWidget.hpp>
 
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+
 /*!
  * Constructor.
  */
-TrackingSetup::TrackingSetup(SetupType::Enum setupType, bool needOutputQueue) :
+TrackingSetup::TrackingSetup(SetupType::Enum setupType, bool needOutputQueue,
+                             GrabCoordinatorPtr grabCoordinator) :
     m_setupType(setupType),
     m_coordinatesConversion(new CoordinatesConversion(CalibrationSettings::get()
                                                       .calibrationFilePath(setupType),
@@ -24,20 +33,60 @@ TrackingSetup::TrackingSetup(SetupType::Enum setupType, bool needOutputQueue) :
                                                       .frameSize(setupType))),
     m_grabber(new GrabberHandler(setupType))
 {
+    RecordingDescription recording = GrabberSettings::get().recording(setupType);
+
+    // the camera images, synchronized with other cameras if requested
+    TimestampedFrameQueuePtr frameQueue = m_grabber->inputQueue();
+    if (!grabCoordinator.isNull())
+        frameQueue = grabCoordinator->addSource(setupType, frameQueue);
+
     // if there is no need to expose camera images in the additional queue then
     // the tracker gets directly the images from the grabber
-    if (!needOutputQueue) {
+    if (!needOutputQueue && !recording.enabled) {
         m_tracking = TrackingHandlerPtr(new TrackingHandler(setupType,
                                                             m_coordinatesConversion,
-                                                            m_grabber->inputQueue()));
+                                                            frameQueue));
     } else {
         // otherwise we need to introduce the multiplicator that will take care
         // about the extra queue
-        m_queueHub = QueueHubPtr(new QueueHub(m_grabber->inputQueue()));
+        m_queueHub = QueueHubPtr(new QueueHub(frameQueue));
+        // the tracker drops the frames only if the grabber does
+        TimestampedFrameQueuePtr trackerQueue;
+        if (frameQueue->policy().type() == QueuePolicy::Type::BLOCKING)
+            trackerQueue = m_queueHub->addOutputQueue(frameQueue->policy());
+        else
+            trackerQueue = m_queueHub->addOutputQueue();
+        MetricsRegistry::get().registerQueue(QString("%1/tracker")
+                                             .arg(SetupType::toSettingsString(setupType)),
+                                             trackerQueue);
         m_tracking = TrackingHandlerPtr(new TrackingHandler(setupType,
                                                             m_coordinatesConversion,
-                                                            m_queueHub->addOutputQueue()));
+                                                            trackerQueue));
+
+        // the recorder drops the frames when the encoder is late, thus it
+        // never slows down the tracker
+        if (recording.enabled) {
+            TimestampedFrameQueuePtr recorderQueue =
+                    m_queueHub->addOutputQueue(QueuePolicy::dropOldest(recording.maxPendingFrames));
+            QString recorderName = QString("%1/recorder").arg(SetupType::toSettingsString(setupType));
+            MetricsRegistry::get().registerQueue(recorderName, recorderQueue);
+            QString setupName = SetupType::toSettingsString(setupType).section('/', -1);
+            QString outputFilePath = QDir(recording.outputPath)
+                    .filePath(QString("%1-%2")
+                              .arg(setupName)
+                              .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd-hh-mm-ss")));
+            m_recorder = RecorderHandlerPtr(new RecorderHandler(recorderQueue, recording, outputFilePath,
+                                                                recorderName));
+        }
     }
+
+    // at the end of the replayed video the tracking stops once the remaining
+    // frames are tracked; NOTE : direct connection as the method only sets
+    // the flag
+    if (!m_tracking.isNull())
+        QObject::connect(m_grabber->data().data(), &GrabberData::endOfStream,
+                         m_tracking->data().data(), &TrackingData::finish,
+                         Qt::DirectConnection);
 }
 
 /*!
@@ -54,9 +103,14 @@ TrackingSetup::~TrackingSetup()
  */
 TimestampedFrameQueuePtr TrackingSetup::viewerQueue()
 {
-    if (!m_queueHub.isNull())
-        return m_queueHub->addOutputQueue();
-    else
+    // the viewer only needs the most recent frame
+    if (!m_queueHub.isNull()) {
+        TimestampedFrameQueuePtr queue = m_queueHub->addOutputQueue(QueuePolicy::latestOnly());
+        MetricsRegistry::get().registerQueue(QString("%1/viewer")
+                                             .arg(SetupType::toSettingsString(m_setupType)),
+                                             queue);
+        return queue;
+    } else
         return TimestampedFrameQueuePtr();
 }
 
@@ -77,9 +131,28 @@ QWidget* TrackingSetup::trackingWidget()
 void TrackingSetup::connectToDataManager(TrackingDataManagerPtr& trackingDataManager)
 {
     if (!m_tracking.isNull()) {
-        trackingDataManager->addDataSource(m_setupType, m_tracking->data()->routineCapabilities());
+        // the results of the replayed video are never dropped, the tracking
+        // waits for the data manager as the grabber waits for the tracking
+        bool blockingResults = (m_grabber->inputQueue()->policy().type() == QueuePolicy::Type::BLOCKING);
+        TrackingResultsQueuePtr resultsQueue = trackingDataManager->addDataSource(m_setupType,
+                                                                                  m_tracking->data()->routineCapabilities(),
+                                                                                  blockingResults);
         trackingDataManager->addCoordinatesConversion(m_setupType, m_coordinatesConversion);
+        // the results are put to the queue in the thread that sends them, the
+        // data manager takes them in its fusion thread
         QObject::connect(m_tracking->data().data(), &TrackingData::trackedAgents,
-                         trackingDataManager.data(), &TrackingDataManager::onNewData);
+                         [=](SetupType::Enum, TimestampedWorldAgentsData agentsData)
+                         {
+                             resultsQueue->enqueue(agentsData);
+                         });
+        // the data manager is notified in its thread, after the last results
+        SetupType::Enum setupType = m_setupType;
+        TrackingDataManager* dataManager = trackingDataManager.data();
+        QObject::connect(m_tracking->data().data(), &TrackingData::streamProcessed,
+                         dataManager,
+                         [=]()
+                         {
+                             dataManager->onStreamProcessed(setupType);
+                         });
     }
 }
@@ -22,8 +22,12 @@ class TrackingSetup
 {
 public:
     //! Constructor. The needOutputQueue specifies if this class needs to provide
-    //! an queue with the camera images to be shown on an external GUI.
-    explicit TrackingSetup(SetupType::Enum setupType, bool needOutputQueue = false);
+    //! an queue with the camera images to be shown on an external GUI. The
+    //! camera images are recorded if it's requested in the grabber settings.
+    //! When the grab coordinator is set, the setup gets the camera images
+    //! synchronized with other cameras.
+    explicit TrackingSetup(SetupType::Enum setupType, bool needOutputQueue = false,
+                           GrabCoordinatorPtr grabCoordinator = GrabCoordinatorPtr());
 
     //! Destructor.
     virtual ~TrackingSetup() final;
@@ -58,6 +62,9 @@ private:
     //! The queue hub to duplicate the frames from the input queue to several output queues. It's created only when
     //! it's requested with a specific flag in the constructor.
     QueueHubPtr m_queueHub;
+    //! The recorder of the camera images, it's created only when the recording
+    //! is enabled in the settings.
+    RecorderHandlerPtr m_recorder;
 };
 
 #endif // CATS2_TRACKING_SETUP_HPP
@@ -0,0 +1,203 @@
+#include "TrajectoryFile.hpp"
+
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+
+#include <cstring>
+
+constexpr quint32 TrajectoryFile::Version;
+const QString TrajectoryFile::Extension = "trj";
+const char TrajectoryFile::Signature[8] = {'C', 'A', 'T', 'S', '2', 'T', 'R', 'J'};
+
+/*!
+ * Removes the frames and sets the number of agents.
+ */
+void TrajectoryChunk::reset(int numberOfAgents)
+{
+    timestampsUs.clear();
+    agents.assign(static_cast<size_t>(qMax(numberOfAgents, 0)), TrajectoryAgentColumns());
+}
+
+/*!
+ * Prepares the stream to read or write the file: the byte order and the
+ * precision of the floating point values are fixed by the format.
+ */
+void TrajectoryFile::setUpStream(QDataStream& stream)
+{
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+}
+
+/*!
+ * Writes the file's header.
+ */
+void TrajectoryFile::writeHeader(QDataStream& stream, const TrajectoryFileHeader& header)
+{
+    stream.writeRawData(Signature, sizeof(Signature));
+    stream << header.version << header.numberOfRobots << header.numberOfAnimals << header.startTimeUs;
+}
+
+/*!
+ * Reads the file's header.
+ */
+bool TrajectoryFile::readHeader(QDataStream& stream, TrajectoryFileHeader& header)
+{
+    char signature[sizeof(Signature)];
+    if ((stream.readRawData(signature, sizeof(signature)) != sizeof(signature)) ||
+            (std::memcmp(signature, Signature, sizeof(Signature)) != 0)) {
+        qDebug() << "Not a trajectory file";
+        return false;
+    }
+
+    stream >> header.version >> header.numberOfRobots >> header.numberOfAnimals >> header.startTimeUs;
+    if (stream.status() != QDataStream::Ok) {
+        qDebug() << "The trajectory file's header is incomplete";
+        return false;
+    }
+    if (header.version != Version) {
+        qDebug() << "Unsupported trajectory file version" << header.version;
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * Writes the chunk, the columns are written one after another.
+ */
+void TrajectoryFile::writeChunk(QDataStream& stream, const TrajectoryChunk& chunk)
+{
+    stream << static_cast<quint32>(chunk.size());
+    for (qint64 timestamp : chunk.timestampsUs)
+        stream << timestamp;
+    for (const TrajectoryAgentColumns& agent : chunk.agents) {
+        for (float x : agent.x)
+            stream << x;
+        for (float y : agent.y)
+            stream << y;
+        for (float direction : agent.direction)
+            stream << direction;
+        for (quint8 flags : agent.flags)
+            stream << flags;
+    }
+}
+
+/*!
+ * Reads the next chunk.
+ */
+bool TrajectoryFile::readChunk(QDataStream& stream, int numberOfAgents, TrajectoryChunk& chunk)
+{
+    quint32 size;
+    stream >> size;
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    // the size of an interrupted chunk is checked before allocating the columns
+    qint64 chunkBytes = static_cast<qint64>(size) * (sizeof(qint64) + numberOfAgents * (3 * sizeof(float) + sizeof(quint8)));
+    if (stream.device() && (stream.device()->bytesAvailable() < chunkBytes)) {
+        qDebug() << "The last trajectory chunk is incomplete and is ignored";
+        return false;
+    }
+
+    chunk.reset(numberOfAgents);
+    chunk.timestampsUs.resize(size);
+    for (qint64& timestamp : chunk.timestampsUs)
+        stream >> timestamp;
+    for (TrajectoryAgentColumns& agent : chunk.agents) {
+        agent.x.resize(size);
+        agent.y.resize(size);
+        agent.direction.resize(size);
+        agent.flags.resize(size);
+        for (float& x : agent.x)
+            stream >> x;
+        for (float& y : agent.y)
+            stream >> y;
+        for (float& direction : agent.direction)
+            stream >> direction;
+        for (quint8& flags : agent.flags)
+            stream >> flags;
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qDebug() << "The last trajectory chunk is incomplete and is ignored";
+        chunk.reset(numberOfAgents);
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * Writes the header of the tab-separated text layout.
+ */
+void TrajectoryFile::writeTextHeader(QTextStream& stream, const TrajectoryFileHeader& header)
+{
+    stream << "timeStep" << "\t";
+    for (quint32 i = 0; i < header.numberOfRobots; ++i) {
+        stream << "robot" << i << "X" << "\t";
+        stream << "robot" << i << "Y" << "\t";
+        stream << "robot" << i << "Direction" << "\t";
+    }
+    for (quint32 i = 0; i < header.numberOfAnimals; ++i) {
+        stream << "fish" << i << "X" << "\t";
+        stream << "fish" << i << "Y" << "\t";
+        stream << "fish" << i << "Direction" << "\t";
+    }
+    stream << "\n";
+}
+
+/*!
+ * Writes the chunk in the tab-separated text layout. The time step is the time
+ * from the program start in seconds, the missing agents are written as NaN.
+ */
+void TrajectoryFile::writeTextChunk(QTextStream& stream, const TrajectoryFileHeader& header, const TrajectoryChunk& chunk)
+{
+    for (size_t frame = 0; frame < chunk.size(); ++frame) {
+        double timeFromStartSec = (chunk.timestampsUs[frame] - header.startTimeUs) / 1e6;
+        stream << QString::number(timeFromStartSec, 'f', 3) << "\t";
+        for (const TrajectoryAgentColumns& agent : chunk.agents) {
+            if (agent.flags[frame] & POSITION_VALID) {
+                stream << static_cast<double>(agent.x[frame]) << "\t";
+                stream << static_cast<double>(agent.y[frame]) << "\t";
+                stream << static_cast<double>(agent.direction[frame]) << "\t";
+            } else {
+                stream << "NaN\t";
+                stream << "NaN\t";
+                stream << "NaN\t";
+            }
+        }
+        stream << "\n";
+    }
+}
+
+/*!
+ * Converts the binary file to the tab-separated text file.
+ */
+int TrajectoryFile::convertToText(QString binaryFilePath, QString textFilePath)
+{
+    QFile binaryFile(binaryFilePath);
+    if (!binaryFile.open(QIODevice::ReadOnly)) {
+        qDebug() << "Can't open the trajectory file" << binaryFilePath;
+        return -1;
+    }
+    QDataStream binaryStream(&binaryFile);
+    setUpStream(binaryStream);
+
+    TrajectoryFileHeader header;
+    if (!readHeader(binaryStream, header))
+        return -1;
+
+    QFile textFile(textFilePath);
+    if (!textFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qDebug() << "Can't open the output file" << textFilePath;
+        return -1;
+    }
+    QTextStream textStream(&textFile);
+    writeTextHeader(textStream, header);
+
+    int frames = 0;
+    TrajectoryChunk chunk;
+    while (!binaryStream.atEnd() && readChunk(binaryStream, header.numberOfAgents(), chunk)) {
+        writeTextChunk(textStream, header, chunk);
+        frames += static_cast<int>(chunk.size());
+    }
+    return frames;
+}
@@ -0,0 +1,114 @@
+#ifndef CATS2_TRAJECTORY_FILE_HPP
+#define CATS2_TRAJECTORY_FILE_HPP
+
+#include <QtCore/QDataStream>
+#include <QtCore/QString>
+#include <QtCore/QTextStream>
+
+#include <vector>
+
+/*!
+ * \brief The header of the binary trajectory file.
+ */
+struct TrajectoryFileHeader
+{
+    //! The version of the format.
+    quint32 version = 0;
+    //! The number of the robots' columns, they come first.
+    quint32 numberOfRobots = 0;
+    //! The number of the animals' columns, they follow the robots.
+    quint32 numberOfAnimals = 0;
+    //! The program start time in microseconds since 1970-01-01T00:00:00
+    //! Universal Coordinated Time, see RunTimer and TimestampClock.
+    qint64 startTimeUs = 0;
+
+    //! Returns the total number of agents' columns.
+    int numberOfAgents() const { return static_cast<int>(numberOfRobots + numberOfAnimals); }
+};
+
+/*!
+ * \brief The columns of one agent in a chunk of the trajectory.
+ */
+struct TrajectoryAgentColumns
+{
+    //! The positions, in meters.
+    std::vector<float> x;
+    std::vector<float> y;
+    //! The orientations, in radians.
+    std::vector<float> direction;
+    //! The validity flags, see TrajectoryFile::Flag.
+    std::vector<quint8> flags;
+};
+
+/*!
+ * \brief A chunk of the trajectory: the timestamps of the frames and the
+ * columns of every agent.
+ */
+struct TrajectoryChunk
+{
+    //! The frames' timestamps in microseconds, see TimestampClock.
+    std::vector<qint64> timestampsUs;
+    //! The agents' columns, the robots first then the animals.
+    std::vector<TrajectoryAgentColumns> agents;
+
+    //! Returns the number of frames in the chunk.
+    size_t size() const { return timestampsUs.size(); }
+    //! Removes the frames and sets the number of agents.
+    void reset(int numberOfAgents);
+};
+
+/*!
+ * \brief The binary trajectory file format. The file is written in the
+ * little-endian byte order and only appended:
+ * - the header: the "CATS2TRJ" signature, the version (quint32), the number of
+ *   robots (quint32), the number of animals (quint32) and the start time
+ *   (qint64, microseconds);
+ * - the chunks: the number of frames n (quint32), the timestamps (n x qint64,
+ *   microseconds), then for every agent its x, y and direction columns
+ *   (3 x n x float, meters and radians) and its flags column (n x quint8).
+ * A chunk interrupted by a crash is ignored when the file is read.
+ */
+class TrajectoryFile
+{
+public:
+    //! The agent's validity flags.
+    enum Flag : quint8 {
+        //! The agent is found on the frame.
+        POSITION_VALID = 0x01,
+        //! The agent's orientation is known.
+        ORIENTATION_VALID = 0x02
+    };
+
+    //! The version of the format.
+    static constexpr quint32 Version = 1;
+    //! The extension of the files.
+    static const QString Extension;
+
+public:
+    //! Prepares the stream to read or write the file.
+    static void setUpStream(QDataStream& stream);
+    //! Writes the file's header.
+    static void writeHeader(QDataStream& stream, const TrajectoryFileHeader& header);
+    //! Reads the file's header. Returns false if it is not a trajectory file
+    //! or its version is not supported.
+    static bool readHeader(QDataStream& stream, TrajectoryFileHeader& header);
+    //! Writes the chunk.
+    static void writeChunk(QDataStream& stream, const TrajectoryChunk& chunk);
+    //! Reads the next chunk. Returns false at the end of the file or if the
+    //! chunk is incomplete.
+    static bool readChunk(QDataStream& stream, int numberOfAgents, TrajectoryChunk& chunk);
+
+    //! Writes the header of the tab-separated text layout.
+    static void writeTextHeader(QTextStream& stream, const TrajectoryFileHeader& header);
+    //! Writes the chunk in the tab-separated text layout, one frame per line.
+    static void writeTextChunk(QTextStream& stream, const TrajectoryFileHeader& header, const TrajectoryChunk& chunk);
+    //! Converts the binary file to the tab-separated text file. Returns the
+    //! number of converted frames or -1 if the conversion failed.
+    static int convertToText(QString binaryFilePath, QString textFilePath);
+
+private:
+    //! The signature at the beginning of the file.
+    static const char Signature[8];
+};
+
+#endif // CATS2_TRAJECTORY_FILE_HPP
@@ -2,6 +2,7 @@
 
 #include "settings/TrackingSettings.hpp"
 
+#include <MetricsRegistry.hpp>
 #include <RunTimer.hpp>
 
 #include <QtCore/QDebug>
@@ -10,10 +11,17 @@
 
 #include <QtCore/QDateTime>
 
+constexpr size_t TrajectoryWriter::QueueSize;
+constexpr size_t TrajectoryWriter::ChunkFrames;
+constexpr std::chrono::milliseconds TrajectoryWriter::ChunkPeriodMs;
+constexpr std::chrono::milliseconds TrajectoryWriter::TimeOutMs;
+
 /*!
  * Constructor.
  */
-TrajectoryWriter::TrajectoryWriter(QString dataLoggingPath)
+TrajectoryWriter::TrajectoryWriter(QString dataLoggingPath) :
+    m_frames(QueueSize),
+    m_stopped(false)
 {
     QString filePath = dataLoggingPath;
     QDir dir;
@@ -38,26 +46,27 @@ TrajectoryWriter::TrajectoryWriter(QString dataLoggingPath)
     if (!dir.exists(filePath))
         dir.mkdir(filePath);
 
+    // the number of agents is fixed for the whole file
+    m_header.version = TrajectoryFile::Version;
+    m_header.numberOfRobots = static_cast<quint32>(qMax(TrackingSettings::get().numberOfRobots(), 0));
+    m_header.numberOfAnimals = static_cast<quint32>(qMax(TrackingSettings::get().numberOfAnimals(), 0));
+    m_header.startTimeUs = RunTimer::get().startTime().count();
+    m_chunk.reset(m_header.numberOfAgents());
+
     // form the file name
-    QString fileName = QString("positions-%1.txt")
-            .arg(QDateTime::currentDateTime().toString("yyyy.MM.dd-hh:mm:ss"));
-    // open the text where to write the tracking results
+    QString fileName = QString("positions-%1.%2")
+            .arg(QDateTime::currentDateTime().toString("yyyy.MM.dd-hh:mm:ss"))
+            .arg(TrajectoryFile::Extension);
+    // open the file where to write the tracking results
     m_resultsFile.setFileName(filePath + QDir::separator() + fileName);
-    if (m_resultsFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    if (m_resultsFile.open(QIODevice::WriteOnly)) {
         m_resultsStream.setDevice(&m_resultsFile);
-        // write the header
-        m_resultsStream << "timeStep" << "\t";
-        for (int i = 0; i < TrackingSettings::get().numberOfRobots(); ++i) {
-            m_resultsStream << "robot" << i << "X" << "\t";
-            m_resultsStream << "robot" << i << "Y" << "\t";
-            m_resultsStream << "robot" << i << "Direction" << "\t";
-        }
-        for (int i = 0; i < TrackingSettings::get().numberOfAnimals(); ++i) {
-            m_resultsStream << "fish" << i << "X" << "\t";
-            m_resultsStream << "fish" << i << "Y" << "\t";
-            m_resultsStream << "fish" << i << "Direction" << "\t";
-        }
-        m_resultsStream << endl;
+        TrajectoryFile::setUpStream(m_resultsStream);
+        TrajectoryFile::writeHeader(m_resultsStream, m_header);
+        m_resultsFile.flush();
+        m_writingThread = std::thread(&TrajectoryWriter::runWriting, this);
+    } else {
+        qDebug() << "Can't open the trajectory file" << m_resultsFile.fileName();
     }
 }
 
@@ -66,41 +75,99 @@ TrajectoryWriter::TrajectoryWriter(QString dataLoggingPath)
  */
 TrajectoryWriter::~TrajectoryWriter()
 {
-    // FIXME : looks like this destructor is never called. To find why
+    stop();
+}
+
+/*!
+ * Writes the remaining results, stops the writing thread and closes the file.
+ * Called on the shutdown through TrackingDataManager::stop, the results that
+ * are not yet written when the program is killed are lost, that is at most
+ * one chunk. Can be called several times.
+ */
+void TrajectoryWriter::stop()
+{
+    m_stopped = true;
+    m_frames.close();
+    if (m_writingThread.joinable())
+        m_writingThread.join();
     m_resultsFile.close();
 }
 
 /*!
- * Saves the tracking results to the ouptup file.
+ * Saves the tracking results to the ouptup file. The results are only queued
+ * here, they are written by the writing thread. When blocking, waits for the
+ * writing thread if the queue is full, otherwise the results are dropped.
  */
-void TrajectoryWriter::writeData(std::chrono::milliseconds timestamp,
+void TrajectoryWriter::writeData(std::chrono::microseconds timestamp,
                                  const QList<AgentDataWorld>& agentsData)
 {
     if (!m_resultsFile.isOpen())
         return;
 
-    // first write the timestamp converted to seconds
-    double timeFromStartSec = RunTimer::get().runtimeSecTo(timestamp);
-    m_resultsStream << QString::number(timeFromStartSec, 'f', 3) << "\t";
+    if (!m_frames.enqueue(Frame{timestamp, agentsData}))
+        MetricsRegistry::get().setValue("trajectory/droppedFrames", m_frames.droppedResults());
+}
+
+/*!
+ * The writing thread's loop. The chunk is written when it's full or when its
+ * first frame is older than the chunk period, thus at most this period of the
+ * trajectory is lost if the program crashes. When stopped, the remaining
+ * frames are written.
+ */
+void TrajectoryWriter::runWriting()
+{
+    Frame frame;
+    while (!m_stopped) {
+        if (m_frames.waitDequeue(frame, TimeOutMs))
+            appendFrame(frame);
+        if ((m_chunk.size() >= ChunkFrames) ||
+                ((m_chunk.size() > 0) &&
+                 (std::chrono::steady_clock::now() - m_chunkStartTime >= ChunkPeriodMs)))
+            writeChunk();
+    }
+
+    while (m_frames.dequeue(frame)) {
+        appendFrame(frame);
+        if (m_chunk.size() >= ChunkFrames)
+            writeChunk();
+    }
+    writeChunk();
+}
+
+/*!
+ * Adds the frame to the chunk: the robots' columns come first, then the fish'.
+ */
+void TrajectoryWriter::appendFrame(const Frame& frame)
+{
+    if (m_chunk.size() == 0)
+        m_chunkStartTime = std::chrono::steady_clock::now();
+    m_chunk.timestampsUs.push_back(frame.timestamp.count());
+
+    auto appendAgent = [this](size_t column, const AgentDataWorld* agentData) {
+        TrajectoryAgentColumns& agent = m_chunk.agents[column];
+        if (agentData) {
+            agent.x.push_back(static_cast<float>(agentData->state().position().x()));
+            agent.y.push_back(static_cast<float>(agentData->state().position().y()));
+            agent.direction.push_back(static_cast<float>(agentData->state().orientation().angleRad()));
+            quint8 flags = 0;
+            if (agentData->state().position().isValid())
+                flags |= TrajectoryFile::POSITION_VALID;
+            if (agentData->state().orientation().isValid())
+                flags |= TrajectoryFile::ORIENTATION_VALID;
+            agent.flags.push_back(flags);
+        } else {
+            agent.x.push_back(0);
+            agent.y.push_back(0);
+            agent.direction.push_back(0);
+            agent.flags.push_back(0);
+        }
+    };
 
     // first write all the robots
     // the robot tracking is very reliable and thus for every robot's we can fix
     // a index in the output table
-    for (int i = 0; i < TrackingSettings::get().numberOfRobots(); ++i) {
-        const AgentDataWorld* robotData = getAgentData(i,
-                                                       AgentType::CASU,
-                                                       m_robotsIndexToId,
-                                                       agentsData);
-        if (robotData) {
-            m_resultsStream << robotData->state().position().x() << "\t";
-            m_resultsStream << robotData->state().position().y() << "\t";
-            m_resultsStream << robotData->state().orientation().angleRad() << "\t";
-        } else {
-            m_resultsStream << "NaN\t";
-            m_resultsStream << "NaN\t";
-            m_resultsStream << "NaN\t";
-        }
-    }
+    for (quint32 i = 0; i < m_header.numberOfRobots; ++i)
+        appendAgent(i, getAgentData(i, AgentType::CASU, m_robotsIndexToId, frame.agentsData));
 
     // then write the fish
     // the fish tracking is less reliable, the danger is that ids swap and
@@ -111,23 +178,26 @@ void TrajectoryWriter::writeData(std::chrono::milliseconds timestamp,
     // at every step and thus localize the above-mentioned problem only to frames
     // when the robot was not properly tracked
     m_fishIndexToId.clear(); // HACK FIXME : fix this code (see comment above)
-    for (int i = 0; i < TrackingSettings::get().numberOfAnimals(); ++i) {
-        const AgentDataWorld* animalData = getAgentData(i,
-                                                        AgentType::FISH,
-                                                        m_fishIndexToId,
-                                                        agentsData);
-        if (animalData) {
-            m_resultsStream << animalData->state().position().x() << "\t";
-            m_resultsStream << animalData->state().position().y() << "\t";
-            m_resultsStream << animalData->state().orientation().angleRad() << "\t";
-        } else {
-            m_resultsStream << "NaN\t";
-            m_resultsStream << "NaN\t";
-            m_resultsStream << "NaN\t";
-        }
-    }
+    for (quint32 i = 0; i < m_header.numberOfAnimals; ++i)
+        appendAgent(m_header.numberOfRobots + i,
+                    getAgentData(i, AgentType::FISH, m_fishIndexToId, frame.agentsData));
+}
 
-    m_resultsStream << endl;
+/*!
+ * Appends the chunk to the file and starts a new one.
+ */
+void TrajectoryWriter::writeChunk()
+{
+    if (m_chunk.size() == 0)
+        return;
+
+    TrajectoryFile::writeChunk(m_resultsStream, m_chunk);
+    m_resultsFile.flush();
+    if (m_resultsStream.status() != QDataStream::Ok) {
+        qDebug() << "Failed to write the trajectory to" << m_resultsFile.fileName();
+        m_resultsStream.resetStatus();
+    }
+    m_chunk.reset(m_header.numberOfAgents());
 }
 
 /*!
@@ -1,29 +1,65 @@
 #ifndef CATS2_TRAJECTORY_WRITER_HPP
 #define CATS2_TRAJECTORY_WRITER_HPP
 
+#include "TrajectoryFile.hpp"
+#include "TrackingResultsQueue.hpp"
+
 #include <AgentData.hpp>
 
 #include <QtCore/QFile>
-#include <QtCore/QTextStream>
+#include <QtCore/QDataStream>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 /*!
- * \brief The class that writes the tracking results to the text file.
+ * \brief The class that writes the tracking results to the binary trajectory
+ * file, see TrajectoryFile. The results are handed over through a lock-free
+ * queue to the writing thread that gathers them in chunks and appends the
+ * chunks to the file, hence the caller never waits for the disk.
  */
 class TrajectoryWriter
 {
 public:
-    //! Constructor.
+    //! Constructor. Starts the writing thread.
     explicit TrajectoryWriter(QString dataLoggingPath);
-    //! Destructor.
+    //! Destructor. Writes the remaining results and stops the writing thread.
     virtual ~TrajectoryWriter() final;
 
+    //! Writes the remaining results, stops the writing thread and closes the
+    //! file. The results that come after are ignored.
+    void stop();
+    //! Sets if writeData waits when the writing thread is late instead of
+    //! dropping the results, used for the replayed videos.
+    void setBlocking(bool blocking) { m_frames.setBlocking(blocking); }
+
     //! Saves the tracking results to the ouptup file.
-    //! timestamp is the number of milliseconds since 1970-01-01T00:00:00
-    //! Universal Coordinated Time.
-    void writeData(std::chrono::milliseconds timestamp,
+    //! timestamp is the number of microseconds since 1970-01-01T00:00:00
+    //! Universal Coordinated Time, see TimestampClock.
+    //! NOTE : it must be called from one thread only.
+    void writeData(std::chrono::microseconds timestamp,
                    const QList<AgentDataWorld>& agentsData);
 
 private:
+    //! The tracking results of one frame.
+    struct Frame
+    {
+        //! The frame's timestamp.
+        std::chrono::microseconds timestamp;
+        //! The agents.
+        QList<AgentDataWorld> agentsData;
+    };
+
+private:
+    //! The writing thread's loop: gathers the frames in the chunk and writes
+    //! it when it's full or old enough.
+    void runWriting();
+    //! Adds the frame to the chunk.
+    void appendFrame(const Frame& frame);
+    //! Appends the chunk to the file.
+    void writeChunk();
+
     //! Searches for the robot of the given type and corresponding to the given
     //! index in the indexToId correspondence map.
     const AgentDataWorld* getAgentData(int index,
@@ -35,12 +71,36 @@ private:
     //! The file to write the tracking results.
     QFile m_resultsFile;
     //! The output stream.
-    QTextStream m_resultsStream;
+    QDataStream m_resultsStream;
+    //! The file's header.
+    TrajectoryFileHeader m_header;
+
+    //! The frames waiting to be written.
+    TrackingResultsQueue<Frame> m_frames;
+    //! The frames gathered to be written in the next chunk.
+    TrajectoryChunk m_chunk;
+    //! The time when the first frame of the chunk was gathered.
+    std::chrono::steady_clock::time_point m_chunkStartTime;
 
     //! Maps robots' indices in the output file to the robots id.
     QMap<int, QString> m_robotsIndexToId;
     //! Maps fish' indices in the output file to the fish id.
     QMap<int, QString> m_fishIndexToId;
+
+    //! The flag to stop the writing thread.
+    std::atomic_bool m_stopped;
+    //! The writing thread.
+    std::thread m_writingThread;
+
+    //! The number of frames that can wait to be written.
+    static constexpr size_t QueueSize = 1024;
+    //! The maximal number of frames in a chunk.
+    static constexpr size_t ChunkFrames = 256;
+    //! The maximal time that the frames stay in the chunk before being written.
+    static constexpr std::chrono::milliseconds ChunkPeriodMs = std::chrono::milliseconds(5000);
+    //! The period at which the writing thread checks if it is stopped when
+    //! there is no data.
+    static constexpr std::chrono::milliseconds TimeOutMs = std::chrono::milliseconds(100);
 };
 
 #endif // CATS2_TRAJECTORY_WRITER_HPP
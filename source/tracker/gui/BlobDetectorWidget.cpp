@@ -86,6 +86,9 @@ void BlobDetectorWidget::updateSettings()
 
     BlobDetector* blobDetector = dynamic_cast<BlobDetector*>(m_routine.data());
     if (blobDetector) {
+        // the ids' assignment and the background model are not edited here
+        updatedSettings.setIdsAssignment(blobDetector->settings().idsAssignment());
+        updatedSettings.setBackgroundModel(blobDetector->settings().backgroundModel());
         blobDetector->setSettings(updatedSettings);
     } else {
         qDebug() << "The tracking routine is ill-defined";
@@ -0,0 +1,306 @@
+#include "BackgroundModel.hpp"
+
+#include <opencv2/bgsegm.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+#include <QtCore/QDebug>
+
+#include <algorithm>
+#include <cmath>
+
+constexpr double MixtureOfGaussiansBackgroundModel::InitialLearningRate;
+constexpr int MedianBackgroundModel::MaxSamples;
+
+namespace {
+
+/*!
+ * Subtracts the running average from the rows of the image and updates the
+ * average in the same pass.
+ */
+class RunningAverageBody : public cv::ParallelLoopBody
+{
+public:
+    //! Constructor.
+    RunningAverageBody(const cv::Mat& image,
+                       cv::Mat& background,
+                       cv::Mat& foreground,
+                       float threshold,
+                       float learningRate,
+                       bool update,
+                       bool updateOutsideBlobsOnly) :
+        m_image(image),
+        m_background(background),
+        m_foreground(foreground),
+        m_threshold(threshold),
+        m_learningRate(learningRate),
+        m_update(update),
+        m_updateOutsideBlobsOnly(updateOutsideBlobsOnly)
+    {
+    }
+
+    //! Processes the rows of the range.
+    virtual void operator()(const cv::Range& rows) const override
+    {
+        for (int row = rows.start; row < rows.end; row++) {
+            const uchar* source = m_image.ptr<uchar>(row);
+            float* background = m_background.ptr<float>(row);
+            uchar* destination = m_foreground.ptr<uchar>(row);
+            int column = 0;
+#if CV_SIMD128
+            column = processVectors(source, background, destination);
+#endif
+            for (; column < m_image.cols; column++) {
+                float difference = source[column] - background[column];
+                bool isForeground = (std::abs(difference) > m_threshold);
+                destination[column] = isForeground ? 255 : 0;
+                if (m_update && !(m_updateOutsideBlobsOnly && isForeground))
+                    background[column] += m_learningRate * difference;
+            }
+        }
+    }
+
+private:
+#if CV_SIMD128
+    /*!
+     * Processes the row by 16 pixels, returns the index of the first pixel
+     * that is left.
+     */
+    int processVectors(const uchar* source, float* background, uchar* destination) const
+    {
+        const int VectorSize = 16;
+        const cv::v_float32x4 zero = cv::v_setzero_f32();
+        const cv::v_float32x4 threshold = cv::v_setall_f32(m_threshold);
+        const cv::v_float32x4 learningRate = cv::v_setall_f32(m_learningRate);
+
+        int column = 0;
+        for (; column <= m_image.cols - VectorSize; column += VectorSize) {
+            cv::v_uint16x8 low, high;
+            cv::v_expand(cv::v_load(source + column), low, high);
+            cv::v_uint32x4 quarters[4];
+            cv::v_expand(low, quarters[0], quarters[1]);
+            cv::v_expand(high, quarters[2], quarters[3]);
+
+            cv::v_int32x4 isForeground[4];
+            for (int quarter = 0; quarter < 4; quarter++) {
+                float* mean = background + column + 4 * quarter;
+                cv::v_float32x4 value = cv::v_cvt_f32(cv::v_reinterpret_as_s32(quarters[quarter]));
+                cv::v_float32x4 average = cv::v_load(mean);
+                cv::v_float32x4 difference = value - average;
+                cv::v_float32x4 foregroundMask = (cv::v_max(difference, zero - difference) > threshold);
+                isForeground[quarter] = cv::v_reinterpret_as_s32(foregroundMask);
+                if (m_update) {
+                    cv::v_float32x4 step = difference * learningRate;
+                    if (m_updateOutsideBlobsOnly)
+                        step = step & ~foregroundMask;
+                    cv::v_store(mean, average + step);
+                }
+            }
+
+            // the masks are -1 or 0, they are packed to 255 or 0
+            cv::v_uint8x16 result = cv::v_reinterpret_as_u8(cv::v_pack(cv::v_pack(isForeground[0], isForeground[1]),
+                                                                       cv::v_pack(isForeground[2], isForeground[3])));
+            cv::v_store(destination + column, result);
+        }
+        return column;
+    }
+#endif
+
+private:
+    //! The grayscale image.
+    const cv::Mat& m_image;
+    //! The running average.
+    cv::Mat& m_background;
+    //! The resulting foreground mask.
+    cv::Mat& m_foreground;
+    //! The foreground threshold.
+    float m_threshold;
+    //! The weight of the image in the updated average.
+    float m_learningRate;
+    //! Defines if the average is updated.
+    bool m_update;
+    //! Defines if the foreground pixels are excluded from the update.
+    bool m_updateOutsideBlobsOnly;
+};
+
+} // namespace
+
+/*!
+ * Constructor.
+ */
+BackgroundModel::BackgroundModel(const BackgroundModelDescription& description) :
+    m_description(description),
+    m_processedFrames(0)
+{
+}
+
+/*!
+ * Destructor.
+ */
+BackgroundModel::~BackgroundModel()
+{
+}
+
+/*!
+ * Makes the model of the given type.
+ */
+BackgroundModelPtr BackgroundModel::create(const BackgroundModelDescription& description)
+{
+    switch (description.type) {
+    case BackgroundModelType::MEDIAN:
+        return BackgroundModelPtr(new MedianBackgroundModel(description));
+    case BackgroundModelType::RUNNING_AVERAGE:
+        return BackgroundModelPtr(new RunningAverageBackgroundModel(description));
+    case BackgroundModelType::MOG:
+    case BackgroundModelType::MOG2:
+    default:
+        return BackgroundModelPtr(new MixtureOfGaussiansBackgroundModel(description));
+    }
+}
+
+/*!
+ * Computes the foreground mask of the grayscale image. The model is updated
+ * on every learning frame, afterwards once every updatePeriodFrames frames.
+ * The foreground mask of the learning frames is not meaningful.
+ */
+void BackgroundModel::apply(const cv::Mat& image, cv::Mat& foreground)
+{
+    if (image.type() != CV_8UC1) {
+        qDebug() << "Unsupported image format" << image.type();
+        return;
+    }
+
+    size_t frameIndex = m_processedFrames++;
+    bool update = isLearningFrame(frameIndex);
+    if (!update && (m_description.updatePeriodFrames > 0))
+        update = ((frameIndex - m_description.learningFrames) % m_description.updatePeriodFrames == 0);
+
+    try {
+        process(image, foreground, frameIndex, update);
+    } catch (const cv::Exception& e) {
+        qDebug() << "OpenCV exception: " << e.what();
+    }
+}
+
+/*!
+ * Constructor.
+ */
+MixtureOfGaussiansBackgroundModel::MixtureOfGaussiansBackgroundModel(const BackgroundModelDescription& description) :
+    BackgroundModel(description),
+    m_subtractor(createSubtractor())
+{
+}
+
+/*!
+ * Computes the foreground mask and updates the model if requested. The model
+ * is made again when the background is reset.
+ */
+void MixtureOfGaussiansBackgroundModel::process(const cv::Mat& image, cv::Mat& foreground, size_t frameIndex, bool update)
+{
+    if (frameIndex == 0)
+        m_subtractor = createSubtractor();
+
+    double learningRate = 0;
+    if (isLearningFrame(frameIndex))
+        learningRate = InitialLearningRate;
+    else if (update)
+        learningRate = m_description.learningRate;
+    m_subtractor->apply(image, foreground, learningRate);
+}
+
+/*!
+ * Makes the background subtractor of the model type.
+ */
+cv::Ptr<cv::BackgroundSubtractor> MixtureOfGaussiansBackgroundModel::createSubtractor() const
+{
+    if (m_description.type == BackgroundModelType::MOG2)
+        return cv::createBackgroundSubtractorMOG2(500, 16, false);
+    return cv::bgsegm::createBackgroundSubtractorMOG(200, 5, 0.3);
+}
+
+/*!
+ * Constructor.
+ */
+MedianBackgroundModel::MedianBackgroundModel(const BackgroundModelDescription& description) :
+    BackgroundModel(description)
+{
+}
+
+/*!
+ * Samples the learning frames evenly, the median is computed on the last one.
+ * If there are no learning frames then the first frame is the background.
+ */
+void MedianBackgroundModel::process(const cv::Mat& image, cv::Mat& foreground, size_t frameIndex, bool /*update*/)
+{
+    if (frameIndex == 0) {
+        m_samples.clear();
+        m_background.release();
+    }
+
+    if (isLearningFrame(frameIndex)) {
+        size_t samplingPeriod = std::max(m_description.learningFrames / MaxSamples, 1);
+        if (frameIndex % samplingPeriod == 0)
+            m_samples.push_back(image.clone());
+        if (frameIndex + 1 == static_cast<size_t>(m_description.learningFrames))
+            computeMedian();
+        foreground = cv::Mat::zeros(image.size(), CV_8UC1);
+        return;
+    }
+
+    if (m_background.size() != image.size())
+        m_background = image.clone();
+    cv::absdiff(image, m_background, m_differenceImage);
+    cv::threshold(m_differenceImage, foreground, m_description.foregroundThreshold, 255, cv::THRESH_BINARY);
+}
+
+/*!
+ * Computes the median of the sampled frames, the samples are released.
+ */
+void MedianBackgroundModel::computeMedian()
+{
+    if (m_samples.empty())
+        return;
+
+    const cv::Size size = m_samples.front().size();
+    m_background.create(size, CV_8UC1);
+    std::vector<uchar> values(m_samples.size());
+    size_t middle = values.size() / 2;
+    for (int row = 0; row < size.height; row++) {
+        uchar* background = m_background.ptr<uchar>(row);
+        for (int column = 0; column < size.width; column++) {
+            for (size_t index = 0; index < m_samples.size(); index++)
+                values[index] = m_samples[index].ptr<uchar>(row)[column];
+            std::nth_element(values.begin(), values.begin() + middle, values.end());
+            background[column] = values[middle];
+        }
+    }
+    m_samples.clear();
+}
+
+/*!
+ * Constructor.
+ */
+RunningAverageBackgroundModel::RunningAverageBackgroundModel(const BackgroundModelDescription& description) :
+    BackgroundModel(description)
+{
+}
+
+/*!
+ * Computes the foreground mask and updates the average if requested. During
+ * the learning the average is the mean of the frames.
+ */
+void RunningAverageBackgroundModel::process(const cv::Mat& image, cv::Mat& foreground, size_t frameIndex, bool update)
+{
+    if ((frameIndex == 0) || (m_background.size() != image.size()))
+        image.convertTo(m_background, CV_32F);
+
+    bool learning = isLearningFrame(frameIndex);
+    float learningRate = learning ? 1.f / (frameIndex + 1) : static_cast<float>(m_description.learningRate);
+    bool updateOutsideBlobsOnly = !learning && m_description.updateOutsideBlobsOnly;
+
+    foreground.create(image.size(), CV_8UC1);
+    cv::parallel_for_(cv::Range(0, image.rows),
+                      RunningAverageBody(image, m_background, foreground,
+                                         m_description.foregroundThreshold,
+                                         learningRate, update, updateOutsideBlobsOnly));
+}
@@ -0,0 +1,181 @@
+#ifndef CATS2_BACKGROUND_MODEL_HPP
+#define CATS2_BACKGROUND_MODEL_HPP
+
+#include "TrackerPointerTypes.hpp"
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/video/background_segm.hpp>
+
+#include <QtCore/QString>
+
+#include <atomic>
+#include <vector>
+
+/*!
+ * The type of the background model.
+ */
+enum class BackgroundModelType
+{
+    MOG,                // the mixture of gaussians from bgsegm, as in CATS
+    MOG2,               // the OpenCV's adaptive mixture of gaussians
+    MEDIAN,             // the median of the learning frames, captured once
+    RUNNING_AVERAGE     // the exponential average of the frames
+};
+
+/*!
+ * \brief The parameters of the background model.
+ */
+struct BackgroundModelDescription
+{
+    //! The model type.
+    BackgroundModelType type = BackgroundModelType::MOG;
+    //! The number of the first frames used to learn the background, no
+    //! foreground is detected meanwhile.
+    int learningFrames = 100;
+    //! The model is updated every updatePeriodFrames frames after the
+    //! learning; 0 means that it is never updated.
+    int updatePeriodFrames = 0;
+    //! Defines if only the pixels outside the detected blobs are updated,
+    //! only the running average supports it.
+    bool updateOutsideBlobsOnly = false;
+    //! The learning rate of the updates after the learning.
+    double learningRate = 0.01;
+    //! The intensity difference from the background above which the pixel is
+    //! in the foreground, used by the median and the running average.
+    int foregroundThreshold = 25;
+
+    //! Gets the model type from the settings' string.
+    static BackgroundModelType typeFromSettingsString(QString typeName)
+    {
+        typeName = typeName.toLower();
+        if (typeName == "mog2")
+            return BackgroundModelType::MOG2;
+        else if (typeName == "median")
+            return BackgroundModelType::MEDIAN;
+        else if (typeName == "runningaverage")
+            return BackgroundModelType::RUNNING_AVERAGE;
+        else
+            return BackgroundModelType::MOG;
+    }
+};
+
+/*!
+ * \brief The background model of the grayscale frames. It is learned on the
+ * first frames, then it gives the foreground mask of every frame and is
+ * updated according to the description.
+ */
+class BackgroundModel
+{
+public:
+    //! Constructor.
+    explicit BackgroundModel(const BackgroundModelDescription& description);
+    //! Destructor.
+    virtual ~BackgroundModel();
+
+    //! Makes the model of the given type.
+    static BackgroundModelPtr create(const BackgroundModelDescription& description);
+
+public:
+    //! Returns true while the background is being learned.
+    bool isLearning() const { return m_processedFrames < static_cast<size_t>(m_description.learningFrames); }
+    //! Computes the foreground mask of the 8 bits grayscale image, updates
+    //! the model when needed.
+    void apply(const cv::Mat& image, cv::Mat& foreground);
+    //! Forgets the background, it is learned again starting from the next
+    //! frame. Can be called from any thread.
+    void reset() { m_processedFrames = 0; }
+
+protected:
+    //! Computes the foreground mask and updates the model if requested. The
+    //! frame index restarts from 0 when the model is reset.
+    virtual void process(const cv::Mat& image, cv::Mat& foreground, size_t frameIndex, bool update) = 0;
+    //! Returns true if the frame is used to learn the background.
+    bool isLearningFrame(size_t frameIndex) const { return frameIndex < static_cast<size_t>(m_description.learningFrames); }
+
+protected:
+    //! The model's parameters.
+    const BackgroundModelDescription m_description;
+
+private:
+    //! The number of the processed frames since the last reset.
+    std::atomic_size_t m_processedFrames;
+};
+
+/*!
+ * \brief The OpenCV's mixture of gaussians models. The update is applied to
+ * the whole frame.
+ */
+class MixtureOfGaussiansBackgroundModel : public BackgroundModel
+{
+public:
+    //! Constructor.
+    explicit MixtureOfGaussiansBackgroundModel(const BackgroundModelDescription& description);
+
+protected:
+    //! Computes the foreground mask and updates the model if requested.
+    virtual void process(const cv::Mat& image, cv::Mat& foreground, size_t frameIndex, bool update) override;
+
+private:
+    //! Makes the background subtractor of the model type.
+    cv::Ptr<cv::BackgroundSubtractor> createSubtractor() const;
+
+private:
+    //! The learning rate used on the learning frames.
+    static constexpr double InitialLearningRate = 0.05;
+    //! The background subtractor.
+    cv::Ptr<cv::BackgroundSubtractor> m_subtractor;
+};
+
+/*!
+ * \brief The static background computed as the per pixel median of the
+ * frames sampled during the learning. It is never updated.
+ */
+class MedianBackgroundModel : public BackgroundModel
+{
+public:
+    //! Constructor.
+    explicit MedianBackgroundModel(const BackgroundModelDescription& description);
+
+protected:
+    //! Computes the foreground mask, the median is computed on the last
+    //! learning frame.
+    virtual void process(const cv::Mat& image, cv::Mat& foreground, size_t frameIndex, bool update) override;
+
+private:
+    //! Computes the median of the sampled frames.
+    void computeMedian();
+
+private:
+    //! The maximal number of the frames sampled to compute the median.
+    static constexpr int MaxSamples = 25;
+    //! The frames sampled during the learning.
+    std::vector<cv::Mat> m_samples;
+    //! The background image.
+    cv::Mat m_background;
+    //! The absolute difference with the background.
+    cv::Mat m_differenceImage;
+};
+
+/*!
+ * \brief The background as the exponential running average of the frames.
+ * The difference, the threshold and the update are done in one pass over the
+ * image, by 16 pixels with the OpenCV's universal intrinsics when they are
+ * available. The update can skip the foreground pixels, thus the agents that
+ * stay still are not absorbed in the background.
+ */
+class RunningAverageBackgroundModel : public BackgroundModel
+{
+public:
+    //! Constructor.
+    explicit RunningAverageBackgroundModel(const BackgroundModelDescription& description);
+
+protected:
+    //! Computes the foreground mask and updates the average if requested.
+    virtual void process(const cv::Mat& image, cv::Mat& foreground, size_t frameIndex, bool update) override;
+
+private:
+    //! The floating point background image.
+    cv::Mat m_background;
+};
+
+#endif // CATS2_BACKGROUND_MODEL_HPP
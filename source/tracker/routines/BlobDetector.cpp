@@ -1,7 +1,5 @@
 #include "BlobDetector.hpp"
 
-#include <opencv2/bgsegm.hpp>
-
 #include "settings/BlobDetectorSettings.hpp"
 #include <TimestampedFrame.hpp>
 #include <AgentData.hpp>
@@ -9,13 +7,18 @@
 #include <QtCore/QtMath>
 #include <QtCore/QMutexLocker>
 
+#include <algorithm>
+#include <numeric>
+
 /*!
  * Constructor. Gets the settings, the input queue to process and a queue to place debug images on request.
  */
 BlobDetector::BlobDetector(TrackingRoutineSettingsPtr settings, TimestampedFrameQueuePtr inputQueue, TimestampedFrameQueuePtr debugQueue) :
     TrackingRoutine(inputQueue, debugQueue),
-    m_backgroundCalculationStepCounter(0),
-    m_backgroundSubtractor(cv::bgsegm::createBackgroundSubtractorMOG(200, 5, 0.3))
+    m_detectionScale(settings.isNull() ? 1 : settings->detectionScale()),
+    m_tilingDescription(settings.isNull() ? TilingDescription() : settings->tiling()),
+    m_tiling(),
+    m_backgroundResetRequested(false)
 {
     // NOTE : to get parameters specific for this tracker we need to convert
     // the settings to the corresponding format
@@ -27,6 +30,9 @@ BlobDetector::BlobDetector(TrackingRoutineSettingsPtr settings, TimestampedFrame
         qDebug() << "Could not set the routune's settings";
     }
 
+    int an = 1;
+    m_morphologyElement = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(an*2+1, an*2+1), cv::Point(an, an));
+
     // set the agents' list
     for (unsigned char id = 1; id <= m_settings.numberOfAgents(); id++) {
         AgentDataImage agent(QString::number(id), AgentType::GENERIC);
@@ -45,71 +51,89 @@ BlobDetector::~BlobDetector()
 /*!
  * The tracking routine excecuted. Gets the frame, tracks agents and fills the
  * _agents list, also sends out the debug images on request.
- * All the processing is done on the red channel of the original image.
+ * All the processing is done on the grayscale images prepared by preprocess.
  */
-void BlobDetector::doTracking(const TimestampedFrame& frame)
+void BlobDetector::doTracking(const TimestampedFrame& /*frame*/)
 {
-    cv::Mat image = frame.image();
-
-    // convert the image to grayscale
-    cv::cvtColor(image, m_grayscaleImage, CV_RGB2GRAY);
-    // learn the background
-    if (m_backgroundCalculationStepCounter < BackgroundCalculationSufficientNumber) {
-        // update the background
-        m_backgroundSubtractor.get()->apply(m_grayscaleImage, m_foregroundImage, 0.05);
-        m_backgroundCalculationStepCounter++;
-        // until we have a solid background model it's pointless to do processing
+    // the images are prepared by preprocess
+    m_grayscaleImage = preparedImage(GrayscaleImage);
+    const cv::Mat& detectionImage = preparedImage(DetectionImage);
+    if (detectionImage.empty())
         return;
-    }
-    // subract the background
-    m_backgroundSubtractor.get()->apply(m_grayscaleImage, m_foregroundImage, 0.0);
 
-    // dilate and erode directly after
-    int an = 1;
-    cv::Mat element = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(an*2+1, an*2+1), cv::Point(an, an));
-    cv::dilate(m_foregroundImage, m_foregroundImage, element);
-    cv::erode(m_foregroundImage, m_foregroundImage, element);
-
-    // lock the mutex
+    // copy the settings to use them in all the tiles
     m_settingsMutex.lock();
-    // filter out small blobs on the mask image
-    if (m_settings.minBlobSizePx() > 0) {
-        removeSmallBlobs(m_foregroundImage, m_settings.minBlobSizePx());
+    BlobDetectorSettingsData settings = m_settings;
+    m_settingsMutex.unlock();
+
+    // split the image in tiles that are processed in parallel, every tile
+    // has its own background model
+    if (m_tiling.imageSize() != detectionImage.size()) {
+        m_tiling = FrameTiling(detectionImage.size(), m_tilingDescription, m_detectionScale);
+        m_tilesData.assign(m_tiling.size(), TileData());
+        for (TileData& tileData : m_tilesData)
+            tileData.backgroundModel = BackgroundModel::create(settings.backgroundModel());
+    }
+    if (m_backgroundResetRequested.exchange(false)) {
+        for (TileData& tileData : m_tilesData)
+            tileData.backgroundModel->reset();
     }
+    // the tiles' models are learned together
+    bool learning = m_tilesData.front().backgroundModel->isLearning();
 
-    // all the corners corresponding to fishes' heads
-    std::vector<cv::Point2f> corners;
+    m_tiling.forEach([&](size_t tileIndex)
+    {
+        detectBlobs(tileIndex, detectionImage, settings, learning);
+    });
+    // until we have a solid background model it's pointless to do processing
+    if (learning)
+        return;
+
+    // the corners are selected relatively to the strongest response of the
+    // whole frame, thus the quality level doesn't depend on the tiling
+    double maxCornerResponse = 0;
+    for (const TileData& tileData : m_tilesData)
+        maxCornerResponse = std::max(maxCornerResponse, tileData.maxCornerResponse);
+    double cornerThreshold = settings.qualityLevel() * maxCornerResponse;
+    m_tiling.forEach([&](size_t tileIndex)
+    {
+        findCorners(tileIndex, settings, cornerThreshold);
+    });
+
+    // collect the blobs from all the tiles
     // centers of the detected objects
     std::vector<cv::Point2f> centers;
     // corners that are inside the detected objects
     std::vector<std::vector<cv::Point2f>> cornersInContours;
-
-    try {
-        // find the most prominent corners in the image
-        cv::goodFeaturesToTrack(m_grayscaleImage,               // input
-                                corners,                      // output
-                                m_settings.numberOfAgents(),    // max number of corners to search
-                                m_settings.qualityLevel(),
-                                m_settings.minDistance(),
-                                m_foregroundImage,              // mask
-                                m_settings.blockSize(),
-                                m_settings.useHarrisDetector(),
-                                m_settings.k());
-    } catch (const cv::Exception& e) {
-        qDebug() << "OpenCV exception: " << e.what();
+    // the areas of the detected objects
+    std::vector<int> areas;
+    for (const TileData& tileData : m_tilesData) {
+        centers.insert(centers.end(), tileData.centers.begin(), tileData.centers.end());
+        cornersInContours.insert(cornersInContours.end(), tileData.cornersInContours.begin(), tileData.cornersInContours.end());
+        areas.insert(areas.end(), tileData.areas.begin(), tileData.areas.end());
     }
-
-    // unlock the mutex
-    m_settingsMutex.unlock();
-
-    // find the contours in the image containing the detected corners
-    detectContours(m_foregroundImage, corners, centers, cornersInContours);
+    // every tile searches for all the agents, only the biggest blobs are kept
+    if (centers.size() > static_cast<size_t>(std::max(settings.numberOfAgents(), 0)))
+        keepBiggestBlobs(settings.numberOfAgents(), areas, centers, cornersInContours);
 
     // submit the debug image
     if (m_enqueueDebugFrames) {
-        enqueueDebugImage(m_foregroundImage);
+        if (m_tilesData.size() == 1) {
+            enqueueDebugImage(m_tilesData.front().foregroundImage);
+        } else {
+            cv::Mat debugImage = cv::Mat::zeros(detectionImage.size(), CV_8UC1);
+            for (size_t tileIndex = 0; tileIndex < m_tilesData.size(); ++tileIndex) {
+                const FrameTiling::Tile& tile = m_tiling.tiles()[tileIndex];
+                m_tilesData[tileIndex].foregroundImage(tile.core - tile.area.tl()).copyTo(debugImage(tile.core));
+            }
+            enqueueDebugImage(debugImage);
+        }
     }
 
+    // bring the results to the full resolution
+    if (m_detectionScale > 1)
+        refineDetections(centers, cornersInContours);
+
     // compute the agents orientations
     std::vector<float> directions(centers.size());
     for (size_t i = 0; i < directions.size(); ++i) {
@@ -120,7 +144,7 @@ void BlobDetector::doTracking(const TimestampedFrame& frame)
     }
 
     // tracking : assign the detected agents to id's
-    assingIds(IdsAssignmentMethod::NAIVE_CLOSEST_NEIGHBOUR, centers, directions);
+    assingIds(settings.idsAssignment(), centers, directions);
 
 //    qDebug() << QString("Found %1 agents out of %2")
 //                .arg(directions.size())
@@ -135,102 +159,321 @@ void BlobDetector::doTracking(const TimestampedFrame& frame)
 }
 
 /*!
- * Finds and removes the blobs on the mask image that are smaller than given threshold (in px).
+ * Converts the image to grayscale, unless the grabber already delivers the
+ * grayscale frames. The detection is done on the downscaled image if
+ * requested, then the results are refined on the full resolution image.
  */
-void BlobDetector::removeSmallBlobs(cv::Mat& image, int minSize)
+void BlobDetector::preprocess(const TimestampedFrame& frame, std::vector<cv::Mat>& preparedImages)
 {
-    // first get all the contours on the image
-    std::vector<cv::Vec4i> hierarchy;
-    std::vector<std::vector<cv::Point>> contours;
+    const cv::Mat& image = frame.image();
+    cv::Mat grayscaleImage;
+    if (image.channels() == 1)
+        grayscaleImage = image;
+    else
+        cv::cvtColor(image, grayscaleImage, CV_RGB2GRAY);
+
+    cv::Mat detectionImage = grayscaleImage;
+    if (m_detectionScale > 1)
+        cv::resize(grayscaleImage, detectionImage, cv::Size(),
+                   1. / m_detectionScale, 1. / m_detectionScale, cv::INTER_AREA);
+
+    preparedImages = {grayscaleImage, detectionImage};
+}
 
-    cv::Mat contoursImage;  // used by the contours detection method cv::findContours();
-                            // this methods draws the found contours directly on the
-                            // source image thus modifying it.
+/*!
+ * Detects the blobs in the tile: the background is subtracted, the foreground
+ * blobs are labelled and the small ones are removed, then the corner response
+ * is computed. The blobs that contain the most prominent corners are found by
+ * findCorners once the responses of all the tiles are known.
+ */
+void BlobDetector::detectBlobs(size_t tileIndex,
+                               const cv::Mat& image,
+                               const BlobDetectorSettingsData& settings,
+                               bool learning)
+{
+    const FrameTiling::Tile& tile = m_tiling.tiles()[tileIndex];
+    TileData& tileData = m_tilesData[tileIndex];
+    tileData.centers.clear();
+    tileData.cornersInContours.clear();
+    tileData.areas.clear();
+    cv::Mat tileImage = image(tile.area);
+
+    // subract the background, the model is learned on the first frames and
+    // then updated as set in the settings
+    tileData.backgroundModel->apply(tileImage, tileData.foregroundImage);
+    if (learning)
+        return;
+
+    // dilate and erode directly after
+    cv::dilate(tileData.foregroundImage, tileData.foregroundImage, m_morphologyElement);
+    cv::erode(tileData.foregroundImage, tileData.foregroundImage, m_morphologyElement);
 
-    image.copyTo(contoursImage);
+    // label the blobs
+    labelBlobs(tileData);
+    // filter out small blobs on the mask image
+    if (settings.minBlobSizePx() > 0) {
+        removeSmallBlobs(tileData, settings.minBlobSizePx() / (m_detectionScale * m_detectionScale));
+    }
+
+    // the response of the corners corresponding to fishes' heads
+    computeCornerResponse(tileIndex, tileImage, settings);
+}
+
+/*!
+ * Computes the corner response of the tile as cv::goodFeaturesToTrack does,
+ * and its maximum within the foreground. The maximum is taken over the tile's
+ * core only, where the response is the same as on the whole image.
+ */
+void BlobDetector::computeCornerResponse(size_t tileIndex,
+                                         const cv::Mat& tileImage,
+                                         const BlobDetectorSettingsData& settings)
+{
+    const FrameTiling::Tile& tile = m_tiling.tiles()[tileIndex];
+    TileData& tileData = m_tilesData[tileIndex];
+    tileData.maxCornerResponse = 0;
     try {
-        cv::findContours(contoursImage, contours, hierarchy, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE, cv::Point(0, 0));
+        if (settings.useHarrisDetector())
+            cv::cornerHarris(tileImage, tileData.cornerResponse, settings.blockSize(), 3, settings.k());
+        else
+            cv::cornerMinEigenVal(tileImage, tileData.cornerResponse, settings.blockSize(), 3);
+        cv::Rect core = tile.core - tile.area.tl();
+        cv::minMaxLoc(tileData.cornerResponse(core), nullptr, &tileData.maxCornerResponse,
+                      nullptr, nullptr, tileData.foregroundImage(core));
     } catch (const cv::Exception& e) {
         qDebug() << "OpenCV exception: " << e.what();
+        tileData.cornerResponse.release();
     }
+}
 
-    // check them one by one to find those that are smaller than minSize
-    std::vector<std::vector<cv::Point>> smallContours;
-    for (auto& contour : contours)
-    {
-        if (cv::contourArea(contour) < minSize)
-        {
-            // keep small contours to remove them later
-            smallContours.push_back(contour);
+/*!
+ * Finds the most prominent corners of the tile as cv::goodFeaturesToTrack
+ * does, but with the absolute response threshold computed for the whole
+ * frame: the local maxima of the response in the foreground that are above
+ * the threshold are taken from the strongest one, skipping those too close to
+ * the corners already taken. Then the blobs containing the corners are found.
+ */
+void BlobDetector::findCorners(size_t tileIndex, const BlobDetectorSettingsData& settings, double threshold)
+{
+    TileData& tileData = m_tilesData[tileIndex];
+    // all the corners corresponding to fishes' heads
+    std::vector<cv::Point2f> corners;
+
+    if (!tileData.cornerResponse.empty() && (threshold > 0)) {
+        cv::Mat response;
+        cv::threshold(tileData.cornerResponse, response, threshold, 0, cv::THRESH_TOZERO);
+        cv::Mat dilatedResponse;
+        cv::dilate(response, dilatedResponse, cv::Mat());
+
+        // the local maxima, the borders are skipped
+        std::vector<std::pair<float, cv::Point>> candidates;
+        for (int row = 1; row < response.rows - 1; ++row) {
+            const float* values = response.ptr<float>(row);
+            const float* maxima = dilatedResponse.ptr<float>(row);
+            const uchar* mask = tileData.foregroundImage.ptr<uchar>(row);
+            for (int column = 1; column < response.cols - 1; ++column) {
+                if ((values[column] != 0) && (values[column] == maxima[column]) && mask[column])
+                    candidates.push_back(std::make_pair(values[column], cv::Point(column, row)));
+            }
+        }
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [](const std::pair<float, cv::Point>& lhs, const std::pair<float, cv::Point>& rhs) {
+            return lhs.first > rhs.first;
+        });
+
+        double minDistance = settings.minDistance() / m_detectionScale;
+        size_t maxCorners = (settings.numberOfAgents() > 0) ? static_cast<size_t>(settings.numberOfAgents())
+                                                            : candidates.size();
+        for (const auto& candidate : candidates) {
+            if (corners.size() >= maxCorners)
+                break;
+            cv::Point2f point(candidate.second);
+            bool isFar = std::all_of(corners.begin(), corners.end(), [&](const cv::Point2f& corner) {
+                cv::Point2f difference = point - corner;
+                return difference.dot(difference) >= minDistance * minDistance;
+            });
+            if (isFar)
+                corners.push_back(point);
         }
     }
 
-    // fill small contours with black color
-    if (smallContours.size() > 0)
-    {
-        // the line thikness -1 apparently makes this method to fill the contour
-        // "https://www.researchgate.net/post/How_does_one_fill_a_closed_contour"
-        cv::drawContours(image, smallContours, -1, cv::Scalar(0, 0, 0), -1);
-    }
+    // find the blobs containing the detected corners
+    groupCorners(tileIndex, corners);
 }
 
 /*!
- * Finds the contours in the image.
+ * Labels the blobs of the tile's foreground image, the blobs' areas and
+ * centroids are computed in the same pass.
  */
-void BlobDetector::detectContours(cv::Mat& image,
-                                  const std::vector<cv::Point2f>& corners,
-                                  std::vector<cv::Point2f>& centers,
-                                  std::vector<std::vector<cv::Point2f>>& cornersInContours)
+void BlobDetector::labelBlobs(TileData& tileData)
 {
-    std::vector<std::vector<cv::Point>> contours;
-    std::vector<cv::Vec4i> hierarchy;
     try {
-        // retrieve contours from the binary image
-        cv::findContours(image, contours, hierarchy, cv::RETR_CCOMP, cv::CHAIN_APPROX_SIMPLE, cv::Point(0, 0));
+        cv::connectedComponentsWithStats(tileData.foregroundImage, tileData.labelsImage,
+                                         tileData.blobsStats, tileData.blobsCentroids, 8, CV_32S);
     } catch (const cv::Exception& e) {
         qDebug() << "OpenCV exception: " << e.what();
+        // no blobs
+        tileData.labelsImage = cv::Mat::zeros(tileData.foregroundImage.size(), CV_32S);
+        tileData.blobsStats.release();
+        tileData.blobsCentroids.release();
     }
+}
 
-    if (hierarchy.size() > 0)
-    {
-        int idx = 0;
-        cv::Scalar color(255, 255, 255);
-        // draw the contours on the original image
-        // TODO : rewrite it to fit the general style
-        for (; idx >= 0; idx = hierarchy[idx][0] )
-        {
-            cv::drawContours(image, contours, idx, color, CV_FILLED, 8, hierarchy);
+/*!
+ * Removes the blobs that are smaller than given threshold (in px) from the
+ * tile's foreground image. Only the pixels within the small blobs' bounding
+ * boxes are visited.
+ */
+void BlobDetector::removeSmallBlobs(TileData& tileData, int minSize)
+{
+    // the label 0 is the background
+    for (int label = 1; label < tileData.blobsStats.rows; ++label) {
+        if (tileData.blobsStats.at<int>(label, cv::CC_STAT_AREA) >= minSize)
+            continue;
+        cv::Rect box = blobBoundingBox(tileData, label);
+        for (int row = box.y; row < box.y + box.height; ++row) {
+            const int* labels = tileData.labelsImage.ptr<int>(row);
+            uchar* foreground = tileData.foregroundImage.ptr<uchar>(row);
+            for (int column = box.x; column < box.x + box.width; ++column) {
+                if (labels[column] == label)
+                    foreground[column] = 0;
+            }
         }
+        // the corners are never found in the removed blobs
+        tileData.blobsStats.at<int>(label, cv::CC_STAT_AREA) = 0;
     }
+}
 
-    std::vector<std::vector<cv::Point>> contoursPoly;
-    contoursPoly.resize(contours.size());
-
-    // all corners that are inside the contour
-    std::vector<cv::Point2f> cornersInContour;
+/*!
+ * Groups the corners by the blobs containing them, the blob is found by the
+ * corner's label. Only the blobs that contain corners and belong to the tile
+ * are taken, their centers are the centroids.
+ */
+void BlobDetector::groupCorners(size_t tileIndex, const std::vector<cv::Point2f>& corners)
+{
+    const FrameTiling::Tile& tile = m_tiling.tiles()[tileIndex];
+    TileData& tileData = m_tilesData[tileIndex];
+    const cv::Point2f offset = tile.area.tl();
+
+    // the index of the blob's entry in the results, -1 if it has no corners or
+    // it doesn't belong to the tile
+    std::vector<int> blobIndices(tileData.blobsStats.rows, -1);
+    std::vector<bool> ownedBlobs(tileData.blobsStats.rows, false);
+    for (int label = 1; label < tileData.blobsStats.rows; ++label) {
+        cv::Point2f center(static_cast<float>(tileData.blobsCentroids.at<double>(label, 0)),
+                           static_cast<float>(tileData.blobsCentroids.at<double>(label, 1)));
+        cv::Rect box = blobBoundingBox(tileData, label);
+        ownedBlobs[label] = (tileData.blobsStats.at<int>(label, cv::CC_STAT_AREA) > 0) &&
+                m_tiling.owns(tileIndex, box + tile.area.tl(), center + offset);
+    }
 
-    for (size_t i = 0; i < contours.size(); ++i) {
-        cv::approxPolyDP(cv::Mat(contours[i]), contoursPoly[i], 3, true);
-        cornersInContour.clear();
-        for (auto& corner: corners) {
-            if(cv::pointPolygonTest(contours[i], corner, false) >= 0) {
-                cornersInContour.push_back(corner);
-            }
+    for (const cv::Point2f& corner : corners) {
+        cv::Point pixel(cvRound(corner.x), cvRound(corner.y));
+        if (!cv::Rect(cv::Point(), tileData.labelsImage.size()).contains(pixel))
+            continue;
+        int label = tileData.labelsImage.at<int>(pixel);
+        if ((label <= 0) || (label >= tileData.blobsStats.rows) || !ownedBlobs[label])
+            continue;
+        if (blobIndices[label] < 0) {
+            blobIndices[label] = static_cast<int>(tileData.centers.size());
+            tileData.centers.push_back(cv::Point2f(static_cast<float>(tileData.blobsCentroids.at<double>(label, 0)),
+                                                   static_cast<float>(tileData.blobsCentroids.at<double>(label, 1))));
+            tileData.cornersInContours.push_back(std::vector<cv::Point2f>());
+            tileData.areas.push_back(tileData.blobsStats.at<int>(label, cv::CC_STAT_AREA));
         }
-        // take only the contours that contain corners
-        if (cornersInContour.size() > 0) {
-            centers.push_back(contourCenter(contours[i]));
-            cornersInContours.push_back(cornersInContour);
+        tileData.cornersInContours[blobIndices[label]].push_back(corner);
+    }
+
+    // draw corners that are inside the blobs and the corresponding blobs'
+    // centers
+    if (m_enqueueDebugFrames) {
+        cv::Scalar color = cv::Scalar(100, 100, 100);
+        int r = 3;
+        for (unsigned int i = 0; i < tileData.cornersInContours.size(); ++i) {
+            cv::circle(tileData.foregroundImage, tileData.cornersInContours[i][0], r, color, -1, 8, 0);
+            cv::circle(tileData.foregroundImage, tileData.centers[i], r, color, -1, 8, 0);
         }
     }
 
-    // draw corners that are inside the contours and inclosing circles
-    // and the corresponding countours' centers
-    cv::Scalar color = cv::Scalar(100, 100, 100);
-    int r = 3;
-    for (unsigned int i = 0; i < cornersInContours.size(); ++i) {
-        cv::circle(image, cornersInContours[i][0], r, color, -1, 8, 0);
-        cv::circle(image, centers[i], r, color, -1, 8, 0);
+    // bring the results to the image coordinates
+    for (cv::Point2f& center : tileData.centers)
+        center += offset;
+    for (auto& cornersInContour : tileData.cornersInContours) {
+        for (cv::Point2f& corner : cornersInContour)
+            corner += offset;
+    }
+}
+
+/*!
+ * Returns the bounding box of the labelled blob in the tile.
+ */
+cv::Rect BlobDetector::blobBoundingBox(const TileData& tileData, int label)
+{
+    return cv::Rect(tileData.blobsStats.at<int>(label, cv::CC_STAT_LEFT),
+                    tileData.blobsStats.at<int>(label, cv::CC_STAT_TOP),
+                    tileData.blobsStats.at<int>(label, cv::CC_STAT_WIDTH),
+                    tileData.blobsStats.at<int>(label, cv::CC_STAT_HEIGHT));
+}
+
+/*!
+ * Keeps only the given number of the biggest blobs.
+ */
+void BlobDetector::keepBiggestBlobs(int numberOfBlobs,
+                                    const std::vector<int>& areas,
+                                    std::vector<cv::Point2f>& centers,
+                                    std::vector<std::vector<cv::Point2f>>& cornersInContours)
+{
+    std::vector<size_t> indices(centers.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    std::sort(indices.begin(), indices.end(), [&areas](size_t lhs, size_t rhs) {
+        return areas[lhs] > areas[rhs];
+    });
+    indices.resize(std::max(numberOfBlobs, 0));
+
+    std::vector<cv::Point2f> biggestCenters;
+    std::vector<std::vector<cv::Point2f>> biggestCornersInContours;
+    for (size_t index : indices) {
+        biggestCenters.push_back(centers[index]);
+        biggestCornersInContours.push_back(cornersInContours[index]);
+    }
+    centers.swap(biggestCenters);
+    cornersInContours.swap(biggestCornersInContours);
+}
+
+/*!
+ * Converts the detections made on the downscaled image to the full resolution.
+ * The corners are refined to the subpixel precision in the full resolution
+ * windows around them.
+ */
+void BlobDetector::refineDetections(std::vector<cv::Point2f>& centers,
+                                    std::vector<std::vector<cv::Point2f>>& cornersInContours)
+{
+    for (cv::Point2f& center : centers)
+        center = toFullResolution(center, m_detectionScale);
+
+    std::vector<cv::Point2f> corners;
+    for (auto& cornersInContour : cornersInContours) {
+        for (cv::Point2f& corner : cornersInContour)
+            corner = toFullResolution(corner, m_detectionScale);
+        corners.insert(corners.end(), cornersInContour.begin(), cornersInContour.end());
+    }
+    if (corners.empty())
+        return;
+
+    try {
+        cv::cornerSubPix(m_grayscaleImage,
+                         corners,
+                         cv::Size(m_detectionScale, m_detectionScale),
+                         cv::Size(-1, -1),
+                         cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 10, 0.1));
+    } catch (const cv::Exception& e) {
+        qDebug() << "OpenCV exception: " << e.what();
+        return;
+    }
+
+    size_t cornerIndex = 0;
+    for (auto& cornersInContour : cornersInContours) {
+        for (cv::Point2f& corner : cornersInContour)
+            corner = corners[cornerIndex++];
     }
 }
 
@@ -257,5 +500,6 @@ void BlobDetector::setSettings(const BlobDetectorSettingsData& settings)
 void BlobDetector::resetBackground()
 {
     qDebug() << "Resetting the background image";
-    m_backgroundCalculationStepCounter = 0;
+    // the models are reset in the tracking thread
+    m_backgroundResetRequested = true;
 }
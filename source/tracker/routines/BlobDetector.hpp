@@ -2,6 +2,8 @@
 #define CATS2_BLOB_DETECTOR_HPP
 
 #include "TrackingRoutine.hpp"
+#include "BackgroundModel.hpp"
+#include "FrameTiling.hpp"
 #include "settings/BlobDetectorSettings.hpp"
 #include "TrackerPointerTypes.hpp"
 
@@ -21,6 +23,8 @@ public:
 
     //! Reports on what type of agent can be tracked by this routine.
     virtual QList<AgentType> capabilities() const override;
+    //! Returns true, the agents' identities are kept by the ids assignment.
+    virtual bool keepsAgentsIdentities() const override { return true; }
 
     //! Getter for the settings.
     const BlobDetectorSettingsData& settings() const { return m_settings; }
@@ -34,29 +38,81 @@ protected:
     //! agents, eventually associates them with the trajectories and
     //! enqueue debug images on request. Overriden from TrackingRoutine.
     virtual void doTracking(const TimestampedFrame& frame) override;
+    //! Prepares the grayscale and the detection images. Overriden from
+    //! TrackingRoutine.
+    virtual void preprocess(const TimestampedFrame& frame, std::vector<cv::Mat>& preparedImages) override;
 
 private:
-    //! Finds and removes the blobs on the mask image that are smaller than given threshold (in px).
-    void removeSmallBlobs(cv::Mat& image, int minSize);
-    //! Finds the contours in the red channel image.
-    void detectContours(cv::Mat& image, const std::vector<cv::Point2f>& m_corners, std::vector<cv::Point2f>& centers, std::vector<std::vector<cv::Point2f>>& cornersInContours);
+    //! The indices of the prepared images.
+    static constexpr size_t GrayscaleImage = 0;
+    static constexpr size_t DetectionImage = 1;
+
+    //! The intermediate data of a tile.
+    struct TileData
+    {
+        //! The backgound model, the first frames are used to learn it.
+        BackgroundModelPtr backgroundModel;
+        //! The foreground image.
+        cv::Mat foregroundImage;
+        //! The labels of the foreground blobs.
+        cv::Mat labelsImage;
+        //! The bounding boxes and the areas of the blobs, by label.
+        cv::Mat blobsStats;
+        //! The centroids of the blobs, by label.
+        cv::Mat blobsCentroids;
+        //! The corner response of the tile's image.
+        cv::Mat cornerResponse;
+        //! The strongest corner response in the tile's core within the
+        //! foreground.
+        double maxCornerResponse = 0;
+        //! The centers of the blobs that belong to the tile.
+        std::vector<cv::Point2f> centers;
+        //! The corners in every blob that belongs to the tile.
+        std::vector<std::vector<cv::Point2f>> cornersInContours;
+        //! The areas of the blobs that belong to the tile.
+        std::vector<int> areas;
+    };
+
+    //! Detects the agents' blobs in the tile.
+    void detectBlobs(size_t tileIndex, const cv::Mat& image, const BlobDetectorSettingsData& settings, bool learning);
+    //! Labels the blobs of the tile's foreground image and computes their statistics.
+    void labelBlobs(TileData& tileData);
+    //! Removes the blobs that are smaller than given threshold (in px) from the tile's foreground image.
+    void removeSmallBlobs(TileData& tileData, int minSize);
+    //! Computes the corner response of the tile and its maximum.
+    void computeCornerResponse(size_t tileIndex, const cv::Mat& tileImage, const BlobDetectorSettingsData& settings);
+    //! Finds the tile's corners whose response is above the threshold and groups them by blob.
+    void findCorners(size_t tileIndex, const BlobDetectorSettingsData& settings, double threshold);
+    //! Finds the tile's blobs that contain the corners, stores their centers and the corners in every blob.
+    void groupCorners(size_t tileIndex, const std::vector<cv::Point2f>& corners);
+    //! Returns the bounding box of the labelled blob in the tile.
+    static cv::Rect blobBoundingBox(const TileData& tileData, int label);
+    //! Keeps only the given number of the biggest blobs.
+    static void keepBiggestBlobs(int numberOfBlobs, const std::vector<int>& areas, std::vector<cv::Point2f>& centers, std::vector<std::vector<cv::Point2f>>& cornersInContours);
+    //! Converts the detections made on the downscaled image to the full
+    //! resolution, the corners are refined on the full resolution image.
+    void refineDetections(std::vector<cv::Point2f>& centers, std::vector<std::vector<cv::Point2f>>& cornersInContours);
 
 private:
-    //! First processing steps are used to compute the background.
-    std::atomic_size_t m_backgroundCalculationStepCounter;
-    //! The number of steps that is enough to compute the background.
-    static const size_t BackgroundCalculationSufficientNumber = 100;
+    //! The factor by which the frames are downscaled for the detection.
+    const int m_detectionScale;
+    //! The parameters of the tiled processing.
+    const TilingDescription m_tilingDescription;
+    //! The tiles of the detection image.
+    FrameTiling m_tiling;
+    //! The data of every tile.
+    std::vector<TileData> m_tilesData;
+    //! Set when the background is to be learned again.
+    std::atomic_bool m_backgroundResetRequested;
     //! The tracking settings.
     BlobDetectorSettingsData m_settings;
 
 private:
-    //! The backgound model.
-    cv::Ptr<cv::BackgroundSubtractor> m_backgroundSubtractor;
+    //! The structuring element of the morphological operations.
+    cv::Mat m_morphologyElement;
     //! The intermediate data.
     //! The grayscale version of the frame image.
     cv::Mat m_grayscaleImage;
-    //! The foreground image.
-    cv::Mat m_foregroundImage;
 };
 
 #endif // CATS2_BLOB_DETECTOR_HPP
@@ -1,4 +1,5 @@
 #include "ColorDetector.hpp"
+#include "HsvThreshold.hpp"
 
 #include "settings/ColorDetectorSettings.hpp"
 #include <TimestampedFrame.hpp>
@@ -15,7 +16,10 @@
  * Constructor. Gets the settings, the input queue to process and a queue to place debug images on request.
  */
 ColorDetector::ColorDetector(TrackingRoutineSettingsPtr settings, TimestampedFrameQueuePtr inputQueue, TimestampedFrameQueuePtr debugQueue) :
-    TrackingRoutine(inputQueue, debugQueue)
+    TrackingRoutine(inputQueue, debugQueue),
+    m_detectionScale(settings.isNull() ? 1 : settings->detectionScale()),
+    m_tilingDescription(settings.isNull() ? TilingDescription() : settings->tiling()),
+    m_tiling()
 {
     // HACK : to get parameters specific for this tracker we need to convert the settings to the corresponding format
     ColorDetectorSettings* colorDetectorSettings = dynamic_cast<ColorDetectorSettings*>(settings.data());
@@ -27,7 +31,10 @@ ColorDetector::ColorDetector(TrackingRoutineSettingsPtr settings, TimestampedFra
     }
 
     // set the mask file
-    m_maskImage = cv::imread(m_settings.maskFilePath()/*, cv::IMREAD_GRAYSCALE*/);
+    m_maskImage = cv::imread(m_settings.maskFilePath(), cv::IMREAD_GRAYSCALE);
+
+    int an = 1;
+    m_morphologyElement = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(an*2+1, an*2+1), cv::Point(an, an));
 
     // set the agents' list
     for (unsigned char id = 1; id <= m_settings.numberOfAgents(); id++) {
@@ -50,19 +57,25 @@ ColorDetector::~ColorDetector()
   */
 void ColorDetector::doTracking(const TimestampedFrame& frame)
 {
-    cv::Mat image = frame.image();
+    const cv::Mat& image = frame.image();
 
     // limit the image format to three channels color images
     if (image.type() == CV_8UC3) {
-        // first blur the image
-        cv::blur(image, m_blurredImage, cv::Size(3, 3));
-
-        // apply the mask if defined
-        // TODO : to add support for different types of masks to be less picky
-        if ((m_maskImage.data != nullptr) && (m_blurredImage.type() == m_maskImage.type()))
-            m_blurredImage = m_blurredImage & m_maskImage;
-        else {
-//            qDebug() << "The mask's type is not compatible with the image";
+        if (image.size() != m_maskFrameSize)
+            checkMask(image.size());
+
+        // the image downscaled for the detection is prepared by preprocess,
+        // the mask is downscaled once; without the prepared image the
+        // detection is done on the full resolution, hence its scale is 1
+        const cv::Mat* detectionImage = &image;
+        const cv::Mat* detectionMask = &m_maskImage;
+        int detectionScale = 1;
+        if ((m_detectionScale > 1) && !preparedImage(ScaledImage).empty()) {
+            detectionImage = &preparedImage(ScaledImage);
+            detectionScale = m_detectionScale;
+            if ((m_maskImage.data != nullptr) && (m_scaledMaskImage.size() != detectionImage->size()))
+                cv::resize(m_maskImage, m_scaledMaskImage, detectionImage->size(), 0, 0, cv::INTER_NEAREST);
+            detectionMask = &m_scaledMaskImage;
         }
 
         int h,s,v;
@@ -70,41 +83,22 @@ void ColorDetector::doTracking(const TimestampedFrame& frame)
         m_settings.color().getHsv(&h, &s, &v);
         int tolerance = m_settings.threshold();
         m_settingsMutex.unlock();
+        cv::Scalar lowerBound(h / 2 - tolerance, 0 , v - 2 * tolerance);
+        cv::Scalar upperBound(h / 2 + tolerance, 255, 255);
 
-        // convert to hsv
-        cv::cvtColor(m_blurredImage, m_hsvImage, CV_RGB2HSV);
-        // threshold the image in the HSV color space
-        cv::inRange(m_hsvImage,
-                    cv::Scalar(h / 2 - tolerance, 0 , v - 2 * tolerance),
-                    cv::Scalar(h / 2 + tolerance, 255, 255),
-                    m_binaryImage); //
-
-        // postprocessing of the binary image
-        int an = 1;
-        cv::Mat element = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(an*2+1, an*2+1), cv::Point(an, an)); // TODO : inititialize this in the constructor
-
-
-        //morphological opening (remove small objects from the foreground)
-        cv::erode(m_binaryImage, m_binaryImage, element);
-        cv::dilate(m_binaryImage, m_binaryImage, element);
-
-        //morphological closing (fill small holes in the foreground)
-        cv::dilate(m_binaryImage, m_binaryImage, element);
-        cv::erode(m_binaryImage, m_binaryImage, element);
-
-//        // submit the debug image
-//        if (m_enqueueDebugFrames) {
-//            enqueueDebugImage(m_binaryImage);
-//        }
-        // TODO : make a devoted method
-        // detect the spots as contours
-        std::vector<std::vector<cv::Point>> contours;
-        try { // TODO : to check if this try-catch can be removed or if it should be used everywhere where opencv methods are used.
-            // retrieve contours from the binary image
-            cv::findContours(m_binaryImage, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
-        } catch (const cv::Exception& e) {
-            qDebug() << "OpenCV exception: " << e.what();
+        // split the image in tiles that are processed in parallel, the spots
+        // are then collected from all the tiles
+        if (m_tiling.imageSize() != detectionImage->size()) {
+            m_tiling = FrameTiling(detectionImage->size(), m_tilingDescription, detectionScale);
+            m_tilesData.assign(m_tiling.size(), TileData());
         }
+        m_tiling.forEach([&](size_t tileIndex)
+        {
+            detectSpots(tileIndex, *detectionImage, *detectionMask, lowerBound, upperBound);
+        });
+        std::vector<std::vector<cv::Point>> contours;
+        for (const TileData& tileData : m_tilesData)
+            contours.insert(contours.end(), tileData.contours.begin(), tileData.contours.end());
 
         // sort the contours by size (inspired by http://stackoverflow.com/questions/33401745/find-largest-contours-opencv)
         std::vector<int> indices(contours.size());
@@ -113,11 +107,15 @@ void ColorDetector::doTracking(const TimestampedFrame& frame)
             return cv::contourArea(contours[lhs],false) > cv::contourArea(contours[rhs],false);
         });
 
-        // centers of contour
+        // centers of contour, refined on the full resolution image when the
+        // detection is done on the downscaled one
         int agentIndex = 0;
         for (auto& contour: contours) {
             if (agentIndex < m_agents.size()) {
-                m_agents[agentIndex].mutableState()->setPosition(contourCenter(contour));
+                cv::Point2f center = contourCenter(contour);
+                if (detectionScale > 1)
+                    center = refineCenter(image, contour, lowerBound, upperBound);
+                m_agents[agentIndex].mutableState()->setPosition(center);
                 agentIndex++;
             } else {
                 break;
@@ -126,16 +124,84 @@ void ColorDetector::doTracking(const TimestampedFrame& frame)
 
         // submit the debug image
         if (m_enqueueDebugFrames) {
+            cv::Mat debugImage = image.clone();
             for (auto& agent: m_agents) {
-                cv::circle(m_blurredImage, cv::Point(agent.state().position().x(), agent.state().position().y()), 2, cv::Scalar(255, 255, 255));
+                cv::circle(debugImage, cv::Point(agent.state().position().x(), agent.state().position().y()), 2, cv::Scalar(255, 255, 255));
             }
-            enqueueDebugImage(m_blurredImage);
+            enqueueDebugImage(debugImage);
         }
     }
     else
         qDebug() << "Unsupported image format" << image.type();
 }
 
+/*!
+ * Downscales the image for the detection if requested.
+ */
+void ColorDetector::preprocess(const TimestampedFrame& frame, std::vector<cv::Mat>& preparedImages)
+{
+    preparedImages.clear();
+    const cv::Mat& image = frame.image();
+    if ((m_detectionScale > 1) && (image.type() == CV_8UC3)) {
+        cv::Mat scaledImage;
+        cv::resize(image, scaledImage, cv::Size(), 1. / m_detectionScale, 1. / m_detectionScale, cv::INTER_AREA);
+        preparedImages.push_back(scaledImage);
+    }
+}
+
+/*!
+ * Detects the colored spots in the tile: the tile is blurred, thresholded in
+ * the HSV color space and cleaned by the morphological operations, then the
+ * spots are found as contours. Only the spots that belong to the tile are
+ * kept.
+ */
+void ColorDetector::detectSpots(size_t tileIndex,
+                                const cv::Mat& image,
+                                const cv::Mat& mask,
+                                cv::Scalar lowerBound,
+                                cv::Scalar upperBound)
+{
+    const FrameTiling::Tile& tile = m_tiling.tiles()[tileIndex];
+    TileData& tileData = m_tilesData[tileIndex];
+    tileData.contours.clear();
+
+    // first blur the image
+    cv::blur(image(tile.area), tileData.blurredImage, cv::Size(3, 3));
+
+    // threshold the image in the HSV color space, the mask is applied if
+    // defined, it's checked to fit the image in checkMask
+    cv::Mat tileMask;
+    if (mask.data != nullptr)
+        tileMask = mask(tile.area);
+    HsvThreshold::apply(tileData.blurredImage,
+                        tileMask,
+                        lowerBound,
+                        upperBound,
+                        tileData.binaryImage);
+
+    //morphological opening (remove small objects from the foreground)
+    cv::erode(tileData.binaryImage, tileData.binaryImage, m_morphologyElement);
+    cv::dilate(tileData.binaryImage, tileData.binaryImage, m_morphologyElement);
+
+    //morphological closing (fill small holes in the foreground)
+    cv::dilate(tileData.binaryImage, tileData.binaryImage, m_morphologyElement);
+    cv::erode(tileData.binaryImage, tileData.binaryImage, m_morphologyElement);
+
+    // detect the spots as contours
+    std::vector<std::vector<cv::Point>> contours;
+    try {
+        // retrieve contours from the binary image
+        cv::findContours(tileData.binaryImage, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE, tile.area.tl());
+    } catch (const cv::Exception& e) {
+        qDebug() << "OpenCV exception: " << e.what();
+    }
+
+    for (auto& contour : contours) {
+        if (m_tiling.owns(tileIndex, cv::boundingRect(contour), contourCenter(contour)))
+            tileData.contours.push_back(contour);
+    }
+}
+
 /*!
  * Reports on what type of agent can be tracked by this routine.
  */
@@ -144,6 +210,50 @@ QList<AgentType> ColorDetector::capabilities() const
     return QList<AgentType>({AgentType::CASU}); // FIXME : must be generic
 }
 
+/*!
+ * Checks that the mask fits the frames of the given size. The mask of another
+ * size is dropped with a single message, thus the detection runs without the
+ * per frame checks.
+ */
+void ColorDetector::checkMask(cv::Size frameSize)
+{
+    m_maskFrameSize = frameSize;
+    if ((m_maskImage.data != nullptr) && (m_maskImage.size() != frameSize)) {
+        qDebug() << QString("The mask %1x%2 doesn't fit the frames %3x%4, ignored")
+                    .arg(m_maskImage.cols).arg(m_maskImage.rows)
+                    .arg(frameSize.width).arg(frameSize.height);
+        m_maskImage.release();
+        m_scaledMaskImage.release();
+    }
+}
+
+/*!
+ * Refines the center of the spot detected on the downscaled image: the spot's
+ * window is thresholded on the full resolution image and the center of the
+ * found pixels is returned. If nothing is found, the coarse center is kept.
+ */
+cv::Point2f ColorDetector::refineCenter(const cv::Mat& image,
+                                        const std::vector<cv::Point>& contour,
+                                        cv::Scalar lowerBound,
+                                        cv::Scalar upperBound)
+{
+    cv::Point2f coarseCenter = toFullResolution(contourCenter(contour), m_detectionScale);
+    cv::Rect window = toFullResolution(cv::boundingRect(contour), m_detectionScale, m_detectionScale, image.size());
+    if (window.area() == 0)
+        return coarseCenter;
+
+    cv::blur(image(window), m_windowImage, cv::Size(3, 3));
+    cv::Mat windowMask;
+    if (m_maskImage.data != nullptr)
+        windowMask = m_maskImage(window);
+    HsvThreshold::apply(m_windowImage, windowMask, lowerBound, upperBound, m_windowBinaryImage);
+
+    cv::Moments moments = cv::moments(m_windowBinaryImage, true);
+    if (moments.m00 > 0)
+        return cv::Point2f(window.x + moments.m10 / moments.m00, window.y + moments.m01 / moments.m00);
+    return coarseCenter;
+}
+
 /*!
  * Updates the settings.
  */
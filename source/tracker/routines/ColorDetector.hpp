@@ -2,6 +2,7 @@
 #define CATS2_COLOR_DETECTOR_HPP
 
 #include "TrackingRoutine.hpp"
+#include "FrameTiling.hpp"
 #include "settings/ColorDetectorSettings.hpp"
 #include "TrackerPointerTypes.hpp"
 
@@ -34,27 +35,71 @@ protected:
     //! agents, eventually associates them with the trajectories and
     //! enqueue debug images on request. Overriden from TrackingRoutine.
     virtual void doTracking(const TimestampedFrame& frame) override;
+    //! Prepares the downscaled image. Overriden from TrackingRoutine.
+    virtual void preprocess(const TimestampedFrame& frame, std::vector<cv::Mat>& preparedImages) override;
 
 private:
+    //! The index of the prepared downscaled image.
+    static constexpr size_t ScaledImage = 0;
+
     //! The tracking settings.
     ColorDetectorSettingsData m_settings;
     //! Searches for the given robot's leds on the image.
     void detectLeds(size_t robotIndex);
+    //! Detects the colored spots in the tile, keeps those that belong to it.
+    void detectSpots(size_t tileIndex,
+                     const cv::Mat& image,
+                     const cv::Mat& mask,
+                     cv::Scalar lowerBound,
+                     cv::Scalar upperBound);
+    //! Checks that the mask fits the frames of the given size, the mask that
+    //! doesn't fit is dropped. Called once per frame size.
+    void checkMask(cv::Size frameSize);
+    //! Refines the center of the spot detected on the downscaled image.
+    cv::Point2f refineCenter(const cv::Mat& image,
+                             const std::vector<cv::Point>& contour,
+                             cv::Scalar lowerBound,
+                             cv::Scalar upperBound);
+
+private:
+    //! The factor by which the frames are downscaled for the detection.
+    const int m_detectionScale;
+    //! The parameters of the tiled processing.
+    const TilingDescription m_tilingDescription;
+    //! The tiles of the detection image.
+    FrameTiling m_tiling;
+
+    //! The intermediate data of a tile.
+    struct TileData
+    {
+        //! The image after blurring.
+        cv::Mat blurredImage;
+        //! The binary image after threshold was applied.
+        cv::Mat binaryImage;
+        //! The spots that belong to the tile, in the image coordinates.
+        std::vector<std::vector<cv::Point>> contours;
+    };
+    //! The data of every tile.
+    std::vector<TileData> m_tilesData;
 
 private:
     //! The intermediate data.
     //! The binary mask image.
     cv::Mat m_maskImage;
-    //! The image after blurring.
-    cv::Mat m_blurredImage;
-    //! The image in HSV format.
-    cv::Mat m_hsvImage;
+    //! The downscaled mask.
+    cv::Mat m_scaledMaskImage;
+    //! The frame size for which the mask is checked.
+    cv::Size m_maskFrameSize;
+    //! The structuring element of the morphological operations.
+    cv::Mat m_morphologyElement;
+    //! The full resolution window around a detected spot, blurred.
+    cv::Mat m_windowImage;
+    //! The thresholded window.
+    cv::Mat m_windowBinaryImage;
     //! The binary image after the color subtraction.
     cv::Mat m_differenceImage;
     //! The grayscale image.
     cv::Mat m_grayscaleImage;
-    //! The binary image after threshold was applied.
-    cv::Mat m_binaryImage;
     //! The foreground image.
     cv::Mat m_foregroundImage;
 };
@@ -1,16 +1,47 @@
 #include "FishBotLedsTracking.hpp"
+#include "HsvThreshold.hpp"
 
 #include "settings/FishBotLedsTrackingSettings.hpp"
 #include <TimestampedFrame.hpp>
 #include <AgentData.hpp>
+#include <MetricsRegistry.hpp>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
 
 #include <QtCore/QtMath>
 #include <QtCore/QMutex>
 
+#include <chrono>
 #include <cmath>
+#include <functional>
+
+namespace {
+
+/*!
+ * Runs the given function for every index of the range on the OpenCV's
+ * threads pool.
+ */
+class ParallelLoop : public cv::ParallelLoopBody
+{
+public:
+    //! Constructor.
+    explicit ParallelLoop(std::function<void(int)> body) : m_body(body) { }
+
+    //! Runs the body for every index of the range.
+    virtual void operator()(const cv::Range& range) const override
+    {
+        for (int index = range.start; index < range.end; ++index)
+            m_body(index);
+    }
+
+private:
+    //! The function to run.
+    std::function<void(int)> m_body;
+};
+
+} // namespace
 
 /*!
  * Constructor. Gets the settings, the input queue to process and a queue to
@@ -19,7 +50,8 @@
 FishBotLedsTracking::FishBotLedsTracking(TrackingRoutineSettingsPtr settings,
                                          TimestampedFrameQueuePtr inputQueue,
                                          TimestampedFrameQueuePtr debugQueue) :
-    TrackingRoutine(inputQueue, debugQueue)
+    TrackingRoutine(inputQueue, debugQueue),
+    m_fullFramePrepared(false)
 {
     // HACK : to get parameters specific for this tracker we need to convert the
     // settings to the corresponding format
@@ -32,8 +64,14 @@ FishBotLedsTracking::FishBotLedsTracking(TrackingRoutineSettingsPtr settings,
         qDebug() << "Could not set the routune's settings";
     }
 
+    // the structuring element of the morphological operations
+    int an = 1;
+    m_morphologyElement = cv::getStructuringElement(cv::MORPH_ELLIPSE,
+                                                    cv::Size(an*2+1, an*2+1),
+                                                    cv::Point(an, an));
+
     // set the mask file
-    m_maskImage = cv::imread(m_settings.maskFilePath()/*, cv::IMREAD_GRAYSCALE*/);
+    m_maskImage = cv::imread(m_settings.maskFilePath(), cv::IMREAD_GRAYSCALE);
     if (m_maskImage.data == nullptr)
         qDebug() << QString("Could not find the mask file: %1")
                     .arg(QString::fromStdString(m_settings.maskFilePath()));
@@ -48,12 +86,18 @@ FishBotLedsTracking::FishBotLedsTracking(TrackingRoutineSettingsPtr settings,
         AgentDataImage agent(robotDescription.id, AgentType::CASU);
         m_agents.append(agent);
 
-        // set the mask files
-        m_areaRobotMasks.append(cv::imread(robotDescription.areaMaskFilePath));
-        if (m_areaRobotMasks.last().data == nullptr)
+        // set the mask files, the robot's mask is combined with the arena
+        // mask
+        cv::Mat areaRobotMask = cv::imread(robotDescription.areaMaskFilePath, cv::IMREAD_GRAYSCALE);
+        if (areaRobotMask.data == nullptr) {
             qDebug() << QString("Could not find the agent %1's mask file: %2")
                         .arg(robotDescription.id)
                         .arg(QString::fromStdString(robotDescription.areaMaskFilePath));
+            areaRobotMask = m_maskImage;
+        } else if ((m_maskImage.data != nullptr) && (m_maskImage.size() == areaRobotMask.size())) {
+            cv::bitwise_and(areaRobotMask, m_maskImage, areaRobotMask);
+        }
+        m_areaRobotMasks.append(areaRobotMask);
     }
 
     // initialize the previous states
@@ -70,32 +114,86 @@ FishBotLedsTracking::~FishBotLedsTracking()
 }
 
 /*!
- * The tracking routine excecuted.
+ * The tracking routine excecuted. The frame is blurred only once for all the
+ * robots. When the search area is limited, only the areas around the robots'
+ * previous positions are blurred and thresholded in one pass. When one of the
+ * robots is lost the whole frame is blurred and converted to HSV once, and
+ * every robot searching the whole frame only thresholds this HSV image.
  */
 void FishBotLedsTracking::doTracking(const TimestampedFrame& frame)
 {
-    cv::Mat image = frame.image();
+    const cv::Mat& image = frame.image();
 
     // limit the image format to three channels color images
     if (image.type() == CV_8UC3) {
-        // first blur the image
-        cv::blur(image, m_blurredImage, cv::Size(3, 3));
-        // apply the mask if defined
-        // TODO : to add support for different types of masks to be less picky
-        if ((m_maskImage.data != nullptr) &&
-                (m_blurredImage.type() == m_maskImage.type()))
-        {
-            m_blurredImage = m_blurredImage & m_maskImage;
-        } else {
-//            qDebug() << "The mask's type is not compatible with the image";
-        }
+        m_blurredImage.create(image.size(), image.type());
+        m_fullFramePrepared = false;
+        m_searchAreas.clear();
 
-        // detect robots
         m_settingsMutex.lock();
         unsigned int numberOfAgents = m_settings.numberOfAgents();
+        int searchRadiusPx = m_settings.searchRadiusPx();
         m_settingsMutex.unlock();
+
+        // the areas around the robots' previous positions
+        cv::Rect frameArea(cv::Point(0, 0), image.size());
+        for (size_t robotIndex = 0; robotIndex < numberOfAgents; robotIndex++) {
+            cv::Rect searchArea = frameArea;
+            if ((searchRadiusPx > 0) && (static_cast<int>(robotIndex) < m_previousStates.size()) &&
+                    m_previousStates[robotIndex].position().isValid())
+            {
+                cv::Point2f center = m_previousStates[robotIndex].position().toCvPoint2f();
+                searchArea = cv::Rect(cv::Point(center.x - searchRadiusPx, center.y - searchRadiusPx),
+                                      cv::Size(2 * searchRadiusPx + 1, 2 * searchRadiusPx + 1)) & frameArea;
+                if (searchArea.area() == 0)
+                    searchArea = frameArea;
+            }
+            if (searchArea == frameArea)
+                m_fullFramePrepared = true;
+            m_searchAreas.append(searchArea);
+        }
+
+        // blur the image
+        if (m_fullFramePrepared) {
+            prepareFullFrame(image);
+        } else {
+            for (const cv::Rect& searchArea : m_searchAreas)
+                prepareArea(image, searchArea);
+        }
+
+        // detect robots concurrently
+        m_binaryImages.resize(numberOfAgents);
+        m_robotsContours.resize(numberOfAgents);
+        m_detectionTimesMs.assign(numberOfAgents, 0);
+        std::vector<size_t> robotIndices;
+        for (size_t robotIndex = 0; robotIndex < numberOfAgents; robotIndex++)
+            robotIndices.push_back(robotIndex);
+        detectRobots(robotIndices);
+
+        // the lost robots are searched on the whole frame
+        robotIndices.clear();
+        for (size_t robotIndex = 0; robotIndex < numberOfAgents; robotIndex++) {
+            if (m_robotsContours[robotIndex].empty() && (m_searchAreas[robotIndex] != frameArea)) {
+                m_searchAreas[robotIndex] = frameArea;
+                robotIndices.push_back(robotIndex);
+            }
+        }
+        if (!robotIndices.empty()) {
+            if (!m_fullFramePrepared) {
+                prepareFullFrame(image);
+                m_fullFramePrepared = true;
+            }
+            detectRobots(robotIndices);
+        }
+
+        // update the robots' states
         for (size_t robotIndex = 0; robotIndex < numberOfAgents; robotIndex++) {
-            detectLeds(robotIndex);
+            updateRobotState(robotIndex, m_robotsContours[robotIndex]);
+            m_settingsMutex.lock();
+            QString robotId = m_settings.robotDescription(robotIndex).id;
+            m_settingsMutex.unlock();
+            MetricsRegistry::get().setValue(QString("fishBotLedsTracking/%1/detectionMs").arg(robotId),
+                                            m_detectionTimesMs[robotIndex]);
         }
 
         // copy the states for the next iteration
@@ -105,13 +203,16 @@ void FishBotLedsTracking::doTracking(const TimestampedFrame& frame)
 
         // submit the debug image
         if (m_enqueueDebugFrames) {
+            cv::Mat debugImage = image.clone();
+            for (const cv::Rect& searchArea : m_searchAreas)
+                cv::rectangle(debugImage, searchArea, cv::Scalar(0, 255, 0));
             for (auto& agent: m_agents) {
-                cv::circle(m_maskedImage,
+                cv::circle(debugImage,
                            cv::Point(agent.state().position().x(),
                                      agent.state().position().y()),
                            2, cv::Scalar(255, 255, 255));
             }
-            enqueueDebugImage(m_maskedImage);
+            enqueueDebugImage(debugImage);
         }
     }
     else
@@ -119,18 +220,54 @@ void FishBotLedsTracking::doTracking(const TimestampedFrame& frame)
 }
 
 /*!
- * Searches for the given robot's leds on the image.
-*/
-void FishBotLedsTracking::detectLeds(size_t robotIndex)
+ * Blurs the given area of the image. The result is written in the
+ * corresponding area of the blurred image.
+ */
+void FishBotLedsTracking::prepareArea(const cv::Mat& image, cv::Rect area)
 {
-    // apply the mask if supported
-    if ((m_areaRobotMasks[robotIndex].data != nullptr) &&
-            (m_blurredImage.type() == m_areaRobotMasks[robotIndex].type()))
+    cv::Mat blurredArea = m_blurredImage(area);
+    cv::blur(image(area), blurredArea, cv::Size(3, 3));
+}
+
+/*!
+ * Blurs the whole image and converts the result to HSV, the conversion is done
+ * once for all the robots searching the whole frame.
+ */
+void FishBotLedsTracking::prepareFullFrame(const cv::Mat& image)
+{
+    prepareArea(image, cv::Rect(cv::Point(0, 0), image.size()));
+    cv::cvtColor(m_blurredImage, m_hsvImage, CV_RGB2HSV);
+}
+
+/*!
+ * Searches for the given robots' leds in their search areas. The robots are
+ * processed in parallel, each with its own binary image, the shared blurred
+ * image is only read. The detection time of every robot is accumulated.
+ */
+void FishBotLedsTracking::detectRobots(const std::vector<size_t>& robotIndices)
+{
+    cv::parallel_for_(cv::Range(0, static_cast<int>(robotIndices.size())),
+                      ParallelLoop([this, &robotIndices](int index)
     {
-        m_maskedImage = m_blurredImage & m_areaRobotMasks[robotIndex];
-    } else {
-        m_blurredImage.copyTo(m_maskedImage);
-    }
+        size_t robotIndex = robotIndices[index];
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+        m_robotsContours[robotIndex] = detectLeds(robotIndex,
+                                                  m_searchAreas.at(robotIndex),
+                                                  m_binaryImages[robotIndex]);
+        std::chrono::duration<double, std::milli> detectionTime = std::chrono::steady_clock::now() - startTime;
+        m_detectionTimesMs[robotIndex] += detectionTime.count();
+    }));
+}
+
+/*!
+ * Searches for the given robot's leds in the given area of the image, returns
+ * the contours of the leds in the image coordinates. The binary image is the
+ * robot's own working buffer.
+*/
+std::vector<std::vector<cv::Point>> FishBotLedsTracking::detectLeds(size_t robotIndex,
+                                                                    cv::Rect area,
+                                                                    cv::Mat& binaryImage)
+{
     // get settings
     int h,s,v;
     m_settingsMutex.lock();
@@ -138,44 +275,54 @@ void FishBotLedsTracking::detectLeds(size_t robotIndex)
     int tolerance = m_settings.robotDescription(robotIndex).colorThreshold;
     m_settingsMutex.unlock();
 
-    // convert to hsv
-    cv::cvtColor(m_maskedImage, m_hsvImage, CV_RGB2HSV);
-    // threshold the image in the HSV color space
-    cv::inRange(m_hsvImage,
-                cv::Scalar(h / 2 - tolerance, 0 , v - 2 * tolerance),
-                cv::Scalar(h / 2 + tolerance, 255, 255),
-                m_binaryImage); //
-
-    // postprocessing of the binary image
-    int an = 1;
-    // TODO : inititialize this in the constructor
-    cv::Mat element = cv::getStructuringElement(cv::MORPH_ELLIPSE,
-                                                cv::Size(an*2+1, an*2+1),
-                                                cv::Point(an, an));
+    // threshold the image in the HSV color space, the robot's mask is
+    // applied if supported
+    const cv::Mat& areaRobotMask = m_areaRobotMasks.at(robotIndex);
+    cv::Mat areaMask;
+    if ((areaRobotMask.data != nullptr) && (areaRobotMask.size() == m_blurredImage.size()))
+        areaMask = areaRobotMask(area);
+    cv::Scalar lowerBound(h / 2 - tolerance, 0 , v - 2 * tolerance);
+    cv::Scalar upperBound(h / 2 + tolerance, 255, 255);
+    if (m_fullFramePrepared && (area.size() == m_hsvImage.size())) {
+        // the whole frame is already converted, only the range is checked
+        cv::inRange(m_hsvImage, lowerBound, upperBound, binaryImage);
+        if (!areaMask.empty())
+            binaryImage.setTo(0, areaMask == 0);
+    } else {
+        HsvThreshold::apply(m_blurredImage(area), areaMask, lowerBound, upperBound, binaryImage);
+    }
 
     //morphological opening (remove small objects from the foreground)
-    cv::erode(m_binaryImage, m_binaryImage, element);
-    cv::dilate(m_binaryImage, m_binaryImage, element);
+    cv::erode(binaryImage, binaryImage, m_morphologyElement);
+    cv::dilate(binaryImage, binaryImage, m_morphologyElement);
 
     //morphological closing (fill small holes in the foreground)
-    cv::dilate(m_binaryImage, m_binaryImage, element);
-    cv::erode(m_binaryImage, m_binaryImage, element);
+    cv::dilate(binaryImage, binaryImage, m_morphologyElement);
+    cv::erode(binaryImage, binaryImage, m_morphologyElement);
 
-    // TODO : make a devoted method
     // detect the leds as contours, normally only two should be found
     std::vector<std::vector<cv::Point>> contours;
     try {
         // TODO : to check if this try-catch can be removed or if it should be
         // used everywhere where opencv methods are used.
-        // retrieve contours from the binary image
-        cv::findContours(m_binaryImage,
+        // retrieve contours from the binary image, shifted to the image
+        // coordinates
+        cv::findContours(binaryImage,
                          contours,
                          cv::RETR_EXTERNAL,
-                         cv::CHAIN_APPROX_SIMPLE);
+                         cv::CHAIN_APPROX_SIMPLE,
+                         area.tl());
     } catch (const cv::Exception& e) {
         qDebug() << "OpenCV exception: " << e.what();
     }
+    return contours;
+}
 
+/*!
+ * Updates the robot's state from its leds' contours.
+ */
+void FishBotLedsTracking::updateRobotState(size_t robotIndex, std::vector<std::vector<cv::Point>>& contours)
+{
     // sort the contours to find two biggest
     // (inspired by http://stackoverflow.com/questions/33401745/find-largest-contours-opencv)
     std::vector<int> indices(contours.size());
@@ -22,6 +22,8 @@ public:
 
     //! Reports on what type of agent can be tracked by this routine.
     virtual QList<AgentType> capabilities() const override;
+    //! Returns true, every robot is identified by its own leds' color.
+    virtual bool keepsAgentsIdentities() const override { return true; }
 
     //! Const getter for the settings.
     const FishBotLedsTrackingSettingsData& settings() const { return m_settings; }
@@ -37,27 +39,49 @@ protected:
 private:
     //! The tracking settings.
     FishBotLedsTrackingSettingsData m_settings;
-    //! Searches for the given robot's leds on the image.
-    void detectLeds(size_t robotIndex);
+    //! Blurs the given area of the image.
+    void prepareArea(const cv::Mat& image, cv::Rect area);
+    //! Blurs the whole image and converts it to HSV.
+    void prepareFullFrame(const cv::Mat& image);
+    //! Searches for the given robots' leds in their search areas in parallel.
+    void detectRobots(const std::vector<size_t>& robotIndices);
+    //! Searches for the given robot's leds in the given area of the image,
+    //! uses the given binary image as the working buffer.
+    std::vector<std::vector<cv::Point>> detectLeds(size_t robotIndex,
+                                                   cv::Rect area,
+                                                   cv::Mat& binaryImage);
+    //! Updates the robot's state from its leds' contours.
+    void updateRobotState(size_t robotIndex, std::vector<std::vector<cv::Point>>& contours);
 
 private:
     //! The intermediate data.
     //! The binary mask image.
     cv::Mat m_maskImage; // TODO : consider moving the mask on the parent's level
-    //! Individual masks for robots.
+    //! Individual masks for robots combined with the arena mask, applied
+    //! during the thresholding.
     QList<cv::Mat> m_areaRobotMasks;
-    //! The image after blurring.
+    //! The image after blurring, shared by all the robots.
     cv::Mat m_blurredImage;
-    //! The image after robot's area mask application.
-    cv::Mat m_maskedImage;
-    //! The image in HSV format.
+    //! The blurred image converted to HSV, it's computed only when the whole
+    //! frame is searched and is shared by all the robots searching it.
     cv::Mat m_hsvImage;
+    //! Defines if the whole frame is blurred and converted to HSV.
+    bool m_fullFramePrepared;
+    //! The areas where the robots are searched on the current frame.
+    QList<cv::Rect> m_searchAreas;
+    //! The structuring element of the morphological operations.
+    cv::Mat m_morphologyElement;
     //! The binary image after the color subtraction.
     cv::Mat m_differenceImage;
     //! The grayscale image.
     cv::Mat m_grayscaleImage;
-    //! The binary image after threshold was applied.
-    cv::Mat m_binaryImage;
+    //! The binary images after threshold was applied, one per robot to
+    //! detect the robots in parallel.
+    std::vector<cv::Mat> m_binaryImages;
+    //! The leds' contours found for every robot on the current frame.
+    std::vector<std::vector<std::vector<cv::Point>>> m_robotsContours;
+    //! The detection time of every robot on the current frame.
+    std::vector<double> m_detectionTimesMs;
     //! The foreground image.
     cv::Mat m_foregroundImage;
 
@@ -0,0 +1,102 @@
+#include "FrameTiling.hpp"
+
+#include <algorithm>
+
+namespace {
+
+/*!
+ * Runs the given function for every index of the range on the OpenCV's
+ * threads pool.
+ */
+class ParallelLoop : public cv::ParallelLoopBody
+{
+public:
+    //! Constructor.
+    explicit ParallelLoop(std::function<void(size_t)> body) : m_body(body) { }
+
+    //! Runs the body for every index of the range.
+    virtual void operator()(const cv::Range& range) const override
+    {
+        for (int index = range.start; index < range.end; ++index)
+            m_body(static_cast<size_t>(index));
+    }
+
+private:
+    //! The function to run.
+    std::function<void(size_t)> m_body;
+};
+
+} // namespace
+
+/*!
+ * Constructor. Makes no tiles.
+ */
+FrameTiling::FrameTiling() :
+    m_imageSize(),
+    m_tiles()
+{
+}
+
+/*!
+ * Constructor. The cores are laid out on the grid of the tile size, the
+ * areas are the cores extended by the overlap and cut by the image borders.
+ * When the tile size is not set or the image is smaller than the tile, the
+ * only tile is the whole image.
+ */
+FrameTiling::FrameTiling(cv::Size imageSize, const TilingDescription& description, int scale) :
+    m_imageSize(imageSize),
+    m_tiles()
+{
+    scale = std::max(scale, 1);
+    int tileSize = description.tileSizePx / scale;
+    int overlap = std::max(description.overlapPx / scale, 0);
+    cv::Rect image(cv::Point(0, 0), imageSize);
+
+    if ((tileSize <= 0) || ((tileSize >= imageSize.width) && (tileSize >= imageSize.height))) {
+        m_tiles.push_back(Tile{image, image});
+        return;
+    }
+
+    for (int y = 0; y < imageSize.height; y += tileSize) {
+        for (int x = 0; x < imageSize.width; x += tileSize) {
+            cv::Rect core = cv::Rect(x, y, tileSize, tileSize) & image;
+            cv::Rect area = cv::Rect(core.x - overlap, core.y - overlap,
+                                     core.width + 2 * overlap, core.height + 2 * overlap) & image;
+            m_tiles.push_back(Tile{area, core});
+        }
+    }
+}
+
+/*!
+ * Runs the function for every tile index on the OpenCV's threads pool.
+ */
+void FrameTiling::forEach(std::function<void(size_t)> function) const
+{
+    if (m_tiles.size() == 1)
+        function(0);
+    else
+        cv::parallel_for_(cv::Range(0, static_cast<int>(m_tiles.size())), ParallelLoop(function));
+}
+
+/*!
+ * Returns true if the detection belongs to the tile: its center is in the
+ * tile's core and it doesn't touch the tile's borders that are inside the
+ * image, the detections cut by these borders are seen entirely by the
+ * neighbouring tile.
+ */
+bool FrameTiling::owns(size_t tileIndex, const cv::Rect& boundingBox, const cv::Point2f& center) const
+{
+    if (tileIndex >= m_tiles.size())
+        return false;
+    const Tile& tile = m_tiles[tileIndex];
+
+    if ((center.x < tile.core.x) || (center.x >= tile.core.x + tile.core.width) ||
+            (center.y < tile.core.y) || (center.y >= tile.core.y + tile.core.height))
+        return false;
+
+    bool cutOnLeft = (tile.area.x > 0) && (boundingBox.x <= tile.area.x);
+    bool cutOnTop = (tile.area.y > 0) && (boundingBox.y <= tile.area.y);
+    bool cutOnRight = (tile.area.br().x < m_imageSize.width) && (boundingBox.br().x >= tile.area.br().x);
+    bool cutOnBottom = (tile.area.br().y < m_imageSize.height) && (boundingBox.br().y >= tile.area.br().y);
+    return !(cutOnLeft || cutOnTop || cutOnRight || cutOnBottom);
+}
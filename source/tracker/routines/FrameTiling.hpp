@@ -0,0 +1,70 @@
+#ifndef CATS2_FRAME_TILING_HPP
+#define CATS2_FRAME_TILING_HPP
+
+#include <opencv2/core/core.hpp>
+
+#include <functional>
+#include <vector>
+
+/*!
+ * \brief The parameters of the tiled processing of the frames.
+ */
+struct TilingDescription
+{
+    //! The side of the tiles in the full resolution pixels; 0 means that the
+    //! frame is processed as a whole.
+    int tileSizePx = 0;
+    //! The margin by which the tiles overlap their neighbours, it must be
+    //! bigger than the agents to have every agent entirely in one tile.
+    int overlapPx = 64;
+};
+
+/*!
+ * \brief Splits the frame into the overlapping tiles that are processed in
+ * parallel. Every tile has a core, the cores cover the frame without
+ * overlapping; a detection belongs to the tile whose core contains its
+ * center, thus the agents seen by several tiles at the seams are kept once.
+ */
+class FrameTiling
+{
+public:
+    //! A tile of the frame.
+    struct Tile
+    {
+        //! The processed area.
+        cv::Rect area;
+        //! The core of the area, the tile's own part of the frame.
+        cv::Rect core;
+    };
+
+public:
+    //! Constructor. Makes no tiles.
+    FrameTiling();
+    //! Constructor. Splits the image of the given size; the image can be
+    //! downscaled by the given factor with respect to the full resolution
+    //! frame.
+    FrameTiling(cv::Size imageSize, const TilingDescription& description, int scale = 1);
+
+public:
+    //! Returns the size of the split image.
+    cv::Size imageSize() const { return m_imageSize; }
+    //! Returns the tiles.
+    const std::vector<Tile>& tiles() const { return m_tiles; }
+    //! Returns the number of tiles.
+    size_t size() const { return m_tiles.size(); }
+
+    //! Runs the function for every tile index on the OpenCV's threads pool.
+    void forEach(std::function<void(size_t)> function) const;
+    //! Returns true if the detection with the given bounding box and center
+    //! belongs to the tile. The detection must be in the tile's area, in the
+    //! image coordinates.
+    bool owns(size_t tileIndex, const cv::Rect& boundingBox, const cv::Point2f& center) const;
+
+private:
+    //! The size of the split image.
+    cv::Size m_imageSize;
+    //! The tiles.
+    std::vector<Tile> m_tiles;
+};
+
+#endif // CATS2_FRAME_TILING_HPP
@@ -0,0 +1,243 @@
+#include "HsvThreshold.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include <QtCore/QDebug>
+
+#include <algorithm>
+
+namespace {
+
+//! The fixed point precision of the OpenCV's 8 bits HSV conversion.
+const int HsvShift = 12;
+
+/*!
+ * The division tables of the OpenCV's 8 bits HSV conversion, they are used to
+ * get exactly the same saturation and hue.
+ */
+struct HsvDivisionTables
+{
+    //! Constructor.
+    HsvDivisionTables()
+    {
+        saturation[0] = 0;
+        hue[0] = 0;
+        for (int i = 1; i < 256; i++) {
+            saturation[i] = cv::saturate_cast<int>((255 << HsvShift) / (1. * i));
+            hue[i] = cv::saturate_cast<int>((180 << HsvShift) / (6. * i));
+        }
+    }
+
+    //! Returns the tables, they are computed once.
+    static const HsvDivisionTables& get()
+    {
+        static const HsvDivisionTables tables;
+        return tables;
+    }
+
+    //! Divides 255 by the value.
+    int saturation[256];
+    //! Divides 30 by the chroma.
+    int hue[256];
+};
+
+/*!
+ * Thresholds the rows of the RGB image in the HSV color space.
+ */
+class HsvThresholdBody : public cv::ParallelLoopBody
+{
+public:
+    //! Constructor.
+    HsvThresholdBody(const cv::Mat& rgbImage,
+                     const cv::Mat& mask,
+                     const int lowerBound[3],
+                     const int upperBound[3],
+                     cv::Mat& binaryImage) :
+        m_rgbImage(rgbImage),
+        m_mask(mask),
+        m_binaryImage(binaryImage),
+        m_tables(HsvDivisionTables::get())
+    {
+        for (int channel = 0; channel < 3; channel++) {
+            m_lowerBound[channel] = lowerBound[channel];
+            m_upperBound[channel] = upperBound[channel];
+        }
+    }
+
+    //! Processes the rows of the range.
+    virtual void operator()(const cv::Range& rows) const override
+    {
+        for (int row = rows.start; row < rows.end; row++) {
+            const uchar* source = m_rgbImage.ptr<uchar>(row);
+            const uchar* mask = m_mask.empty() ? nullptr : m_mask.ptr<uchar>(row);
+            uchar* destination = m_binaryImage.ptr<uchar>(row);
+            int column = 0;
+#if CV_SIMD128
+            column = processVectors(source, mask, destination);
+#endif
+            for (; column < m_rgbImage.cols; column++) {
+                bool inside = isInside(source[3 * column], source[3 * column + 1], source[3 * column + 2]);
+                if (mask && !mask[column])
+                    inside = false;
+                destination[column] = inside ? 255 : 0;
+            }
+        }
+    }
+
+private:
+    /*!
+     * Converts the pixel to HSV and checks if it's within the bounds. The
+     * conversion is the one of cv::cvtColor.
+     */
+    bool isInside(int r, int g, int b) const
+    {
+        int v = std::max(r, std::max(g, b));
+        int diff = v - std::min(r, std::min(g, b));
+        int vr = (v == r) ? -1 : 0;
+        int vg = (v == g) ? -1 : 0;
+
+        int s = (diff * m_tables.saturation[v] + (1 << (HsvShift - 1))) >> HsvShift;
+        int h = (vr & (g - b)) + (~vr & ((vg & (b - r + 2 * diff)) + ((~vg) & (r - g + 4 * diff))));
+        h = (h * m_tables.hue[diff] + (1 << (HsvShift - 1))) >> HsvShift;
+        h += (h < 0) ? 180 : 0;
+
+        return (h >= m_lowerBound[0]) && (h <= m_upperBound[0]) &&
+                (s >= m_lowerBound[1]) && (s <= m_upperBound[1]) &&
+                (v >= m_lowerBound[2]) && (v <= m_upperBound[2]);
+    }
+
+#if CV_SIMD128
+    /*!
+     * Processes the row by 16 pixels, returns the index of the first pixel
+     * that is left. The arithmetic is the same as in isInside, the division
+     * tables are read for every pixel and loaded to the vectors.
+     */
+    int processVectors(const uchar* source, const uchar* mask, uchar* destination) const
+    {
+        const int VectorSize = 16;
+        const cv::v_int32x4 half = cv::v_setall_s32(1 << (HsvShift - 1));
+        const cv::v_int32x4 hueRange = cv::v_setall_s32(180);
+        const cv::v_int32x4 lowerBound[3] = {cv::v_setall_s32(m_lowerBound[0]),
+                                             cv::v_setall_s32(m_lowerBound[1]),
+                                             cv::v_setall_s32(m_lowerBound[2])};
+        const cv::v_int32x4 upperBound[3] = {cv::v_setall_s32(m_upperBound[0]),
+                                             cv::v_setall_s32(m_upperBound[1]),
+                                             cv::v_setall_s32(m_upperBound[2])};
+
+        int column = 0;
+        for (; column <= m_rgbImage.cols - VectorSize; column += VectorSize) {
+            cv::v_uint8x16 r8, g8, b8;
+            cv::v_load_deinterleave(source + 3 * column, r8, g8, b8);
+            cv::v_uint8x16 v8 = cv::v_max(r8, cv::v_max(g8, b8));
+            cv::v_uint8x16 diff8 = v8 - cv::v_min(r8, cv::v_min(g8, b8));
+
+            // get the divisions from the tables
+            uchar values[VectorSize];
+            uchar diffs[VectorSize];
+            cv::v_store(values, v8);
+            cv::v_store(diffs, diff8);
+            int saturationDivisions[VectorSize];
+            int hueDivisions[VectorSize];
+            for (int i = 0; i < VectorSize; i++) {
+                saturationDivisions[i] = m_tables.saturation[values[i]];
+                hueDivisions[i] = m_tables.hue[diffs[i]];
+            }
+
+            cv::v_int32x4 r[4], g[4], b[4], v[4], diff[4];
+            expand(r8, r);
+            expand(g8, g);
+            expand(b8, b);
+            expand(v8, v);
+            expand(diff8, diff);
+
+            cv::v_int32x4 inside[4];
+            for (int quarter = 0; quarter < 4; quarter++) {
+                cv::v_int32x4 vr = (v[quarter] == r[quarter]);
+                cv::v_int32x4 vg = (v[quarter] == g[quarter]);
+
+                cv::v_int32x4 s = (diff[quarter] * cv::v_load(saturationDivisions + 4 * quarter) + half) >> HsvShift;
+                cv::v_int32x4 h = (vr & (g[quarter] - b[quarter])) +
+                        (~vr & ((vg & (b[quarter] - r[quarter] + (diff[quarter] << 1))) +
+                                (~vg & (r[quarter] - g[quarter] + (diff[quarter] << 2)))));
+                h = (h * cv::v_load(hueDivisions + 4 * quarter) + half) >> HsvShift;
+                h = h + ((h < cv::v_setzero_s32()) & hueRange);
+
+                inside[quarter] = (h >= lowerBound[0]) & (h <= upperBound[0]) &
+                        (s >= lowerBound[1]) & (s <= upperBound[1]) &
+                        (v[quarter] >= lowerBound[2]) & (v[quarter] <= upperBound[2]);
+            }
+
+            // the masks are -1 or 0, they are packed to 255 or 0
+            cv::v_uint8x16 result = cv::v_reinterpret_as_u8(cv::v_pack(cv::v_pack(inside[0], inside[1]),
+                                                                       cv::v_pack(inside[2], inside[3])));
+            if (mask)
+                result = result & (cv::v_load(mask + column) != cv::v_setzero_u8());
+            cv::v_store(destination + column, result);
+        }
+        return column;
+    }
+
+    /*!
+     * Expands the 16 bytes to 4 vectors of 32 bits integers.
+     */
+    static void expand(const cv::v_uint8x16& bytes, cv::v_int32x4 integers[4])
+    {
+        cv::v_uint16x8 low, high;
+        cv::v_expand(bytes, low, high);
+        cv::v_uint32x4 quarters[4];
+        cv::v_expand(low, quarters[0], quarters[1]);
+        cv::v_expand(high, quarters[2], quarters[3]);
+        for (int quarter = 0; quarter < 4; quarter++)
+            integers[quarter] = cv::v_reinterpret_as_s32(quarters[quarter]);
+    }
+#endif
+
+private:
+    //! The image to threshold.
+    const cv::Mat& m_rgbImage;
+    //! The optional mask.
+    const cv::Mat& m_mask;
+    //! The resulting binary image.
+    cv::Mat& m_binaryImage;
+    //! The division tables.
+    const HsvDivisionTables& m_tables;
+    //! The lower bounds of h, s and v.
+    int m_lowerBound[3];
+    //! The upper bounds of h, s and v.
+    int m_upperBound[3];
+};
+
+} // namespace
+
+/*!
+ * Thresholds the RGB image in the HSV color space. The bounds are rounded
+ * inwards to integers, the integer bounds give the same result as cv::inRange.
+ * The rows are processed in parallel.
+ */
+void HsvThreshold::apply(const cv::Mat& rgbImage,
+                         const cv::Mat& mask,
+                         cv::Scalar lowerBound,
+                         cv::Scalar upperBound,
+                         cv::Mat& binaryImage)
+{
+    if (rgbImage.type() != CV_8UC3) {
+        qDebug() << "Unsupported image format" << rgbImage.type();
+        return;
+    }
+    // NOTE : the callers check their masks once when loaded, an incompatible
+    // mask is ignored here silently to not flood the log every frame
+    cv::Mat validMask;
+    if (!mask.empty() && (mask.type() == CV_8UC1) && (mask.size() == rgbImage.size()))
+        validMask = mask;
+
+    int lower[3];
+    int upper[3];
+    for (int channel = 0; channel < 3; channel++) {
+        lower[channel] = cvCeil(lowerBound[channel]);
+        upper[channel] = cvFloor(upperBound[channel]);
+    }
+
+    binaryImage.create(rgbImage.size(), CV_8UC1);
+    cv::parallel_for_(cv::Range(0, rgbImage.rows),
+                      HsvThresholdBody(rgbImage, validMask, lower, upper, binaryImage));
+}
@@ -0,0 +1,28 @@
+#ifndef CATS2_HSV_THRESHOLD_HPP
+#define CATS2_HSV_THRESHOLD_HPP
+
+#include <opencv2/core/core.hpp>
+
+/*!
+ * \brief Thresholds the RGB images in the HSV color space in one pass. It
+ * gives the same result as cv::cvtColor(CV_RGB2HSV) followed by cv::inRange
+ * and an AND with a mask, but every pixel is converted and tested in
+ * registers, without the intermediate images. The pixels are processed by
+ * 16 with the OpenCV's universal intrinsics when they are available, and the
+ * rows are split between the OpenCV's threads.
+ */
+class HsvThreshold
+{
+public:
+    //! Thresholds the RGB image, the bounds are inclusive and follow the
+    //! OpenCV's 8 bits HSV ranges (the hue is in [0, 180)). The optional
+    //! single channel mask of the image's size excludes its zero pixels, the
+    //! mask of another size or type is ignored.
+    static void apply(const cv::Mat& rgbImage,
+                      const cv::Mat& mask,
+                      cv::Scalar lowerBound,
+                      cv::Scalar upperBound,
+                      cv::Mat& binaryImage);
+};
+
+#endif // CATS2_HSV_THRESHOLD_HPP
@@ -0,0 +1,145 @@
+#include "MotionPredictor.hpp"
+
+#include <algorithm>
+
+/*!
+ * Constructor.
+ */
+MotionPredictor::MotionPredictor(double accelerationNoisePxPerSec2, double measurementNoisePx) :
+    m_filter(4, 2, 0, CV_32F),
+    m_accelerationNoise(accelerationNoisePxPerSec2),
+    m_initialized(false),
+    m_predicted(false),
+    m_predictedState(),
+    m_orientation(0, false),
+    m_missedFrames(0)
+{
+    cv::setIdentity(m_filter.transitionMatrix);
+    m_filter.measurementMatrix = cv::Mat::zeros(2, 4, CV_32F);
+    m_filter.measurementMatrix.at<float>(0, 0) = 1;
+    m_filter.measurementMatrix.at<float>(1, 1) = 1;
+    cv::setIdentity(m_filter.measurementNoiseCov, cv::Scalar::all(measurementNoisePx * measurementNoisePx));
+}
+
+/*!
+ * Copy constructor. The cv::KalmanFilter's copy shares the matrices with the
+ * original, hence they are cloned.
+ */
+MotionPredictor::MotionPredictor(const MotionPredictor& other) :
+    m_accelerationNoise(other.m_accelerationNoise),
+    m_initialized(other.m_initialized),
+    m_predicted(other.m_predicted),
+    m_predictedState(other.m_predictedState),
+    m_orientation(other.m_orientation),
+    m_missedFrames(other.m_missedFrames)
+{
+    copyFilter(other.m_filter, m_filter);
+}
+
+/*!
+ * Copy operator. The filter's matrices are cloned.
+ */
+MotionPredictor& MotionPredictor::operator=(const MotionPredictor& other)
+{
+    if (this != &other) {
+        copyFilter(other.m_filter, m_filter);
+        m_accelerationNoise = other.m_accelerationNoise;
+        m_initialized = other.m_initialized;
+        m_predicted = other.m_predicted;
+        m_predictedState = other.m_predictedState;
+        m_orientation = other.m_orientation;
+        m_missedFrames = other.m_missedFrames;
+    }
+    return *this;
+}
+
+/*!
+ * Copies the filter with its matrices cloned.
+ */
+void MotionPredictor::copyFilter(const cv::KalmanFilter& source, cv::KalmanFilter& destination)
+{
+    destination.statePre = source.statePre.clone();
+    destination.statePost = source.statePost.clone();
+    destination.transitionMatrix = source.transitionMatrix.clone();
+    destination.controlMatrix = source.controlMatrix.clone();
+    destination.measurementMatrix = source.measurementMatrix.clone();
+    destination.processNoiseCov = source.processNoiseCov.clone();
+    destination.measurementNoiseCov = source.measurementNoiseCov.clone();
+    destination.errorCovPre = source.errorCovPre.clone();
+    destination.gain = source.gain.clone();
+    destination.errorCovPost = source.errorCovPost.clone();
+    destination.temp1 = source.temp1.clone();
+    destination.temp2 = source.temp2.clone();
+    destination.temp3 = source.temp3.clone();
+    destination.temp4 = source.temp4.clone();
+    destination.temp5 = source.temp5.clone();
+}
+
+/*!
+ * Forgets the agent's state.
+ */
+void MotionPredictor::reset()
+{
+    m_initialized = false;
+    m_predicted = false;
+    m_predictedState = StateImage();
+    m_orientation = OrientationRad(0, false);
+    m_missedFrames = 0;
+}
+
+/*!
+ * Predicts the agent's state after the given time interval. The process noise
+ * is the one of the random acceleration during this interval.
+ */
+void MotionPredictor::predict(double dtSec)
+{
+    if (!m_initialized)
+        return;
+
+    float dt = static_cast<float>(std::max(dtSec, 0.));
+    m_filter.transitionMatrix.at<float>(0, 2) = dt;
+    m_filter.transitionMatrix.at<float>(1, 3) = dt;
+
+    float variance = static_cast<float>(m_accelerationNoise * m_accelerationNoise);
+    float dt2 = dt * dt;
+    float dt3 = dt2 * dt;
+    float dt4 = dt3 * dt;
+    m_filter.processNoiseCov = (cv::Mat_<float>(4, 4) <<
+                                dt4 / 4, 0, dt3 / 2, 0,
+                                0, dt4 / 4, 0, dt3 / 2,
+                                dt3 / 2, 0, dt2, 0,
+                                0, dt3 / 2, 0, dt2) * variance;
+
+    const cv::Mat& state = m_filter.predict();
+    m_predictedState.setPosition(cv::Point2f(state.at<float>(0), state.at<float>(1)));
+    m_predictedState.setOrientation(m_orientation);
+    m_predicted = true;
+}
+
+/*!
+ * Updates the state with the measured position and orientation. The first
+ * measurement initializes the filter with the zero velocity.
+ */
+void MotionPredictor::correct(const StateImage& measuredState)
+{
+    if (!measuredState.position().isValid())
+        return;
+
+    cv::Point2f position = measuredState.position().toCvPoint2f();
+    if (!m_initialized || !m_predicted) {
+        m_filter.statePost = (cv::Mat_<float>(4, 1) << position.x, position.y, 0, 0);
+        // the velocity is unknown, it's considered to be reached with the
+        // typical acceleration in a second
+        cv::setIdentity(m_filter.errorCovPost, cv::Scalar::all(m_accelerationNoise * m_accelerationNoise));
+        m_filter.errorCovPost.at<float>(0, 0) = m_filter.measurementNoiseCov.at<float>(0, 0);
+        m_filter.errorCovPost.at<float>(1, 1) = m_filter.measurementNoiseCov.at<float>(1, 1);
+        m_initialized = true;
+    } else {
+        m_filter.correct((cv::Mat_<float>(2, 1) << position.x, position.y));
+    }
+
+    if (measuredState.orientation().isValid())
+        m_orientation = measuredState.orientation();
+    m_predicted = false;
+    m_missedFrames = 0;
+}
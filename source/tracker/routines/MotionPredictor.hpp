@@ -0,0 +1,66 @@
+#ifndef CATS2_MOTION_PREDICTOR_HPP
+#define CATS2_MOTION_PREDICTOR_HPP
+
+#include <AgentState.hpp>
+
+#include <opencv2/video/tracking.hpp>
+
+/*!
+ * \brief Predicts the agent's state on the next frame. The position and the
+ * velocity are estimated by the Kalman filter with the constant velocity
+ * model, the heading is the last measured orientation.
+ */
+class MotionPredictor
+{
+public:
+    //! Constructor. Gets the standard deviation of the acceleration that
+    //! models the agent's maneuvers and of the position measurement.
+    explicit MotionPredictor(double accelerationNoisePxPerSec2 = 500, double measurementNoisePx = 2);
+    //! Copy constructor. The filter's matrices are cloned, the copies never
+    //! share their state.
+    MotionPredictor(const MotionPredictor& other);
+    //! Copy operator. The filter's matrices are cloned.
+    MotionPredictor& operator=(const MotionPredictor& other);
+
+public:
+    //! Returns true if the predictor has the agent's state.
+    bool isInitialized() const { return m_initialized; }
+    //! Forgets the agent's state.
+    void reset();
+
+    //! Predicts the agent's state after the given time interval.
+    void predict(double dtSec);
+    //! Updates the state with the measured position and orientation.
+    void correct(const StateImage& measuredState);
+
+    //! Returns the predicted state.
+    StateImage predictedState() const { return m_predictedState; }
+    //! Returns the number of the consecutive frames with the state predicted
+    //! but not measured.
+    int missedFrames() const { return m_missedFrames; }
+    //! Registers the frame where the agent was not detected.
+    void onMissed() { ++m_missedFrames; }
+
+private:
+    //! Copies the filter with its matrices cloned.
+    static void copyFilter(const cv::KalmanFilter& source, cv::KalmanFilter& destination);
+
+private:
+    //! The Kalman filter, the state is [x, y, vx, vy], the measurement is
+    //! [x, y].
+    cv::KalmanFilter m_filter;
+    //! The standard deviation of the acceleration.
+    double m_accelerationNoise;
+    //! Defines if the filter's state is initialized.
+    bool m_initialized;
+    //! Defines if the prediction was done since the last correction.
+    bool m_predicted;
+    //! The predicted state.
+    StateImage m_predictedState;
+    //! The last measured orientation.
+    OrientationRad m_orientation;
+    //! The number of the consecutive frames with the agent not detected.
+    int m_missedFrames;
+};
+
+#endif // CATS2_MOTION_PREDICTOR_HPP
@@ -0,0 +1,30 @@
+#ifndef CATS2_PREPARED_FRAME_QUEUE_HPP
+#define CATS2_PREPARED_FRAME_QUEUE_HPP
+
+#include "StageQueue.hpp"
+
+#include <TimestampedFrame.hpp>
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+
+/*!
+ * \brief The frame with the images prepared for the detection by the tracking
+ * routine's preprocessing stage.
+ */
+struct PreparedFrame
+{
+    //! The original frame.
+    TimestampedFrame frame;
+    //! The prepared images, their meaning is defined by the routine.
+    std::vector<cv::Mat> images;
+    //! The duration of the preprocessing.
+    double preprocessingMs = 0;
+};
+
+//! The bounded hand-off buffer between the tracking routine's preprocessing
+//! and detection stages.
+using PreparedFrameQueue = StageQueue<PreparedFrame>;
+
+#endif // CATS2_PREPARED_FRAME_QUEUE_HPP
@@ -0,0 +1,87 @@
+#ifndef CATS2_STAGE_QUEUE_HPP
+#define CATS2_STAGE_QUEUE_HPP
+
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QWaitCondition>
+
+#include <algorithm>
+#include <deque>
+
+/*!
+ * \brief The bounded hand-off buffer between two stages of the pipelined
+ * tracking. It has one producer and one consumer thread, the data are never
+ * dropped and leave the buffer in the order they entered it; the producer
+ * waits when the buffer is full.
+ */
+template <typename Data>
+class StageQueue
+{
+public:
+    //! Constructor. Gets the maximal number of the data in the buffer.
+    explicit StageQueue(size_t maxSize) :
+        m_data(),
+        m_maxSize(std::max<size_t>(maxSize, 1))
+    {
+    }
+
+public:
+    //! Adds the data, waits while the buffer is full. Returns false if the
+    //! data could not be added during the time out. Called by the producer.
+    bool enqueue(const Data& data)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_data.size() >= m_maxSize) {
+            m_notFull.wait(&m_mutex, TimeOutMs);
+            if (m_data.size() >= m_maxSize)
+                return false;
+        }
+        m_data.push_back(data);
+        m_notEmpty.wakeOne();
+        return true;
+    }
+
+    //! Gets the oldest data, waits while the buffer is empty. Returns false
+    //! if no data came during the time out. Called by the consumer.
+    bool dequeue(Data& data)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_data.empty()) {
+            m_notEmpty.wait(&m_mutex, TimeOutMs);
+            if (m_data.empty())
+                return false;
+        }
+        data = m_data.front();
+        m_data.pop_front();
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    //! Drops all the data.
+    void empty()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_data.clear();
+        m_notFull.wakeOne();
+    }
+
+private:
+    //! The data.
+    std::deque<Data> m_data;
+    //! The maximal number of the data in the buffer.
+    const size_t m_maxSize;
+    //! Protects the data.
+    QMutex m_mutex;
+    //! Used to wake up the consumer waiting for the data.
+    QWaitCondition m_notEmpty;
+    //! Used to wake up the producer waiting for a free place.
+    QWaitCondition m_notFull;
+
+    //! The waiting time out, the threads check if they are stopped after it.
+    static constexpr unsigned long TimeOutMs = 100;  // [ms]
+};
+
+template <typename Data>
+constexpr unsigned long StageQueue<Data>::TimeOutMs;
+
+#endif // CATS2_STAGE_QUEUE_HPP
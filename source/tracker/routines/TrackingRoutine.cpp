@@ -1,6 +1,9 @@
 #include "TrackingRoutine.hpp"
 
 #include <TimestampedFrame.hpp>
+#include <TimestampClock.hpp>
+#include <AssignmentSolver.hpp>
+#include <MetricsRegistry.hpp>
 #include "settings/TrackingRoutineSettings.hpp"
 
 #include <opencv2/highgui.hpp>
@@ -9,6 +12,11 @@
 
 #include <QtMath>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
 /*!
 * Constructor.
 */
@@ -16,7 +24,12 @@ TrackingRoutine::TrackingRoutine(TimestampedFrameQueuePtr inputQueue, Timestampe
     QObject(),
     m_inputQueue(inputQueue),
     m_debugQueue(debugQueue),
+    m_currentTimestamp(0),
+    m_previousTimestamp(0),
     m_stopped(false),
+    m_inputFinished(false),
+    m_preprocessingFinished(false),
+    m_detectionFinished(false),
     m_enqueueDebugFrames(false)
 {
 }
@@ -30,30 +43,171 @@ TrackingRoutine::~TrackingRoutine()
 }
 
 /*!
- * Starts the tracking.
+ * Starts the tracking. When the tracking is pipelined, the frames are
+ * preprocessed and the results are sent out in separate threads, the stages
+ * are linked by the bounded buffers, thus the next frame is prepared and the
+ * previous results are sent while the current frame is tracked; the frames'
+ * order is preserved. When the input is finished, the tracking stops as soon
+ * as the remaining frames are tracked and their results are sent.
  */
 void TrackingRoutine::process()
 {
     m_stopped = false;
+    m_inputFinished = false;
+    m_preprocessingFinished = false;
+    m_detectionFinished = false;
+    bool streamOver = false;
+    if (m_pipeline.enabled) {
+        size_t bufferSize = static_cast<size_t>(std::max(m_pipeline.bufferFrames, 1));
+        m_preparedFrames.reset(new PreparedFrameQueue(bufferSize));
+        m_agentsToPublish.reset(new StageQueue<TimestampedImageAgentsData>(bufferSize));
+        std::thread preprocessingThread(&TrackingRoutine::runPreprocessing, this);
+        std::thread publishingThread(&TrackingRoutine::runPublishing, this);
+        PreparedFrame preparedFrame;
+        while (!m_stopped) {
+            // NOTE : the flag is read before the buffer so that the last
+            // frames are not missed
+            bool preprocessingFinished = m_preprocessingFinished;
+            if (m_preparedFrames->dequeue(preparedFrame)) {
+                track(preparedFrame);
+            } else if (preprocessingFinished) {
+                streamOver = true;
+                break;
+            }
+        }
+        // the publishing stage sends the remaining results before stopping
+        m_detectionFinished = true;
+        preprocessingThread.join();
+        publishingThread.join();
+        m_preparedFrames->empty();
+        m_agentsToPublish->empty();
+    } else {
+        m_agentsToPublish.reset();
+        TimestampedFrame frame;
+        while (!m_stopped) {
+            bool inputFinished = m_inputFinished;
+            if (m_inputQueue->dequeue(frame)) {
+                track(prepareFrame(frame));
+            } else if (inputFinished) {
+                streamOver = true;
+                break;
+            }
+        }
+    }
+    if (streamOver)
+        emit streamProcessed();
+    emit finished();
+}
+
+/*!
+ * Runs the preprocessing stage of the pipelined tracking: the frames are
+ * taken from the input queue, prepared and passed to the detection stage,
+ * waiting for it when its buffer is full.
+ */
+void TrackingRoutine::runPreprocessing()
+{
     TimestampedFrame frame;
     while (!m_stopped) {
+        bool inputFinished = m_inputFinished;
         if (m_inputQueue->dequeue(frame)) {
-            m_currentTimestamp = frame.timestamp();
-            invalidateAgentsState();
-            // NOTE : OpenCV throws exceptions, so we need to be ready
-            try {
-                doTracking(frame);
-            } catch (const cv::Exception& e) {
-                qDebug() << "OpenCV exception: " << e.what();
-            }
-            // send the results
-            TimestampedImageAgentsData timestampedAgentsData;
-            timestampedAgentsData.agentsData = m_agents;
-            timestampedAgentsData.timestamp = m_currentTimestamp;
-            emit trackedAgents(timestampedAgentsData);
+            PreparedFrame preparedFrame = prepareFrame(frame);
+            while (!m_stopped && !m_preparedFrames->enqueue(preparedFrame)) { }
+        } else if (inputFinished) {
+            m_preprocessingFinished = true;
+            break;
         }
     }
-    emit finished();
+}
+
+/*!
+ * Runs the publishing stage of the pipelined tracking: the tracked agents are
+ * taken from the buffer and sent out, hence the coordinates conversion done by
+ * the receivers doesn't delay the detection of the next frame.
+ */
+void TrackingRoutine::runPublishing()
+{
+    TimestampedImageAgentsData agentsData;
+    while (!m_stopped) {
+        bool detectionFinished = m_detectionFinished;
+        if (m_agentsToPublish->dequeue(agentsData))
+            publish(agentsData);
+        else if (detectionFinished)
+            break;
+    }
+}
+
+/*!
+ * Runs the preprocessing of the frame, measures its duration.
+ */
+PreparedFrame TrackingRoutine::prepareFrame(const TimestampedFrame& frame)
+{
+    PreparedFrame preparedFrame;
+    preparedFrame.frame = frame;
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    // NOTE : OpenCV throws exceptions, so we need to be ready
+    try {
+        preprocess(frame, preparedFrame.images);
+    } catch (const cv::Exception& e) {
+        qDebug() << "OpenCV exception: " << e.what();
+        preparedFrame.images.clear();
+    }
+    std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - startTime;
+    preparedFrame.preprocessingMs = duration.count();
+    return preparedFrame;
+}
+
+/*!
+ * Tracks the agents on the prepared frame and passes the results to the
+ * publishing stage, or sends them right away if the tracking is not pipelined.
+ * The durations of the preprocessing and the detection are reported to the
+ * metrics registry.
+ */
+void TrackingRoutine::track(const PreparedFrame& preparedFrame)
+{
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    m_preparedImages = preparedFrame.images;
+    m_previousTimestamp = m_currentTimestamp;
+    m_currentTimestamp = preparedFrame.frame.timestamp();
+    invalidateAgentsState();
+    // NOTE : OpenCV throws exceptions, so we need to be ready
+    try {
+        doTracking(preparedFrame.frame);
+    } catch (const cv::Exception& e) {
+        qDebug() << "OpenCV exception: " << e.what();
+    }
+    updateMotionPredictions();
+    // release the prepared images
+    m_preparedImages.clear();
+
+    if (!m_metricsPrefix.isEmpty()) {
+        std::chrono::duration<double, std::milli> detectionDuration = std::chrono::steady_clock::now() - startTime;
+        MetricsRegistry::get().setValue(QString("%1/preprocessingMs").arg(m_metricsPrefix), preparedFrame.preprocessingMs);
+        MetricsRegistry::get().setValue(QString("%1/detectionMs").arg(m_metricsPrefix), detectionDuration.count());
+    }
+
+    // send the results
+    TimestampedImageAgentsData timestampedAgentsData;
+    timestampedAgentsData.agentsData = m_agents;
+    timestampedAgentsData.timestamp = m_currentTimestamp;
+    if (!m_agentsToPublish.isNull()) {
+        while (!m_stopped && !m_agentsToPublish->enqueue(timestampedAgentsData)) { }
+    } else {
+        publish(timestampedAgentsData);
+    }
+}
+
+/*!
+ * Sends out the tracked agents, the duration is reported to the metrics
+ * registry.
+ */
+void TrackingRoutine::publish(const TimestampedImageAgentsData& agentsData)
+{
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    emit trackedAgents(agentsData);
+    if (!m_metricsPrefix.isEmpty()) {
+        std::chrono::duration<double, std::milli> publishingDuration = std::chrono::steady_clock::now() - startTime;
+        MetricsRegistry::get().setValue(QString("%1/publishingMs").arg(m_metricsPrefix), publishingDuration.count());
+    }
 }
 
 /*!
@@ -64,6 +218,32 @@ void TrackingRoutine::stop()
     m_stopped = true;
 }
 
+/*!
+ * Stops the tracking once the frames waiting in the input queue are tracked.
+ * Called at the end of the stream, it only sets the flag and thus can be
+ * called from any thread.
+ */
+void TrackingRoutine::finish()
+{
+    m_inputFinished = true;
+}
+
+/*!
+ * Sets the parameters of the motion prediction. Every agent has its own
+ * predictor, found by the agent's index, hence the prediction is enabled only
+ * when the routine keeps the agents' identities; otherwise a predictor would
+ * mix the tracks of different agents.
+ */
+void TrackingRoutine::setMotionPrediction(MotionPredictionDescription motionPrediction)
+{
+    m_motionPrediction = motionPrediction;
+    if (m_motionPrediction.enabled && !keepsAgentsIdentities()) {
+        qDebug() << "The motion prediction is disabled, the tracking routine does not keep the agents' identities";
+        m_motionPrediction.enabled = false;
+    }
+    m_motionPredictors.clear();
+}
+
 /*!
  * Starts/stops to enqueue the debug images to the debug queue.
  */
@@ -77,6 +257,26 @@ void TrackingRoutine::onSendDebugImages(bool send)
     }
 }
 
+/*!
+ * Prepares the images for the detection. Does nothing by default, the
+ * routines do all the processing in doTracking.
+ */
+void TrackingRoutine::preprocess(const TimestampedFrame& /*frame*/, std::vector<cv::Mat>& preparedImages)
+{
+    preparedImages.clear();
+}
+
+/*!
+ * Returns the image prepared for the current frame by preprocess.
+ */
+const cv::Mat& TrackingRoutine::preparedImage(size_t index) const
+{
+    static const cv::Mat noImage;
+    if (index < m_preparedImages.size())
+        return m_preparedImages[index];
+    return noImage;
+}
+
 /*!
  * Puts an image to the debug queue if the corresponding flag is active.
  */
@@ -88,8 +288,7 @@ void TrackingRoutine::enqueueDebugImage(const cv::Mat& image)
         image.copyTo(debugImage);
 
         // and push it to the queue
-        std::chrono::milliseconds ms(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()));
-        TimestampedFrame frame(debugImage, ms);
+        TimestampedFrame frame(debugImage, TimestampClock::now());
         m_debugQueue->enqueue(frame);
     }
 }
@@ -101,19 +300,74 @@ void TrackingRoutine::enqueueDebugImage(const cv::Mat& image)
  */
 void TrackingRoutine::invalidateAgentsState()
 {
-    for (auto& agent : m_agents)
+    if (m_motionPrediction.enabled) {
+        // every agent gets its own filter
+        if (m_motionPredictors.size() != static_cast<size_t>(m_agents.size())) {
+            m_motionPredictors.clear();
+            m_motionPredictors.reserve(m_agents.size());
+            for (int index = 0; index < m_agents.size(); ++index)
+                m_motionPredictors.emplace_back(m_motionPrediction.accelerationNoisePxPerSec2,
+                                                m_motionPrediction.measurementNoisePx);
+        }
+
+        std::chrono::duration<double> dt = m_currentTimestamp - m_previousTimestamp;
+        for (int index = 0; index < m_agents.size(); ++index) {
+            MotionPredictor& predictor = m_motionPredictors[index];
+            if (predictor.isInitialized()) {
+                predictor.predict(dt.count());
+                m_agents[index].mutableState()->setPosition(predictor.predictedState().position());
+            }
+        }
+    }
+
+    m_previousAgentsStates.clear();
+    for (auto& agent : m_agents) {
+        m_previousAgentsStates.append(agent.state());
         agent.mutableState()->invalidateState();
+    }
+}
+
+/*!
+ * Updates the motion predictions with the detected agents. The agents that
+ * are not detected take the predicted positions during the coasting period,
+ * then their predictions are reset. The heading is not predicted: the fish
+ * and the robots turn on the spot, so the velocity's direction says little
+ * about it, and a coasting agent keeps its last measured orientation.
+ */
+void TrackingRoutine::updateMotionPredictions()
+{
+    if (!m_motionPrediction.enabled)
+        return;
+
+    for (int index = 0; (index < m_agents.size()) && (static_cast<size_t>(index) < m_motionPredictors.size()); ++index) {
+        MotionPredictor& predictor = m_motionPredictors[index];
+        AgentDataImage& agent = m_agents[index];
+        if (agent.state().position().isValid()) {
+            predictor.correct(agent.state());
+        } else if (predictor.isInitialized()) {
+            if (predictor.missedFrames() < m_motionPrediction.maxCoastingFrames) {
+                predictor.onMissed();
+                agent.mutableState()->setPosition(predictor.predictedState().position());
+                agent.mutableState()->setOrientation(predictor.predictedState().orientation());
+            } else {
+                predictor.reset();
+            }
+        }
+    }
 }
 
 /*!
  * Assign detected objects to ids.
  */
-void TrackingRoutine::assingIds(IdsAssignmentMethod method, std::vector<cv::Point2f>& centers, std::vector<float> directions)
+void TrackingRoutine::assingIds(const IdsAssignmentDescription& parameters, std::vector<cv::Point2f>& centers, std::vector<float> directions)
 {
-    switch (method) {
+    switch (parameters.method) {
     case IdsAssignmentMethod::NAIVE_CLOSEST_NEIGHBOUR:
         naiveClosestNeighbour(centers, directions);
         break;
+    case IdsAssignmentMethod::HUNGARIAN:
+        hungarianAssignment(parameters, centers, directions);
+        break;
     default:
         naiveClosestNeighbour(centers, directions);
         break;
@@ -148,15 +402,7 @@ void TrackingRoutine::naiveClosestNeighbour(std::vector<cv::Point2f>& centers, s
 
         // update the position of the agent if it's detected
         if (detected) {
-            AgentDataImage& agent = m_agents[agentIndex];
-            if (directions.size() > 0) {
-                agent.mutableState()->setPosition(centers[i]);
-                agent.mutableState()->setOrientation(directions[i]);
-            }
-            else {
-                agent.mutableState()->setPosition(centers[i]);
-                agent.mutableState()->invalidateOrientation();
-            }
+            setAgentState(m_agents[agentIndex], centers[i], directions, i);
 
             // remove this agent's index from the list
             remainingAgents.erase(std::remove(remainingAgents.begin(), remainingAgents.end(), agentIndex), remainingAgents.end()); // https://en.wikipedia.org/wiki/Erase–remove_idiom
@@ -164,6 +410,101 @@ void TrackingRoutine::naiveClosestNeighbour(std::vector<cv::Point2f>& centers, s
     }
 }
 
+/*!
+ * Assigns the detected objects to ids so that the total displacement of the
+ * agents is minimal. The agents that were not detected on the previous frame
+ * can take any object, but they get only the objects that are not claimed by
+ * the tracked agents. The assignments farther than the maximal displacement,
+ * or with the orientation changed more than allowed, are forbidden.
+ */
+void TrackingRoutine::hungarianAssignment(const IdsAssignmentDescription& parameters, std::vector<cv::Point2f>& centers, std::vector<float> directions)
+{
+    int numberOfAgents = qMin(m_agents.size(), m_previousAgentsStates.size());
+    if (centers.empty() || (numberOfAgents == 0))
+        return;
+
+    const double maxOrientationChangeRad = qDegreesToRadians(parameters.maxOrientationChangeDeg);
+    const bool useDirections = (directions.size() == centers.size());
+
+    // the distances from the objects to the agents
+    m_assignmentCosts.create(static_cast<int>(centers.size()), numberOfAgents);
+    double maxDistance = 0;
+    for (int agentIndex = 0; agentIndex < numberOfAgents; ++agentIndex) {
+        const StateImage& previousState = m_previousAgentsStates[agentIndex];
+        if (!previousState.position().isValid())
+            continue;
+        cv::Point2f previousPosition = previousState.position().toCvPoint2f();
+        for (size_t i = 0; i < centers.size(); ++i) {
+            double distance = cv::norm(centers[i] - previousPosition);
+            double& cost = m_assignmentCosts(static_cast<int>(i), agentIndex);
+            cost = distance;
+            if ((parameters.maxDisplacementPx > 0) && (distance > parameters.maxDisplacementPx)) {
+                cost = AssignmentSolver::Forbidden;
+                continue;
+            }
+            if (useDirections && (maxOrientationChangeRad > 0) && previousState.orientation().isValid()) {
+                double orientationChange = std::remainder(directions[i] - previousState.orientation().angleRad(), 2 * M_PI);
+                if (std::fabs(orientationChange) > maxOrientationChangeRad) {
+                    cost = AssignmentSolver::Forbidden;
+                    continue;
+                }
+            }
+            maxDistance = qMax(maxDistance, distance);
+        }
+    }
+
+    // the lost agents cost more than any tracked agent
+    double lostAgentCost = (parameters.maxDisplacementPx > 0) ? parameters.maxDisplacementPx : maxDistance + 1;
+    for (int agentIndex = 0; agentIndex < numberOfAgents; ++agentIndex) {
+        if (m_previousAgentsStates[agentIndex].position().isValid())
+            continue;
+        for (size_t i = 0; i < centers.size(); ++i)
+            m_assignmentCosts(static_cast<int>(i), agentIndex) = lostAgentCost;
+    }
+
+    std::vector<int> assignment = AssignmentSolver::solve(m_assignmentCosts);
+    for (size_t i = 0; i < assignment.size(); ++i) {
+        if (assignment[i] >= 0)
+            setAgentState(m_agents[assignment[i]], centers[i], directions, i);
+    }
+}
+
+/*!
+ * Sets the agent's state from the detected object, the orientation is set if
+ * the directions are provided.
+ */
+void TrackingRoutine::setAgentState(AgentDataImage& agent, const cv::Point2f& center, const std::vector<float>& directions, size_t index)
+{
+    agent.mutableState()->setPosition(center);
+    if (index < directions.size())
+        agent.mutableState()->setOrientation(directions[index]);
+    else
+        agent.mutableState()->invalidateOrientation();
+}
+
+/*!
+ * Converts the point on the downscaled image to the full resolution. A pixel
+ * of the downscaled image covers scale x scale pixels of the full resolution
+ * image, the point is mapped to the center of this block.
+ */
+cv::Point2f TrackingRoutine::toFullResolution(cv::Point2f point, int scale)
+{
+    return point * scale + cv::Point2f((scale - 1) / 2., (scale - 1) / 2.);
+}
+
+/*!
+ * Converts the rectangle on the downscaled image to the full resolution,
+ * expands it by the margin and clips it to the image.
+ */
+cv::Rect TrackingRoutine::toFullResolution(cv::Rect rect, int scale, int margin, cv::Size imageSize)
+{
+    cv::Rect fullResolutionRect(rect.x * scale - margin,
+                                rect.y * scale - margin,
+                                rect.width * scale + 2 * margin,
+                                rect.height * scale + 2 * margin);
+    return fullResolutionRect & cv::Rect(cv::Point(0, 0), imageSize);
+}
+
 /*!
  * Computes a contour's center.
  */
@@ -1,6 +1,9 @@
 #ifndef CATS2_TRACKING_ROUTINE_HPP
 #define CATS2_TRACKING_ROUTINE_HPP
 
+#include "MotionPredictor.hpp"
+#include "PreparedFrameQueue.hpp"
+
 #include <CommonPointerTypes.hpp>
 #include <AgentData.hpp>
 
@@ -9,6 +12,7 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QMutex>
+#include <QtCore/QScopedPointer>
 
 #include <atomic>
 
@@ -19,10 +23,63 @@ class TimestampedFrame;
  */
 enum class IdsAssignmentMethod
 {
-    NAIVE_CLOSEST_NEIGHBOUR // the one originally used in CATS
-    // TODO : add other methods
+    NAIVE_CLOSEST_NEIGHBOUR, // the one originally used in CATS
+    HUNGARIAN // the optimal assignment minimizing the total displacement
 };
 
+/*!
+ * \brief The parameters of the ids' assignment.
+ */
+struct IdsAssignmentDescription
+{
+    //! The assignment method.
+    IdsAssignmentMethod method = IdsAssignmentMethod::NAIVE_CLOSEST_NEIGHBOUR;
+    //! The maximal displacement of an agent between two frames, the farther
+    //! detections are not assigned to it; 0 means no limit.
+    double maxDisplacementPx = 0;
+    //! The maximal orientation change of an agent between two frames;
+    //! 0 means no limit.
+    double maxOrientationChangeDeg = 0;
+
+    //! Gets the assignment method from the settings' string.
+    static IdsAssignmentMethod methodFromSettingsString(QString methodName)
+    {
+        if (methodName.toLower() == "hungarian")
+            return IdsAssignmentMethod::HUNGARIAN;
+        else
+            return IdsAssignmentMethod::NAIVE_CLOSEST_NEIGHBOUR;
+    }
+};
+
+/*!
+ * \brief The parameters of the agents' motion prediction. Only the position
+ * is predicted, a coasting agent keeps its last measured orientation.
+ */
+struct MotionPredictionDescription
+{
+    //! Defines if the agents' states are predicted.
+    bool enabled = false;
+    //! The number of frames during which the lost agent keeps its predicted
+    //! state.
+    int maxCoastingFrames = 5;
+    //! The standard deviation of the agents' acceleration.
+    double accelerationNoisePxPerSec2 = 500;
+    //! The standard deviation of the measured position.
+    double measurementNoisePx = 2;
+};
+
+/*!
+ * \brief The parameters of the pipelined tracking.
+ */
+struct PipelineDescription
+{
+    //! Defines if the frames are preprocessed and the results are sent out
+    //! in separate threads while the current frame is tracked.
+    bool enabled = false;
+    //! The number of the prepared frames waiting for the detection, and of
+    //! the results waiting to be sent out.
+    int bufferFrames = 2;
+};
 
 /*!
 * \brief Parent class for various tracking routines.
@@ -41,10 +98,28 @@ public:
     TimestampedFrameQueuePtr debugQueue() { return m_debugQueue; }
     //! Reports on what type of agent can be tracked by this routine.
     virtual QList<AgentType> capabilities() const = 0;
+    //! Returns true if the routine keeps the agents' identities from frame to
+    //! frame, i.e. the agent at a given index is always the same individual.
+    //! The motion prediction relies on it.
+    virtual bool keepsAgentsIdentities() const { return false; }
+    //! Sets the parameters of the motion prediction, to be called before
+    //! the tracking is started. The prediction is enabled only for the
+    //! routines that keep the agents' identities.
+    void setMotionPrediction(MotionPredictionDescription motionPrediction);
+    //! Sets the parameters of the pipelined tracking, to be called before
+    //! the tracking is started.
+    void setPipeline(PipelineDescription pipeline) { m_pipeline = pipeline; }
+    //! Sets the prefix of the names of the stages' timings in the metrics
+    //! registry, no timings are reported if it's empty.
+    void setMetricsPrefix(QString metricsPrefix) { m_metricsPrefix = metricsPrefix; }
 
 signals:
-    //! Sends out the tracked agents.
+    //! Sends out the tracked agents. Emitted in the publishing thread when the
+    //! tracking is pipelined.
     void trackedAgents(TimestampedImageAgentsData agents);
+    //! Notifies that the stream is over and all its frames are tracked,
+    //! emitted just before finished.
+    void streamProcessed();
     //! Notifies that the tracking is stopped.
     void finished();
     //! Notifies about an error.
@@ -55,6 +130,9 @@ public slots:
     void process();
     //! Stops the tracking.
     void stop();
+    //! Stops the tracking once the frames waiting in the input queue are
+    //! tracked, called at the end of the stream.
+    void finish();
     //! Starts/stops to enqueue the debug images to the debug queue.
     void onSendDebugImages(bool send);
 
@@ -63,25 +141,62 @@ protected:
     //! agents, eventually associates them with the trajectories and
     //! enqueue debug images on request.
     virtual void doTracking(const TimestampedFrame& frame) = 0;
+    //! Prepares the images for the detection of the agents on the frame, e.g.
+    //! converts and downscales it. When the tracking is pipelined it's run in
+    //! the preprocessing thread ahead of doTracking, thus it must not modify
+    //! the routine. Does nothing by default.
+    virtual void preprocess(const TimestampedFrame& frame, std::vector<cv::Mat>& preparedImages);
+    //! Returns the image prepared for the current frame by preprocess, or an
+    //! empty image if there is no such image.
+    const cv::Mat& preparedImage(size_t index) const;
     //! Puts an image to the debug queue.
     void enqueueDebugImage(const cv::Mat& image);
     //! Sets the states of all agents as invalid. The goal is to prevent the
     //! outdated data from poping; it's up to the specific routine to set
-    //! the agent's state as valid if it is detected.
+    //! the agent's state as valid if it is detected. When the motion is
+    //! predicted, the agents' positions are replaced by the predicted ones.
     void invalidateAgentsState();
+    //! Updates the motion predictions with the detected agents, the lost
+    //! agents take the predicted states while they are coasting.
+    void updateMotionPredictions();
+
+private:
+    //! Runs the preprocessing stage of the pipelined tracking.
+    void runPreprocessing();
+    //! Runs the preprocessing of the frame, measures its duration.
+    PreparedFrame prepareFrame(const TimestampedFrame& frame);
+    //! Tracks the agents on the prepared frame and passes the results to the
+    //! publishing stage.
+    void track(const PreparedFrame& preparedFrame);
+    //! Runs the publishing stage of the pipelined tracking.
+    void runPublishing();
+    //! Sends out the tracked agents, measures the duration.
+    void publish(const TimestampedImageAgentsData& agentsData);
 
 protected:
     //! Assign detected objects to ids.
-    void assingIds(IdsAssignmentMethod method, std::vector<cv::Point2f>& centers, std::vector<float> directions = std::vector<float>());
+    void assingIds(const IdsAssignmentDescription& parameters, std::vector<cv::Point2f>& centers, std::vector<float> directions = std::vector<float>());
     //! The ids assignment method originally used in CATS.
     //! NOTE FIXME : this method is potentially erroneous in many cases, as the order of assigment is defined by the indeces of agents in the list.
     void naiveClosestNeighbour(std::vector<cv::Point2f>& centers, std::vector<float> directions = std::vector<float>());
+    //! Assigns the detected objects to ids so that the total displacement of
+    //! the agents is minimal, the assignments beyond the given limits are
+    //! forbidden.
+    void hungarianAssignment(const IdsAssignmentDescription& parameters, std::vector<cv::Point2f>& centers, std::vector<float> directions = std::vector<float>());
+    //! Sets the agent's state from the detected object.
+    void setAgentState(AgentDataImage& agent, const cv::Point2f& center, const std::vector<float>& directions, size_t index);
 
     // FIXME : use this method everywhere to compute the center instead of the
     // moments based computation of center
     //! Computes a contour's center.
     cv::Point2f contourCenter(const std::vector<cv::Point>& contour);
 
+    //! Converts the point on the downscaled image to the full resolution.
+    static cv::Point2f toFullResolution(cv::Point2f point, int scale);
+    //! Converts the rectangle on the downscaled image to the full resolution,
+    //! expands it by the margin and clips it to the image.
+    static cv::Rect toFullResolution(cv::Rect rect, int scale, int margin, cv::Size imageSize);
+
 protected:
     //! The queue containing frames to do the tracking.
     TimestampedFrameQueuePtr m_inputQueue;
@@ -89,17 +204,48 @@ protected:
     TimestampedFrameQueuePtr m_debugQueue; // TODO : replaced this one queue by a list of queues to debug various phases of the tracking routine
 
     //! The current frame's timestamp.
-    std::chrono::milliseconds m_currentTimestamp;
+    std::chrono::microseconds m_currentTimestamp;
+    //! The previous frame's timestamp.
+    std::chrono::microseconds m_previousTimestamp;
     //! The flag that defines if the convertor is to be stopped.
     std::atomic_bool m_stopped;
+    //! The flag that defines if no more frames come to the input queue.
+    std::atomic_bool m_inputFinished;
+    //! The flag that defines if no more frames come to the prepared frames'
+    //! buffer when pipelined.
+    std::atomic_bool m_preprocessingFinished;
+    //! The flag that defines if no more results come to the publishing
+    //! stage's buffer when pipelined.
+    std::atomic_bool m_detectionFinished;
     //! The flag that defines if the debug images are to be put to the debug queue.
     std::atomic_bool m_enqueueDebugFrames;
 
     //! The tracked agents.
     QList<AgentDataImage> m_agents;
+    //! The agents' states on the previous frame, saved before they are
+    //! invalidated. Used to assign the ids.
+    QList<StateImage> m_previousAgentsStates;
+    //! The costs of the ids' assignment, kept to not reallocate it every frame.
+    cv::Mat_<double> m_assignmentCosts;
+    //! The parameters of the motion prediction.
+    MotionPredictionDescription m_motionPrediction;
+    //! The motion predictors, their order corresponds to the agents' order.
+    std::vector<MotionPredictor> m_motionPredictors;
 
     //! The mutex to protect settings.
     QMutex m_settingsMutex;
+
+private:
+    //! The parameters of the pipelined tracking.
+    PipelineDescription m_pipeline;
+    //! The prepared frames waiting for the detection when pipelined.
+    QScopedPointer<PreparedFrameQueue> m_preparedFrames;
+    //! The tracked agents waiting to be sent out when pipelined.
+    QScopedPointer<StageQueue<TimestampedImageAgentsData>> m_agentsToPublish;
+    //! The images prepared for the current frame.
+    std::vector<cv::Mat> m_preparedImages;
+    //! The prefix of the stages' timings in the metrics registry.
+    QString m_metricsPrefix;
 };
 
 #endif // CATS2_TRACKING_ROUTINE_HPP
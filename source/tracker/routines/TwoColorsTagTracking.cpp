@@ -50,7 +50,7 @@ TwoColorsTagTracking::~TwoColorsTagTracking()
  */
 void TwoColorsTagTracking::doTracking(const TimestampedFrame& frame)
 {
-    cv::Mat image = frame.image();
+    const cv::Mat& image = frame.image();
 
     // limit the image format to three channels color images
     if (image.type() == CV_8UC3) {
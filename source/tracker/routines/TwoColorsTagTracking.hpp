@@ -26,6 +26,8 @@ public:
 
     //! Reports on what type of agent can be tracked by this routine.
     virtual QList<AgentType> capabilities() const override;
+    //! Returns true, only one agent is tracked.
+    virtual bool keepsAgentsIdentities() const override { return true; }
 
     //! Getter for the settings.
     const TwoColorsTagTrackingSettingsData& settings() const { return m_settings; }
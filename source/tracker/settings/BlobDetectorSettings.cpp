@@ -45,6 +45,34 @@ bool BlobDetectorSettings::init(QString configurationFileName)
     settings.readVariable(QString("%1/tracking/blobDetector/useHarrisDetector").arg(m_settingPathPrefix), value, m_data.useHarrisDetector());
     m_data.setUseHarrisDetector(value);
 
+    // the ids' assignment
+    IdsAssignmentDescription idsAssignment;
+    std::string methodName;
+    settings.readVariable(QString("%1/tracking/idsAssignment/method").arg(m_settingPathPrefix), methodName, std::string("naive"));
+    idsAssignment.method = IdsAssignmentDescription::methodFromSettingsString(QString::fromStdString(methodName));
+    settings.readVariable(QString("%1/tracking/idsAssignment/maxDisplacementPx").arg(m_settingPathPrefix),
+                          idsAssignment.maxDisplacementPx, idsAssignment.maxDisplacementPx);
+    settings.readVariable(QString("%1/tracking/idsAssignment/maxOrientationChangeDeg").arg(m_settingPathPrefix),
+                          idsAssignment.maxOrientationChangeDeg, idsAssignment.maxOrientationChangeDeg);
+    m_data.setIdsAssignment(idsAssignment);
+
+    // the background model
+    BackgroundModelDescription backgroundModel;
+    std::string typeName;
+    settings.readVariable(QString("%1/tracking/blobDetector/backgroundModel/type").arg(m_settingPathPrefix), typeName, std::string("mog"));
+    backgroundModel.type = BackgroundModelDescription::typeFromSettingsString(QString::fromStdString(typeName));
+    settings.readVariable(QString("%1/tracking/blobDetector/backgroundModel/learningFrames").arg(m_settingPathPrefix),
+                          backgroundModel.learningFrames, backgroundModel.learningFrames);
+    settings.readVariable(QString("%1/tracking/blobDetector/backgroundModel/updatePeriodFrames").arg(m_settingPathPrefix),
+                          backgroundModel.updatePeriodFrames, backgroundModel.updatePeriodFrames);
+    settings.readVariable(QString("%1/tracking/blobDetector/backgroundModel/updateOutsideBlobsOnly").arg(m_settingPathPrefix),
+                          backgroundModel.updateOutsideBlobsOnly, backgroundModel.updateOutsideBlobsOnly);
+    settings.readVariable(QString("%1/tracking/blobDetector/backgroundModel/learningRate").arg(m_settingPathPrefix),
+                          backgroundModel.learningRate, backgroundModel.learningRate);
+    settings.readVariable(QString("%1/tracking/blobDetector/backgroundModel/foregroundThreshold").arg(m_settingPathPrefix),
+                          backgroundModel.foregroundThreshold, backgroundModel.foregroundThreshold);
+    m_data.setBackgroundModel(backgroundModel);
+
     return true;
 }
 
@@ -2,6 +2,7 @@
 #define CATS2_BLOB_DETECTOR_SETTINGS_HPP
 
 #include "TrackingRoutineSettings.hpp"
+#include "routines/BackgroundModel.hpp"
 
 /*!
  * The actual data stored in the settings. It's separated in a class to be easily trasferable
@@ -45,6 +46,16 @@ public:
     double k() const { return m_k; }
     void setK(double k) { m_k = k; }
 
+    //! Returns the parameters of the ids' assignment.
+    IdsAssignmentDescription idsAssignment() const { return m_idsAssignment; }
+    //! Sets the parameters of the ids' assignment.
+    void setIdsAssignment(IdsAssignmentDescription idsAssignment) { m_idsAssignment = idsAssignment; }
+
+    //! Returns the parameters of the background model.
+    BackgroundModelDescription backgroundModel() const { return m_backgroundModel; }
+    //! Sets the parameters of the background model.
+    void setBackgroundModel(BackgroundModelDescription backgroundModel) { m_backgroundModel = backgroundModel; }
+
 protected:
     //! Number of agents to track.
     int m_numberOfAgents;
@@ -61,6 +72,10 @@ protected:
     bool m_useHarrisDetector;
     //!
     double m_k;
+    //! The parameters of the ids' assignment.
+    IdsAssignmentDescription m_idsAssignment;
+    //! The parameters of the background model.
+    BackgroundModelDescription m_backgroundModel;
 };
 
 /*!
@@ -33,6 +33,11 @@ bool FishBotLedsTrackingSettings::init(QString configurationFileName)
     std::string maskFilePath;
     settings.readVariable(QString("%1/tracking/maskFile").arg(m_settingPathPrefix), maskFilePath);
     m_data.setMaskFilePath(configurationFolder.toStdString() + QDir::separator().toLatin1() + maskFilePath);
+    // read the search area size, by default the whole frame is searched
+    int searchRadiusPx;
+    settings.readVariable(QString("%1/tracking/fishBotLedsTracking/searchRadiusPx").arg(m_settingPathPrefix),
+                          searchRadiusPx, 0);
+    m_data.setSearchRadiusPx(searchRadiusPx);
 
     // read the robot specific settings
     for (int robotIndex = 1; robotIndex <= numberOfRobots; ++robotIndex) {
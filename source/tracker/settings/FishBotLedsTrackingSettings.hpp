@@ -6,6 +6,8 @@
 #include <QtCore/QDebug>
 #include <QtGui/QColor>
 
+#include <algorithm>
+
 /*!
  * The actual data stored in the settings. It's separated in a class to be easily trasferable
  * to the corresponding tracking routine.
@@ -14,7 +16,8 @@ class FishBotLedsTrackingSettingsData
 {
 public:
     //! Constructor.
-    explicit FishBotLedsTrackingSettingsData()
+    explicit FishBotLedsTrackingSettingsData() :
+        m_searchRadiusPx(0)
     {
     }
 
@@ -71,11 +74,19 @@ public:
     std::string maskFilePath() const { return m_maskFilePath; }
     void setMaskFilePath(std::string maskFilePath) { m_maskFilePath = maskFilePath; }
 
+    //! Returns the half-size of the area around the robot's previous position
+    //! where its leds are searched, 0 means that the whole frame is searched.
+    int searchRadiusPx() const { return m_searchRadiusPx; }
+    //! Sets the half-size of the search area around the robot.
+    void setSearchRadiusPx(int searchRadiusPx) { m_searchRadiusPx = std::max(searchRadiusPx, 0); }
+
 protected:
     //! The parameters of all robots to track.
     QList<FishBotDescription> m_robotsDescriptions;
     //! The arena mask file, an optional parameter.
     std::string m_maskFilePath;
+    //! The half-size of the search area around the robot's previous position.
+    int m_searchRadiusPx;
     // TODO : add the rest of parameters
 };
 
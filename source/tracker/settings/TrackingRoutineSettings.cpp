@@ -7,7 +7,9 @@
  * Constructor.
  */
 TrackingRoutineSettings::TrackingRoutineSettings(SetupType::Enum setupType) :
-    m_trackingRoutineType(TrackingRoutineType::UNDEFINED)
+    m_trackingRoutineType(TrackingRoutineType::UNDEFINED),
+    m_detectionScale(1),
+    m_tiling()
 {
     m_settingPathPrefix = SetupType::toSettingsString(setupType);
 }
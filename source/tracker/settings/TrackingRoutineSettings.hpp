@@ -3,6 +3,7 @@
 
 #include "routines/TrackingRoutine.hpp"
 #include "routines/TrackingRoutineType.hpp"
+#include "routines/FrameTiling.hpp"
 
 #include <CommonPointerTypes.hpp>
 #include <SetupType.hpp>
@@ -10,6 +11,8 @@
 #include <QtCore/QString>
 #include <QtCore/QSharedPointer>
 
+#include <algorithm>
+
 /*!
  * The parent class for settings for various tracing routines.
  */
@@ -27,12 +30,25 @@ public:
     virtual bool init(QString configurationFileName) = 0;
     //! The tracking method.
     TrackingRoutineType::Enum type() const { return m_trackingRoutineType; }
+    //! Returns the factor by which the frames are downscaled for the
+    //! detection, 1 means that the detection is done at the full resolution.
+    int detectionScale() const { return m_detectionScale; }
+    //! Sets the detection scale.
+    void setDetectionScale(int detectionScale) { m_detectionScale = std::max(detectionScale, 1); }
+    //! Returns the parameters of the tiled processing of the frames.
+    TilingDescription tiling() const { return m_tiling; }
+    //! Sets the parameters of the tiled processing.
+    void setTiling(TilingDescription tiling) { m_tiling = tiling; }
 
 protected:
     //! The tracking method for which these settings are applied.
     TrackingRoutineType::Enum m_trackingRoutineType;
     //! The section name in the configuration file.
     QString m_settingPathPrefix;
+    //! The factor by which the frames are downscaled for the detection.
+    int m_detectionScale;
+    //! The parameters of the tiled processing.
+    TilingDescription m_tiling;
 };
 
 #endif // CATS2_TRACKING_ROUTINE_SETTINGS_HPP
@@ -37,6 +37,26 @@ bool TrackingSettings::init(QString configurationFileName, SetupType::Enum setup
     settings.readVariable("experiment/agents/numberOfAnimals", m_numberOfAnimals, 0);
 
     // and now read the settings specific for given setup type
+    // the motion prediction
+    QString prefix = SetupType::toSettingsString(setupType);
+    MotionPredictionDescription motionPrediction;
+    settings.readVariable(QString("%1/tracking/motionPrediction/enabled").arg(prefix),
+                          motionPrediction.enabled, motionPrediction.enabled);
+    settings.readVariable(QString("%1/tracking/motionPrediction/maxCoastingFrames").arg(prefix),
+                          motionPrediction.maxCoastingFrames, motionPrediction.maxCoastingFrames);
+    settings.readVariable(QString("%1/tracking/motionPrediction/accelerationNoisePxPerSec2").arg(prefix),
+                          motionPrediction.accelerationNoisePxPerSec2, motionPrediction.accelerationNoisePxPerSec2);
+    settings.readVariable(QString("%1/tracking/motionPrediction/measurementNoisePx").arg(prefix),
+                          motionPrediction.measurementNoisePx, motionPrediction.measurementNoisePx);
+    m_motionPredictions.insert(setupType, motionPrediction);
+    // the pipelined tracking
+    PipelineDescription pipeline;
+    settings.readVariable(QString("%1/tracking/pipeline/enabled").arg(prefix),
+                          pipeline.enabled, pipeline.enabled);
+    settings.readVariable(QString("%1/tracking/pipeline/bufferFrames").arg(prefix),
+                          pipeline.bufferFrames, pipeline.bufferFrames);
+    m_pipelines.insert(setupType, pipeline);
+
     // get the tracking routine type
     TrackingRoutineType::Enum trackingRoutineType =
             readTrackingRoutineType(configurationFileName, setupType);
@@ -51,6 +71,15 @@ bool TrackingSettings::init(QString configurationFileName, SetupType::Enum setup
 
     // initialize settings
     settingsAccepted = routineSettings->init(configurationFileName);
+    // the detection scale is common to all the routines
+    int detectionScale;
+    settings.readVariable(QString("%1/tracking/detectionScale").arg(prefix), detectionScale, 1);
+    routineSettings->setDetectionScale(detectionScale);
+    // so is the tiling
+    TilingDescription tiling;
+    settings.readVariable(QString("%1/tracking/tiling/tileSizePx").arg(prefix), tiling.tileSizePx, tiling.tileSizePx);
+    settings.readVariable(QString("%1/tracking/tiling/overlapPx").arg(prefix), tiling.overlapPx, tiling.overlapPx);
+    routineSettings->setTiling(tiling);
 
     return settingsAccepted;
 }
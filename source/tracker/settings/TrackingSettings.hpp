@@ -42,6 +42,22 @@ public:
         return m_trackingRoutineSettings.value(type);
     }
 
+    /*!
+     * Returns the parameters of the agents' motion prediction in this setup.
+     */
+    MotionPredictionDescription motionPrediction(SetupType::Enum type) const
+    {
+        return m_motionPredictions.value(type);
+    }
+
+    /*!
+     * Returns the parameters of the pipelined tracking in this setup.
+     */
+    PipelineDescription pipeline(SetupType::Enum type) const
+    {
+        return m_pipelines.value(type);
+    }
+
     //! The experiment type (used to write the tracking results to a file).
     QString experimentType() const { return m_experimentType; }
     //! The experiment name (used to write the tracking results to a file).
@@ -65,6 +81,10 @@ private:
 private:
     //! The settings for the tracking routine used in various setups.
     QMap<SetupType::Enum, TrackingRoutineSettingsPtr> m_trackingRoutineSettings;
+    //! The parameters of the agents' motion prediction used in various setups.
+    QMap<SetupType::Enum, MotionPredictionDescription> m_motionPredictions;
+    //! The parameters of the pipelined tracking used in various setups.
+    QMap<SetupType::Enum, PipelineDescription> m_pipelines;
 
     //! The experiment type (used to write the tracking results to a file).
     QString m_experimentType;
@@ -0,0 +1,36 @@
+#include "TestMotionPredictor.hpp"
+
+#include "routines/MotionPredictor.hpp"
+
+#include <vector>
+
+/*!
+ * Tests that the copied predictors follow their own agents. As in the tracking
+ * routine, all the agents are predicted first, then all of them are corrected,
+ * thus a shared filter would mix up their states.
+ */
+void TestMotionPredictor::oppositeAgents()
+{
+    const double dtSec = 0.1;
+    const double speedPxPerSec = 100;
+    // the predictors are copies of the same predictor
+    std::vector<MotionPredictor> predictors(2, MotionPredictor());
+
+    for (int frame = 0; frame < 10; ++frame) {
+        for (MotionPredictor& predictor : predictors)
+            predictor.predict(dtSec);
+        double offset = speedPxPerSec * dtSec * frame;
+        predictors[0].correct(StateImage(PositionPixels(100 + offset, 100)));
+        predictors[1].correct(StateImage(PositionPixels(100 - offset, 100)));
+    }
+
+    for (MotionPredictor& predictor : predictors)
+        predictor.predict(dtSec);
+    // the agents are at 190 and 10 px, the next positions are 200 and 0 px
+    QVERIFY(predictors[0].predictedState().position().x() > 190);
+    QVERIFY(predictors[1].predictedState().position().x() < 10);
+    QVERIFY(qAbs(predictors[0].predictedState().position().y() - 100) < 1);
+    QVERIFY(qAbs(predictors[1].predictedState().position().y() - 100) < 1);
+}
+
+QTEST_MAIN(TestMotionPredictor)
@@ -0,0 +1,18 @@
+#ifndef CATS2_TEST_MOTION_PREDICTOR_HPP
+#define CATS2_TEST_MOTION_PREDICTOR_HPP
+
+#include <QtTest/QtTest>
+
+/*!
+* \brief This class tests the motion prediction of the tracked agents.
+*/
+class TestMotionPredictor : public QObject
+{
+    Q_OBJECT
+private slots:
+    //! Tests that the copied predictors follow their own agents: two agents
+    //! moving in opposite directions get predictions apart.
+    void oppositeAgents();
+};
+
+#endif // CATS2_TEST_MOTION_PREDICTOR_HPP
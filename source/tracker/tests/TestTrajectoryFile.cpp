@@ -0,0 +1,181 @@
+#include "TestTrajectoryFile.hpp"
+
+#include "TrajectoryFile.hpp"
+
+#include <QtCore/QBuffer>
+
+namespace {
+
+/*!
+ * Returns the header of a file with one robot and one fish.
+ */
+TrajectoryFileHeader makeHeader()
+{
+    TrajectoryFileHeader header;
+    header.version = TrajectoryFile::Version;
+    header.numberOfRobots = 1;
+    header.numberOfAnimals = 1;
+    header.startTimeUs = 1000000;
+    return header;
+}
+
+/*!
+ * Returns a chunk of two frames starting at the given timestamp, the fish is
+ * lost on the second frame.
+ */
+TrajectoryChunk makeChunk(const TrajectoryFileHeader& header, qint64 timestampUs)
+{
+    TrajectoryChunk chunk;
+    chunk.reset(header.numberOfAgents());
+    for (int frame = 0; frame < 2; ++frame) {
+        chunk.timestampsUs.push_back(timestampUs + frame * 500000);
+        for (size_t agent = 0; agent < chunk.agents.size(); ++agent) {
+            bool found = (agent == 0) || (frame == 0);
+            chunk.agents[agent].x.push_back(found ? 0.25f * (agent + 1) : 0);
+            chunk.agents[agent].y.push_back(found ? 0.5f * (agent + 1) : 0);
+            chunk.agents[agent].direction.push_back(found ? 1.5f : 0);
+            quint8 flags = found ? (TrajectoryFile::POSITION_VALID | TrajectoryFile::ORIENTATION_VALID) : 0;
+            chunk.agents[agent].flags.push_back(flags);
+        }
+    }
+    return chunk;
+}
+
+/*!
+ * Writes the header and the chunks to the buffer.
+ */
+QByteArray writeFile(const TrajectoryFileHeader& header, const QList<TrajectoryChunk>& chunks)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QDataStream stream(&buffer);
+    TrajectoryFile::setUpStream(stream);
+    TrajectoryFile::writeHeader(stream, header);
+    for (const TrajectoryChunk& chunk : chunks)
+        TrajectoryFile::writeChunk(stream, chunk);
+    return buffer.data();
+}
+
+} // namespace
+
+/*!
+ * Tests that the written header and chunks are read back unchanged.
+ */
+void TestTrajectoryFile::roundTrip()
+{
+    TrajectoryFileHeader header = makeHeader();
+    QList<TrajectoryChunk> chunks;
+    chunks << makeChunk(header, 1000000) << makeChunk(header, 2000000);
+    QByteArray data = writeFile(header, chunks);
+
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QDataStream stream(&buffer);
+    TrajectoryFile::setUpStream(stream);
+
+    TrajectoryFileHeader readHeader;
+    QVERIFY(TrajectoryFile::readHeader(stream, readHeader));
+    QCOMPARE(readHeader.version, header.version);
+    QCOMPARE(readHeader.numberOfRobots, header.numberOfRobots);
+    QCOMPARE(readHeader.numberOfAnimals, header.numberOfAnimals);
+    QCOMPARE(readHeader.startTimeUs, header.startTimeUs);
+
+    for (const TrajectoryChunk& chunk : chunks) {
+        TrajectoryChunk readChunk;
+        QVERIFY(TrajectoryFile::readChunk(stream, readHeader.numberOfAgents(), readChunk));
+        QVERIFY(readChunk.timestampsUs == chunk.timestampsUs);
+        QCOMPARE(readChunk.agents.size(), chunk.agents.size());
+        for (size_t agent = 0; agent < chunk.agents.size(); ++agent) {
+            QVERIFY(readChunk.agents[agent].x == chunk.agents[agent].x);
+            QVERIFY(readChunk.agents[agent].y == chunk.agents[agent].y);
+            QVERIFY(readChunk.agents[agent].direction == chunk.agents[agent].direction);
+            QVERIFY(readChunk.agents[agent].flags == chunk.agents[agent].flags);
+        }
+    }
+    QVERIFY(stream.atEnd());
+}
+
+/*!
+ * Tests that a file with a wrong signature is rejected.
+ */
+void TestTrajectoryFile::wrongSignature()
+{
+    QByteArray data = writeFile(makeHeader(), QList<TrajectoryChunk>());
+    data[0] = 'X';
+
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QDataStream stream(&buffer);
+    TrajectoryFile::setUpStream(stream);
+
+    TrajectoryFileHeader header;
+    QVERIFY(!TrajectoryFile::readHeader(stream, header));
+}
+
+/*!
+ * Tests that a file with an unsupported version is rejected.
+ */
+void TestTrajectoryFile::unsupportedVersion()
+{
+    TrajectoryFileHeader header = makeHeader();
+    header.version = TrajectoryFile::Version + 1;
+    QByteArray data = writeFile(header, QList<TrajectoryChunk>());
+
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QDataStream stream(&buffer);
+    TrajectoryFile::setUpStream(stream);
+
+    TrajectoryFileHeader readHeader;
+    QVERIFY(!TrajectoryFile::readHeader(stream, readHeader));
+}
+
+/*!
+ * Tests that the truncated last chunk is skipped while the previous ones are
+ * read.
+ */
+void TestTrajectoryFile::truncatedChunk()
+{
+    TrajectoryFileHeader header = makeHeader();
+    QList<TrajectoryChunk> chunks;
+    chunks << makeChunk(header, 1000000) << makeChunk(header, 2000000);
+    QByteArray data = writeFile(header, chunks);
+    // the writing was interrupted in the middle of the flags
+    data.chop(1);
+
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QDataStream stream(&buffer);
+    TrajectoryFile::setUpStream(stream);
+
+    TrajectoryFileHeader readHeader;
+    QVERIFY(TrajectoryFile::readHeader(stream, readHeader));
+    TrajectoryChunk chunk;
+    QVERIFY(TrajectoryFile::readChunk(stream, readHeader.numberOfAgents(), chunk));
+    QVERIFY(chunk.timestampsUs == chunks.first().timestampsUs);
+    QVERIFY(!TrajectoryFile::readChunk(stream, readHeader.numberOfAgents(), chunk));
+}
+
+/*!
+ * Tests that the text layout is the tab-separated layout of the former text
+ * files: the time from the start in seconds then the x, y and direction of
+ * every agent, the missing agents are written as NaN.
+ */
+void TestTrajectoryFile::textLayout()
+{
+    TrajectoryFileHeader header = makeHeader();
+    TrajectoryChunk chunk = makeChunk(header, 1000000);
+
+    QString text;
+    QTextStream stream(&text);
+    TrajectoryFile::writeTextHeader(stream, header);
+    TrajectoryFile::writeTextChunk(stream, header, chunk);
+    stream.flush();
+
+    QCOMPARE(text, QString("timeStep\trobot0X\trobot0Y\trobot0Direction\t"
+                           "fish0X\tfish0Y\tfish0Direction\t\n"
+                           "0.000\t0.25\t0.5\t1.5\t0.5\t1\t1.5\t\n"
+                           "0.500\t0.25\t0.5\t1.5\tNaN\tNaN\tNaN\t\n"));
+}
+
+QTEST_MAIN(TestTrajectoryFile)
@@ -0,0 +1,30 @@
+#ifndef CATS2_TEST_TRAJECTORY_FILE_HPP
+#define CATS2_TEST_TRAJECTORY_FILE_HPP
+
+#include <QtTest/QtTest>
+
+/*!
+* \brief This class tests the reading and writing of the binary trajectory file.
+*/
+class TestTrajectoryFile : public QObject
+{
+    Q_OBJECT
+private slots:
+    //! Tests that the written header and chunks are read back unchanged.
+    void roundTrip();
+
+    //! Tests that a file with a wrong signature is rejected.
+    void wrongSignature();
+
+    //! Tests that a file with an unsupported version is rejected.
+    void unsupportedVersion();
+
+    //! Tests that the truncated last chunk is skipped.
+    void truncatedChunk();
+
+    //! Tests that the text layout is the tab-separated layout of the former
+    //! text files, the missing agents are written as NaN.
+    void textLayout();
+};
+
+#endif // CATS2_TEST_TRAJECTORY_FILE_HPP
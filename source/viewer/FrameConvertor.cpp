@@ -1,6 +1,7 @@
 #include "FrameConvertor.hpp"
 
 #include <TimestampedFrame.hpp>
+#include <TimestampClock.hpp>
 
 #include <QtGui/QImage>
 #include <QtGui/QPixmap>
@@ -13,7 +14,7 @@ FrameConvertor::FrameConvertor(TimestampedFrameQueuePtr inputQueue) :
     QObject(),
     m_inputQueue(inputQueue),
     m_stopped(false),
-    m_previousTimestamp(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()))
+    m_previousTimestamp(TimestampClock::now())
 {
     qRegisterMetaType<QSharedPointer<QPixmap>>("QSharedPointer<QPixmap>");
 }
@@ -39,7 +40,7 @@ void FrameConvertor::process()
             // Use the blocking with timeout version of dequeue
             if (m_inputQueue->dequeue(frame)) {
                 // compute the frame rate
-                std::chrono::milliseconds timeFromPreviousFrameMs = frame.timestamp() - m_previousTimestamp;
+                std::chrono::duration<double, std::milli> timeFromPreviousFrameMs = frame.timestamp() - m_previousTimestamp;
                 m_previousTimestamp = frame.timestamp();
                 // send the data
                 emit newFrame(cvMatToQPixmap(frame.image()), qFloor(1000./timeFromPreviousFrameMs.count()) + 0.5);
@@ -46,7 +46,7 @@ private:
     //! The flag that defines if the convertor is to be stopped.
     std::atomic_bool m_stopped;
     //! Previous timestamp to compute the framerate.
-    std::chrono::milliseconds m_previousTimestamp;
+    std::chrono::microseconds m_previousTimestamp;
 };
 
 #endif // CATS2_FRAME_CONVERTOR_HPP